@@ -0,0 +1,160 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <fs.h>
+#include <pow.h>
+#include <txdb.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// Number of headers in the synthetic block index.
+static const int BLOCK_INDEX_SIZE = 50000;
+
+//! Points -datadir at a scratch directory for the lifetime of the object.
+class ScratchDataDir {
+private:
+    fs::path path;
+
+public:
+    ScratchDataDir()
+        : path(fs::temp_directory_path() /
+               fs::unique_path("bench_blockindex_%%%%-%%%%-%%%%")) {
+        fs::create_directories(path);
+        gArgs.ForceSetArg("-datadir", path.string());
+        SelectBaseParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+    }
+
+    ~ScratchDataDir() {
+        ClearDatadirCache();
+        fs::remove_all(path);
+    }
+};
+
+/**
+ * A chain of regtest headers stored both as block index records and as a
+ * block index snapshot, like a node that was shut down cleanly.
+ */
+class SyntheticBlockIndex {
+public:
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndex;
+
+    SyntheticBlockIndex(int nBlocks, const Consensus::Params &params)
+        : vHashes(nBlocks), vIndex(nBlocks) {
+        const uint32_t nBits = UintToArith256(params.powLimit).GetCompact();
+        for (int i = 0; i < nBlocks; i++) {
+            CBlockHeader header;
+            header.nVersion = 4;
+            header.hashPrevBlock = i > 0 ? vHashes[i - 1] : uint256();
+            header.hashMerkleRoot.begin()[0] = i;
+            header.hashMerkleRoot.begin()[1] = i >> 8;
+            header.hashMerkleRoot.begin()[2] = i >> 16;
+            header.nTime = 1296688602 + i * 600;
+            header.nBits = nBits;
+            while (!CheckProofOfWork(header.GetHash(), nBits, params)) {
+                header.nNonce++;
+            }
+
+            vHashes[i] = header.GetHash();
+            CBlockIndex &index = vIndex[i];
+            index = CBlockIndex(header);
+            index.phashBlock = &vHashes[i];
+            index.pprev = i > 0 ? &vIndex[i - 1] : nullptr;
+            index.nHeight = i;
+            index.nTx = 1;
+            index.nStatus = BlockStatus()
+                                .withValidity(BlockValidity::SCRIPTS)
+                                .withData()
+                                .withUndo();
+            index.nFile = i / 1000;
+            index.nDataPos = 8 + (i % 1000) * 1000;
+            index.nUndoPos = 8 + (i % 1000) * 100;
+        }
+    }
+
+    void Write(CBlockTreeDB &blocktree, const fs::path &snapshot) const {
+        std::vector<const CBlockIndex *> vBlocks;
+        for (const CBlockIndex &index : vIndex) {
+            vBlocks.push_back(&index);
+        }
+        assert(blocktree.WriteBatchSync({}, 0, vBlocks));
+        assert(blocktree.WriteBlockIndexSnapshot(snapshot, vBlocks));
+    }
+};
+
+// Load the block index records one by one from leveldb and sort them by
+// height, as done at startup without a snapshot.
+static void BlockIndexLoadDB(benchmark::State &state) {
+    ScratchDataDir datadir;
+    const auto chainParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params &params = chainParams->GetConsensus();
+    CBlockTreeDB blocktree(8 << 20, true);
+    SyntheticBlockIndex(BLOCK_INDEX_SIZE, params)
+        .Write(blocktree, GetBlocksDir() / "blockindex.dat");
+
+    while (state.KeepRunning()) {
+        BlockMap map;
+        CBlockIndexArena arena;
+        auto insertBlockIndex = [&](const uint256 &hash) -> CBlockIndex * {
+            if (hash.IsNull()) {
+                return nullptr;
+            }
+            BlockMap::iterator mi = map.find(hash);
+            if (mi != map.end()) {
+                return mi->second;
+            }
+            CBlockIndex *pindexNew = arena.Allocate();
+            mi = map.insert(std::make_pair(hash, pindexNew)).first;
+            pindexNew->phashBlock = &mi->first;
+            return pindexNew;
+        };
+        assert(blocktree.LoadBlockIndexGuts(params, insertBlockIndex));
+
+        std::vector<std::pair<int, CBlockIndex *>> vSortedByHeight;
+        vSortedByHeight.reserve(map.size());
+        for (const std::pair<const uint256, CBlockIndex *> &item : map) {
+            vSortedByHeight.push_back(
+                std::make_pair(item.second->nHeight, item.second));
+        }
+        std::sort(vSortedByHeight.begin(), vSortedByHeight.end());
+        assert(vSortedByHeight.size() == size_t(BLOCK_INDEX_SIZE));
+    }
+}
+
+// Load the same block index from its snapshot, decoded in parallel and
+// already in height order.
+static void BlockIndexLoadSnapshot(benchmark::State &state) {
+    ScratchDataDir datadir;
+    const auto chainParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params &params = chainParams->GetConsensus();
+    CBlockTreeDB blocktree(8 << 20, true);
+    const fs::path snapshot = GetBlocksDir() / "blockindex.dat";
+    SyntheticBlockIndex(BLOCK_INDEX_SIZE, params).Write(blocktree, snapshot);
+
+    while (state.KeepRunning()) {
+        BlockMap map;
+        CBlockIndexArena arena;
+        std::vector<std::pair<uint256, CBlockIndex *>> vIndex;
+        assert(
+            blocktree.LoadBlockIndexSnapshot(snapshot, params, arena, vIndex));
+
+        map.reserve(vIndex.size());
+        for (const std::pair<uint256, CBlockIndex *> &item : vIndex) {
+            BlockMap::iterator mi = map.insert(item).first;
+            mi->second->phashBlock = &mi->first;
+        }
+        assert(map.size() == size_t(BLOCK_INDEX_SIZE));
+    }
+}
+
+BENCHMARK(BlockIndexLoadDB, 5);
+BENCHMARK(BlockIndexLoadSnapshot, 5);
@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockindexworkcomparator.h>
+#include <chain.h>
+#include <random.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// Roughly the number of headers on mainnet.
+static const int BLOCK_INDEX_SIZE = 600000;
+// Number of lookups per benchmark iteration.
+static const int LOOKUPS = 10000;
+
+/**
+ * A synthetic chain of block index entries. They are either allocated one by
+ * one in an arbitrary order, as they used to be when loaded from the block
+ * index database, or in height order from an arena.
+ */
+class SyntheticBlockIndex {
+private:
+    std::vector<std::unique_ptr<CBlockIndex>> vHeap;
+    CBlockIndexArena arena;
+
+public:
+    //! The entries, sorted by height
+    std::vector<CBlockIndex *> vIndex;
+
+    explicit SyntheticBlockIndex(bool fArena) {
+        if (fArena) {
+            CBlockIndex *base = arena.AllocateBulk(BLOCK_INDEX_SIZE);
+            for (int i = 0; i < BLOCK_INDEX_SIZE; i++) {
+                vIndex.push_back(&base[i]);
+            }
+        } else {
+            for (int i = 0; i < BLOCK_INDEX_SIZE; i++) {
+                vHeap.emplace_back(new CBlockIndex());
+            }
+            // Entries close in height end up far apart on the heap.
+            FastRandomContext rng(true);
+            for (int i = BLOCK_INDEX_SIZE - 1; i > 0; i--) {
+                std::swap(vHeap[i], vHeap[rng.randrange(i + 1)]);
+            }
+            for (const std::unique_ptr<CBlockIndex> &pindex : vHeap) {
+                vIndex.push_back(pindex.get());
+            }
+        }
+
+        CBlockIndex *pprev = nullptr;
+        for (CBlockIndex *pindex : vIndex) {
+            pindex->pprev = pprev;
+            pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+            pindex->nChainWork =
+                (pprev ? pprev->nChainWork : arith_uint256()) + 2;
+            pindex->BuildSkip();
+            pprev = pindex;
+        }
+    }
+};
+
+// Look up ancestors of the tip and of random blocks, as done to serve
+// locators and getheaders.
+static void GetAncestor(benchmark::State &state, bool fArena) {
+    const SyntheticBlockIndex index(fArena);
+    FastRandomContext rng(true);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < LOOKUPS; i++) {
+            const CBlockIndex *pindex =
+                index.vIndex[rng.randrange(BLOCK_INDEX_SIZE)];
+            const int nHeight = rng.randrange(pindex->nHeight + 1);
+            assert(pindex->GetAncestor(nHeight)->nHeight == nHeight);
+        }
+    }
+}
+
+// Find the fork point of random pairs of blocks, which walks pprev once the
+// skip list got both sides to the same height.
+static void FindFork(benchmark::State &state, bool fArena) {
+    const SyntheticBlockIndex index(fArena);
+    FastRandomContext rng(true);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < LOOKUPS / 10; i++) {
+            const CBlockIndex *pa =
+                index.vIndex[rng.randrange(BLOCK_INDEX_SIZE)];
+            const CBlockIndex *pb =
+                index.vIndex[rng.randrange(BLOCK_INDEX_SIZE)];
+            assert(LastCommonAncestor(pa, pb) ==
+                   (pa->nHeight < pb->nHeight ? pa : pb));
+        }
+    }
+}
+
+// Sort the last blocks by work, as the block index candidates are.
+static void SortByWork(benchmark::State &state, bool fArena) {
+    const SyntheticBlockIndex index(fArena);
+    std::vector<const CBlockIndex *> vCandidates(
+        index.vIndex.end() - LOOKUPS, index.vIndex.end());
+    FastRandomContext rng(true);
+    while (state.KeepRunning()) {
+        for (int i = LOOKUPS - 1; i > 0; i--) {
+            std::swap(vCandidates[i], vCandidates[rng.randrange(i + 1)]);
+        }
+        std::sort(vCandidates.begin(), vCandidates.end(),
+                  CBlockIndexWorkComparator());
+    }
+}
+
+static void BlockIndexGetAncestorHeap(benchmark::State &state) {
+    GetAncestor(state, false);
+}
+static void BlockIndexGetAncestorArena(benchmark::State &state) {
+    GetAncestor(state, true);
+}
+static void BlockIndexFindForkHeap(benchmark::State &state) {
+    FindFork(state, false);
+}
+static void BlockIndexFindForkArena(benchmark::State &state) {
+    FindFork(state, true);
+}
+static void BlockIndexSortByWorkHeap(benchmark::State &state) {
+    SortByWork(state, false);
+}
+static void BlockIndexSortByWorkArena(benchmark::State &state) {
+    SortByWork(state, true);
+}
+
+BENCHMARK(BlockIndexGetAncestorHeap, 50);
+BENCHMARK(BlockIndexGetAncestorArena, 50);
+BENCHMARK(BlockIndexFindForkHeap, 50);
+BENCHMARK(BlockIndexFindForkArena, 50);
+BENCHMARK(BlockIndexSortByWorkHeap, 50);
+BENCHMARK(BlockIndexSortByWorkArena, 50);
@@ -33,6 +33,59 @@ static void DeserializeBlockTest(benchmark::State &state) {
     }
 }
 
+/**
+ * A stream which only hands out copies of its data, like a file, so blocks
+ * are deserialized one transaction at a time rather than from memory.
+ */
+class CopyingStream {
+private:
+    SpanReader reader;
+
+public:
+    explicit CopyingStream(Span<const uint8_t> data)
+        : reader(SER_NETWORK, PROTOCOL_VERSION, data) {}
+
+    template <typename T> CopyingStream &operator>>(T &obj) {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+
+    int GetVersion() const { return reader.GetVersion(); }
+    int GetType() const { return reader.GetType(); }
+    void read(char *dst, size_t n) { reader.read(dst, n); }
+};
+
+// Same as DeserializeBlockTest, but the transactions are serialized again to
+// be hashed instead of being hashed in the received buffer.
+static void DeserializeBlockCopyTest(benchmark::State &state) {
+    const Span<const uint8_t> data(block_bench::block413567,
+                                   sizeof(block_bench::block413567));
+    while (state.KeepRunning()) {
+        CBlock block;
+        CopyingStream stream(data);
+        stream >> block;
+    }
+}
+
+// Same as DeserializeBlockTest, but each transaction is allocated, and freed
+// with the block, on its own rather than in the arena of the block.
+static void DeserializeBlockNoArenaTest(benchmark::State &state) {
+    CDataStream stream((const char *)block_bench::block413567,
+                       (const char *)&block_bench::block413567[sizeof(
+                           block_bench::block413567)],
+                       SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    SetBlockTransactionArena(false);
+    while (state.KeepRunning()) {
+        CBlock block;
+        stream >> block;
+        assert(stream.Rewind(sizeof(block_bench::block413567)));
+    }
+    SetBlockTransactionArena(DEFAULT_BLOCK_TX_ARENA);
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::State &state) {
     CDataStream stream((const char *)block_bench::block413567,
                        (const char *)&block_bench::block413567[sizeof(
@@ -58,4 +111,6 @@ static void DeserializeAndCheckBlockTest(benchmark::State &state) {
 }
 
 BENCHMARK(DeserializeBlockTest, 130);
+BENCHMARK(DeserializeBlockCopyTest, 130);
+BENCHMARK(DeserializeBlockNoArenaTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
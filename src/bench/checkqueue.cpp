@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <checkqueue.h>
+#include <hash.h>
 #include <prevector.h>
 #include <random.h>
 #include <util/system.h>
@@ -18,6 +19,10 @@ static const size_t BATCHES = 101;
 static const size_t BATCH_SIZE = 30;
 static const int PREVECTOR_SIZE = 28;
 static const size_t QUEUE_BATCH_SIZE = 128;
+// Roughly the shape of a large block: one Add per transaction.
+static const size_t SCALING_BATCHES = 4000;
+static const size_t SCALING_BATCH_SIZE = 2;
+static const int HASH_JOB_ROUNDS = 10;
 
 // This Benchmark tests the CheckQueue with a slightly realistic workload, where
 // checks all contain a prevector that is indirect 50% of the time and there is
@@ -56,3 +61,57 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State &state) {
     tg.join_all();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+
+// This Benchmark tests how the CheckQueue scales with the number of worker
+// threads, using checks that each take a small but non trivial amount of time
+// like signature checks do.
+static void CCheckQueueScaling(benchmark::State &state, int nThreads) {
+    struct HashJob {
+        uint256 hash;
+        HashJob() {}
+        explicit HashJob(FastRandomContext &insecure_rand)
+            : hash(insecure_rand.rand256()) {}
+        bool operator()() {
+            for (int i = 0; i < HASH_JOB_ROUNDS; i++) {
+                hash = Hash(hash.begin(), hash.end());
+            }
+            return true;
+        }
+        void swap(HashJob &x) { std::swap(hash, x.hash); };
+    };
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    // The master thread joins the workers when waiting, so start one less.
+    for (auto x = 0; x < nThreads - 1; ++x) {
+        tg.create_thread([&] { queue.Thread(); });
+    }
+    while (state.KeepRunning()) {
+        FastRandomContext insecure_rand(true);
+        CCheckQueueControl<HashJob> control(&queue);
+        std::vector<std::vector<HashJob>> vBatches(SCALING_BATCHES);
+        for (auto &vChecks : vBatches) {
+            vChecks.reserve(SCALING_BATCH_SIZE);
+            for (size_t x = 0; x < SCALING_BATCH_SIZE; ++x)
+                vChecks.emplace_back(insecure_rand);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+#define CHECKQUEUE_SCALING_BENCHMARK(threads)                                 \
+    static void CCheckQueueScaling##threads##Threads(                          \
+        benchmark::State &state) {                                             \
+        CCheckQueueScaling(state, threads);                                    \
+    }                                                                          \
+    BENCHMARK(CCheckQueueScaling##threads##Threads, 8);
+
+CHECKQUEUE_SCALING_BENCHMARK(1)
+CHECKQUEUE_SCALING_BENCHMARK(2)
+CHECKQUEUE_SCALING_BENCHMARK(4)
+CHECKQUEUE_SCALING_BENCHMARK(8)
+CHECKQUEUE_SCALING_BENCHMARK(16)
+CHECKQUEUE_SCALING_BENCHMARK(32)
+CHECKQUEUE_SCALING_BENCHMARK(64)
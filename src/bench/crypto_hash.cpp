@@ -54,6 +54,51 @@ static void SHA256D64_1024(benchmark::State &state) {
     }
 }
 
+/**
+ * Serialized transactions of typical sizes filling a 32MB block, as hashed to
+ * compute their txids.
+ */
+class BlockTransactionsData {
+public:
+    std::vector<uint8_t> data;
+    std::vector<const uint8_t *> inputs;
+    std::vector<size_t> lens;
+
+    BlockTransactionsData() : data(32 * 1000 * 1000) {
+        FastRandomContext rng(true);
+        std::vector<size_t> offsets;
+        for (size_t pos = 0; pos + 450 <= data.size();) {
+            offsets.push_back(pos);
+            lens.push_back(150 + rng.randrange(300));
+            pos += lens.back();
+        }
+        for (size_t offset : offsets) {
+            inputs.push_back(data.data() + offset);
+        }
+    }
+};
+
+static void SHA256D_32MB_OneByOne(benchmark::State &state) {
+    const BlockTransactionsData txs;
+    std::vector<uint256> hashes(txs.lens.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < hashes.size(); i++) {
+            CHash256()
+                .Write(txs.inputs[i], txs.lens[i])
+                .Finalize(hashes[i].begin());
+        }
+    }
+}
+
+static void SHA256D_32MB_Multi(benchmark::State &state) {
+    const BlockTransactionsData txs;
+    std::vector<uint256> hashes(txs.lens.size());
+    while (state.KeepRunning()) {
+        SHA256DMulti(hashes[0].begin(), txs.inputs.data(), txs.lens.data(),
+                     hashes.size());
+    }
+}
+
 static void SHA512(benchmark::State &state) {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
     std::vector<uint8_t> in(BUFFER_SIZE, 0);
@@ -91,5 +136,7 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D_32MB_OneByOne, 5);
+BENCHMARK(SHA256D_32MB_Multi, 5);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
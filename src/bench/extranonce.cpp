@@ -0,0 +1,74 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <miner.h>
+#include <pow.h>
+#include <primitives/transaction.h>
+#include <random.h>
+
+#include <cassert>
+
+// Roughly the number of transactions in a 32MB block.
+static const size_t BLOCK_32MB_TXS = 130000;
+// Number of blocks found in every benchmark iteration.
+static const int BLOCKS_PER_ITERATION = 10;
+
+/**
+ * Find blocks for a large regtest template as generatetoaddress does: roll the
+ * extranonce, then grind the nonce, which takes two tries on average on
+ * regtest. Rolling the extranonce is what dominates with large templates.
+ */
+static void GenerateLargeTemplate(benchmark::State &state, bool fUseBranch) {
+    SelectParams(CBaseChainParams::REGTEST);
+    const Consensus::Params &params = Params().GetConsensus();
+
+    // The transactions only need distinct ids.
+    FastRandomContext rng(true);
+    CBlockTemplate blocktemplate;
+    CBlock &block = blocktemplate.block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (size_t i = 1; i < BLOCK_32MB_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(TxId(rng.rand256()), 0));
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    blocktemplate.coinbaseMerkleBranch = BlockCoinbaseMerkleBranch(block);
+    block.nBits = UintToArith256(params.powLimit).GetCompact();
+
+    CBlockIndex indexPrev;
+    indexPrev.nHeight = 100;
+    unsigned int nExtraNonce = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < BLOCKS_PER_ITERATION; i++) {
+            IncrementExtraNonce(&block, &indexPrev, DEFAULT_MAX_BLOCK_SIZE,
+                                nExtraNonce,
+                                fUseBranch ? &blocktemplate.coinbaseMerkleBranch
+                                           : nullptr);
+            block.nNonce = 0;
+            while (!CheckProofOfWork(block.GetHash(), block.nBits, params)) {
+                ++block.nNonce;
+            }
+        }
+    }
+    assert(block.hashMerkleRoot == BlockMerkleRoot(block));
+}
+
+static void GenerateLargeTemplateCoinbaseBranch(benchmark::State &state) {
+    GenerateLargeTemplate(state, true);
+}
+static void GenerateLargeTemplateFullMerkleRoot(benchmark::State &state) {
+    GenerateLargeTemplate(state, false);
+}
+
+BENCHMARK(GenerateLargeTemplateCoinbaseBranch, 1000);
+BENCHMARK(GenerateLargeTemplateFullMerkleRoot, 2);
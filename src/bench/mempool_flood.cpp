@@ -0,0 +1,182 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <config.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <key.h>
+#include <policy/policy.h>
+#include <pubkey.h>
+#include <scheduler.h>
+#include <script/interpreter.h>
+#include <script/scriptcache.h>
+#include <script/sigcache.h>
+#include <script/standard.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/thread.hpp>
+
+#include <cassert>
+#include <thread>
+#include <vector>
+
+// Number of transactions submitted at once in every benchmark iteration. The
+// number of transactions accepted per second is FLOOD_SIZE divided by the time
+// of an iteration.
+static const int FLOOD_SIZE = 2000;
+
+/**
+ * A regtest node in a scratch data directory, and FLOOD_SIZE signed
+ * transactions spending a P2PKH coin each.
+ */
+class TxFlood {
+private:
+    ECCVerifyHandle verifyHandle;
+    fs::path path;
+    CScheduler scheduler;
+    std::thread schedulerThread;
+
+public:
+    std::vector<CTransactionRef> txs;
+
+    TxFlood()
+        : path(fs::temp_directory_path() /
+               fs::unique_path("bench_mempool_%%%%-%%%%-%%%%")) {
+        fs::create_directories(path);
+        gArgs.ForceSetArg("-datadir", path.string());
+        SelectParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+
+        schedulerThread = std::thread([this] { scheduler.serviceQueue(); });
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+        const Config &config = GetConfig();
+        pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        assert(LoadGenesisBlock(config.GetChainParams()));
+        CValidationState state;
+        assert(ActivateBestChain(config, state));
+
+        CKey key;
+        key.MakeNewKey(true);
+        const CScript scriptPubKey =
+            GetScriptForDestination(key.GetPubKey().GetID());
+        const Amount nValue = COIN;
+
+        // The coins spent are added to the UTXO set directly.
+        CMutableTransaction funding;
+        funding.vout.assign(FLOOD_SIZE, CTxOut(nValue, scriptPubKey));
+        {
+            LOCK(cs_main);
+            AddCoins(*pcoinsTip, CTransaction(funding), 0);
+        }
+
+        const SigHashType sigHashType = SigHashType().withForkId();
+        for (int i = 0; i < FLOOD_SIZE; i++) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(funding.GetId(), i));
+            tx.vout.emplace_back(nValue - 1000 * SATOSHI, scriptPubKey);
+
+            const uint256 hash = SignatureHash(scriptPubKey, CTransaction(tx),
+                                               0, sigHashType, nValue);
+            std::vector<uint8_t> vchSig;
+            assert(key.SignECDSA(hash, vchSig));
+            vchSig.push_back(uint8_t(sigHashType.getRawSigHashType()));
+            tx.vin[0].scriptSig = CScript() << vchSig
+                                            << ToByteVector(key.GetPubKey());
+            txs.push_back(MakeTransactionRef(tx));
+        }
+    }
+
+    //! Empty the mempool, and forget about the signatures already checked.
+    void Reset() {
+        g_mempool.clear();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+    }
+
+    ~TxFlood() {
+        g_mempool.clear();
+        scheduler.stop(false);
+        schedulerThread.join();
+        GetMainSignals().FlushBackgroundCallbacks();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+        UnloadBlockIndex();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+        pblocktree.reset();
+        ClearDatadirCache();
+        fs::remove_all(path);
+    }
+};
+
+// Accept the transactions one by one, with their scripts checked while
+// holding cs_main, as they are relayed.
+static void MempoolFloodSerial(benchmark::State &state) {
+    TxFlood flood;
+    const Config &config = GetConfig();
+    while (state.KeepRunning()) {
+        flood.Reset();
+        LOCK(cs_main);
+        for (const CTransactionRef &tx : flood.txs) {
+            CValidationState validationState;
+            assert(AcceptToMemoryPool(config, g_mempool, validationState, tx,
+                                      false, nullptr));
+        }
+    }
+}
+
+// Accept the transactions as a batch, with their scripts checked on the given
+// number of script check threads, including the calling thread.
+static void MempoolFloodBatch(benchmark::State &state, int nThreads) {
+    TxFlood flood;
+    const Config &config = GetConfig();
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadScriptCheck);
+    }
+    nScriptCheckThreads = nThreads > 1 ? nThreads : 0;
+
+    while (state.KeepRunning()) {
+        flood.Reset();
+        std::vector<bool> vAccepted;
+        std::vector<CValidationState> states;
+        std::vector<bool> vMissingInputs;
+        assert(AcceptToMemoryPoolBatch(config, g_mempool, flood.txs,
+                                       vAccepted, states, vMissingInputs,
+                                       false) == flood.txs.size());
+    }
+
+    nScriptCheckThreads = 0;
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+static void MempoolFloodBatch1Thread(benchmark::State &state) {
+    MempoolFloodBatch(state, 1);
+}
+static void MempoolFloodBatch2Threads(benchmark::State &state) {
+    MempoolFloodBatch(state, 2);
+}
+static void MempoolFloodBatch4Threads(benchmark::State &state) {
+    MempoolFloodBatch(state, 4);
+}
+static void MempoolFloodBatch8Threads(benchmark::State &state) {
+    MempoolFloodBatch(state, 8);
+}
+
+BENCHMARK(MempoolFloodSerial, 5);
+BENCHMARK(MempoolFloodBatch1Thread, 5);
+BENCHMARK(MempoolFloodBatch2Threads, 5);
+BENCHMARK(MempoolFloodBatch4Threads, 5);
+BENCHMARK(MempoolFloodBatch8Threads, 5);
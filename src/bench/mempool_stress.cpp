@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <consensus/consensus.h>
+#include <policy/policy.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+// Depth of the chain of unconfirmed transactions in the mempool.
+static const int CHAIN_DEPTH = 10000;
+// Number of transactions at the start of the chain found in a block.
+static const int BLOCK_TXS = 100;
+
+static void AddTx(const CTransactionRef &tx, CTxMemPool &pool)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs) {
+    LockPoints lp;
+    pool.addUnchecked(tx->GetId(),
+                      CTxMemPoolEntry(tx, 1000 * SATOSHI, 0, 10.0, 1,
+                                      tx->GetValueOut(), false, 1, lp));
+}
+
+/**
+ * A chain of CHAIN_DEPTH transactions, each spending the only output of the
+ * previous one, as chained payouts do.
+ */
+static std::vector<CTransactionRef> CreateChain() {
+    std::vector<CTransactionRef> chain;
+    TxId prevId;
+    for (int i = 0; i < CHAIN_DEPTH; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(prevId, 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = (CHAIN_DEPTH - i) * COIN;
+        chain.push_back(MakeTransactionRef(tx));
+        prevId = chain.back()->GetId();
+    }
+    return chain;
+}
+
+// Mine the start of the chain, then disconnect that block again, with the rest
+// of the chain in the mempool.
+static void MempoolLongChainBlock(benchmark::State &state) {
+    const std::vector<CTransactionRef> chain = CreateChain();
+    const std::vector<CTransactionRef> block(chain.begin(),
+                                             chain.begin() + BLOCK_TXS);
+    std::vector<TxId> blockTxIds;
+    for (const CTransactionRef &tx : block) {
+        blockTxIds.push_back(tx->GetId());
+    }
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    for (const CTransactionRef &tx : chain) {
+        AddTx(tx, pool);
+    }
+
+    while (state.KeepRunning()) {
+        pool.removeForBlock(block, 1);
+        for (const CTransactionRef &tx : block) {
+            AddTx(tx, pool);
+        }
+        pool.UpdateTransactionsFromBlock(blockTxIds);
+    }
+    assert(pool.size() == chain.size());
+}
+
+// Add a transaction at the end of the chain after checking the limits, and
+// evict it again.
+static void MempoolLongChainTip(benchmark::State &state) {
+    const std::vector<CTransactionRef> chain = CreateChain();
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(chain.back()->GetId(), 0);
+    mtx.vin[0].scriptSig = CScript() << OP_1;
+    mtx.vout.resize(1);
+    mtx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    mtx.vout[0].nValue = COIN / 2;
+    const CTransactionRef tx = MakeTransactionRef(mtx);
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    for (const CTransactionRef &chainTx : chain) {
+        AddTx(chainTx, pool);
+    }
+
+    LockPoints lp;
+    const CTxMemPoolEntry entry(tx, 1000 * SATOSHI, 0, 10.0, 1,
+                                tx->GetValueOut(), false, 1, lp);
+    const uint64_t nLimit = CHAIN_DEPTH + 1;
+    while (state.KeepRunning()) {
+        CTxMemPool::setEntries setAncestors;
+        std::string errString;
+        assert(pool.CalculateMemPoolAncestors(
+            entry, setAncestors, nLimit, nLimit * MAX_TX_SIZE, nLimit,
+            nLimit * MAX_TX_SIZE, errString));
+        pool.addUnchecked(tx->GetId(), entry, setAncestors);
+        pool.removeRecursive(*tx);
+    }
+}
+
+BENCHMARK(MempoolLongChainBlock, 2);
+BENCHMARK(MempoolLongChainTip, 100);
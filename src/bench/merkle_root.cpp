@@ -23,4 +23,31 @@ static void MerkleRoot(benchmark::State &state) {
     }
 }
 
+// Roughly the number of transactions in a 32MB block.
+static const size_t BLOCK_32MB_LEAVES = 130000;
+
+static void MerkleRoot32MB(benchmark::State &state, unsigned int nThreads) {
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves(BLOCK_32MB_LEAVES);
+    for (auto &item : leaves) {
+        item = rng.rand256();
+    }
+    while (state.KeepRunning()) {
+        bool mutation = false;
+        uint256 hash = ComputeMerkleRoot(std::vector<uint256>(leaves),
+                                         &mutation, nThreads);
+        leaves[mutation] = hash;
+    }
+}
+
+static void MerkleRoot32MBOneThread(benchmark::State &state) {
+    MerkleRoot32MB(state, 1);
+}
+
+static void MerkleRoot32MBParallel(benchmark::State &state) {
+    MerkleRoot32MB(state, 0);
+}
+
 BENCHMARK(MerkleRoot, 800);
+BENCHMARK(MerkleRoot32MBOneThread, 20);
+BENCHMARK(MerkleRoot32MBParallel, 20);
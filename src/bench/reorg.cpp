@@ -0,0 +1,189 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <config.h>
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <miner.h>
+#include <pow.h>
+#include <scheduler.h>
+#include <script/scriptcache.h>
+#include <script/sigcache.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Number of blocks disconnected and connected again by each reorg.
+static const int REORG_DEPTH = 20;
+// Number of coins every one of these blocks spends and creates.
+static const int COINS_PER_BLOCK = 2000;
+// Number of inputs and outputs of their transactions.
+static const int COINS_PER_TX = 100;
+
+/**
+ * A regtest chain in a scratch data directory, ending with REORG_DEPTH blocks
+ * which each spend all the coins created by the block before them.
+ */
+class RegtestChain {
+private:
+    fs::path path;
+    CScheduler scheduler;
+    std::thread schedulerThread;
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+
+    void Mine(const std::vector<CMutableTransaction> &txns) {
+        const Config &config = GetConfig();
+        std::unique_ptr<CBlockTemplate> pblocktemplate =
+            BlockAssembler(config, g_mempool).CreateNewBlock(scriptPubKey);
+        CBlock &block = pblocktemplate->block;
+        block.vtx.resize(1);
+        for (const CMutableTransaction &tx : txns) {
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        std::sort(block.vtx.begin() + 1, block.vtx.end(),
+                  [](const CTransactionRef &a, const CTransactionRef &b) {
+                      return a->GetId() < b->GetId();
+                  });
+        {
+            LOCK(cs_main);
+            unsigned int nExtraNonce = 0;
+            IncrementExtraNonce(&block, chainActive.Tip(),
+                                config.GetMaxBlockSize(), nExtraNonce);
+        }
+        const Consensus::Params &params =
+            config.GetChainParams().GetConsensus();
+        while (!CheckProofOfWork(block.GetHash(), block.nBits, params)) {
+            ++block.nNonce;
+        }
+        assert(ProcessNewBlock(config, std::make_shared<const CBlock>(block),
+                               true, nullptr));
+    }
+
+public:
+    //! The first of the blocks to reorg
+    CBlockIndex *pindexFork;
+
+    RegtestChain()
+        : path(fs::temp_directory_path() /
+               fs::unique_path("bench_reorg_%%%%-%%%%-%%%%")) {
+        fs::create_directories(path);
+        gArgs.ForceSetArg("-datadir", path.string());
+        SelectParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+
+        schedulerThread = std::thread([this] { scheduler.serviceQueue(); });
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+        const Config &config = GetConfig();
+        pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        assert(LoadGenesisBlock(config.GetChainParams()));
+        CValidationState state;
+        assert(ActivateBestChain(config, state));
+
+        // Mature a coinbase, and split it into the coins to spend.
+        for (int i = 0; i <= COINBASE_MATURITY; i++) {
+            Mine({});
+        }
+        CTransactionRef coinbase;
+        {
+            LOCK(cs_main);
+            CBlock block;
+            assert(ReadBlockFromDisk(block, chainActive[1],
+                                     config.GetChainParams().GetConsensus()));
+            coinbase = block.vtx[0];
+        }
+        const Amount nValue =
+            coinbase->vout[0].nValue / (COINS_PER_BLOCK + 1);
+        CMutableTransaction split;
+        split.vin.emplace_back(COutPoint(coinbase->GetId(), 0));
+        split.vout.assign(COINS_PER_BLOCK, CTxOut(nValue, scriptPubKey));
+        Mine({split});
+
+        std::vector<COutPoint> vCoins;
+        for (int i = 0; i < COINS_PER_BLOCK; i++) {
+            vCoins.emplace_back(split.GetId(), i);
+        }
+        for (int i = 0; i < REORG_DEPTH; i++) {
+            std::vector<CMutableTransaction> txns(COINS_PER_BLOCK /
+                                                  COINS_PER_TX);
+            for (size_t j = 0; j < vCoins.size(); j++) {
+                CMutableTransaction &tx = txns[j / COINS_PER_TX];
+                tx.vin.emplace_back(vCoins[j]);
+                tx.vout.emplace_back(nValue - (i + 1) * SATOSHI,
+                                     scriptPubKey);
+            }
+            vCoins.clear();
+            for (const CMutableTransaction &tx : txns) {
+                for (size_t n = 0; n < tx.vout.size(); n++) {
+                    vCoins.emplace_back(tx.GetId(), n);
+                }
+            }
+            Mine(txns);
+        }
+
+        LOCK(cs_main);
+        pindexFork = chainActive[chainActive.Height() - REORG_DEPTH + 1];
+    }
+
+    ~RegtestChain() {
+        scheduler.stop(false);
+        schedulerThread.join();
+        GetMainSignals().FlushBackgroundCallbacks();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+        UnloadBlockIndex();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+        pblocktree.reset();
+        ClearDatadirCache();
+        fs::remove_all(path);
+    }
+};
+
+// Disconnect the last blocks of the chain, which sends their transactions
+// back to the mempool, and connect them again.
+static void Reorg(benchmark::State &state, int64_t nUndoCache) {
+    RegtestChain chain;
+    gArgs.ForceSetArg("-undocache", std::to_string(nUndoCache));
+    InitUndoCache();
+
+    const Config &config = GetConfig();
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        assert(InvalidateBlock(config, validationState, chain.pindexFork));
+        {
+            LOCK(cs_main);
+            ResetBlockFailureFlags(chain.pindexFork);
+        }
+        assert(ActivateBestChain(config, validationState));
+        SyncWithValidationInterfaceQueue();
+    }
+
+    gArgs.ClearArg("-undocache");
+    InitUndoCache();
+}
+
+static void ReorgUndoCache(benchmark::State &state) {
+    Reorg(state, REORG_DEPTH);
+}
+static void ReorgFromDisk(benchmark::State &state) {
+    Reorg(state, 0);
+}
+
+BENCHMARK(ReorgUndoCache, 5);
+BENCHMARK(ReorgFromDisk, 5);
@@ -0,0 +1,63 @@
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <primitives/transaction.h>
+#include <pubkey.h>
+#include <script/sigcache.h>
+#include <uint256.h>
+
+#include <vector>
+
+// Roughly the number of Schnorr signed inputs in a 200kB block.
+static const size_t BLOCK_SIGS = 1000;
+
+static std::vector<DeferredSchnorrSig>
+MakeSyntheticBlockSigs(const CTransaction &tx) {
+    std::vector<DeferredSchnorrSig> sigs;
+    sigs.reserve(BLOCK_SIGS);
+    for (size_t i = 0; i < BLOCK_SIGS; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        uint256 sighash;
+        sighash.begin()[0] = i;
+        sighash.begin()[1] = i >> 8;
+        std::vector<uint8_t> vchSig;
+        assert(key.SignSchnorr(sighash, vchSig));
+        sigs.push_back({vchSig, key.GetPubKey(), sighash, uint256(), false,
+                        &tx, uint32_t(i)});
+    }
+    return sigs;
+}
+
+// Verify every signature on its own, as script checks do without batching.
+static void SchnorrVerifyIndividual(benchmark::State &state) {
+    ECCVerifyHandle verifyHandle;
+    const CTransaction tx;
+    const std::vector<DeferredSchnorrSig> sigs = MakeSyntheticBlockSigs(tx);
+    while (state.KeepRunning()) {
+        for (const DeferredSchnorrSig &sig : sigs) {
+            assert(sig.pubkey.VerifySchnorr(sig.sighash, sig.vchSig));
+        }
+    }
+}
+
+// Feed the signatures one input at a time to a batch, as ConnectBlock does.
+static void SchnorrVerifyBatch(benchmark::State &state) {
+    ECCVerifyHandle verifyHandle;
+    const CTransaction tx;
+    const std::vector<DeferredSchnorrSig> sigs = MakeSyntheticBlockSigs(tx);
+    while (state.KeepRunning()) {
+        SchnorrSignatureBatch batch;
+        for (const DeferredSchnorrSig &sig : sigs) {
+            std::vector<DeferredSchnorrSig> input{sig};
+            assert(batch.Add(std::move(input)));
+        }
+        assert(batch.Flush());
+    }
+}
+
+BENCHMARK(SchnorrVerifyIndividual, 20);
+BENCHMARK(SchnorrVerifyBatch, 40);
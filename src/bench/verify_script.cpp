@@ -0,0 +1,144 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2019 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <policy/policy.h>
+#include <primitives/transaction.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/standard.h>
+
+#include <vector>
+
+/**
+ * A checker which accepts every signature, so that the benchmarks measure the
+ * script evaluation rather than the elliptic curve operations. The signature
+ * hash is still computed.
+ */
+class AcceptingSignatureChecker : public TransactionSignatureChecker {
+public:
+    AcceptingSignatureChecker(const CTransaction *txToIn, unsigned int nInIn,
+                              const Amount amountIn,
+                              const PrecomputedTransactionData &txdataIn)
+        : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn) {}
+
+    bool VerifySignature(const std::vector<uint8_t> &vchSig,
+                         const CPubKey &vchPubKey,
+                         const uint256 &sighash) const override {
+        return true;
+    }
+};
+
+static CMutableTransaction BuildCreditingTransaction(const CScript &scriptPubKey) {
+    CMutableTransaction txCredit;
+    txCredit.nVersion = 1;
+    txCredit.nLockTime = 0;
+    txCredit.vin.resize(1);
+    txCredit.vout.resize(1);
+    txCredit.vin[0].prevout = COutPoint();
+    txCredit.vin[0].scriptSig = CScript();
+    txCredit.vin[0].nSequence = CTxIn::SEQUENCE_FINAL;
+    txCredit.vout[0].scriptPubKey = scriptPubKey;
+    txCredit.vout[0].nValue = 1 * SATOSHI;
+
+    return txCredit;
+}
+
+static CMutableTransaction
+BuildSpendingTransaction(const CScript &scriptSig,
+                         const CMutableTransaction &txCredit) {
+    CMutableTransaction txSpend;
+    txSpend.nVersion = 1;
+    txSpend.nLockTime = 0;
+    txSpend.vin.resize(1);
+    txSpend.vout.resize(1);
+    txSpend.vin[0].prevout = COutPoint(txCredit.GetId(), 0);
+    txSpend.vin[0].scriptSig = scriptSig;
+    txSpend.vin[0].nSequence = CTxIn::SEQUENCE_FINAL;
+    txSpend.vout[0].scriptPubKey = CScript();
+    txSpend.vout[0].nValue = txCredit.vout[0].nValue;
+
+    return txSpend;
+}
+
+// A DER signature of typical length, with SIGHASH_ALL | SIGHASH_FORKID.
+static std::vector<uint8_t> DummySignature() {
+    std::vector<uint8_t> vchSig(71, 0x01);
+    vchSig[0] = 0x30;
+    vchSig[1] = 68;
+    vchSig[2] = 0x02;
+    vchSig[3] = 32;
+    vchSig[36] = 0x02;
+    vchSig[37] = 32;
+    vchSig[70] = SIGHASH_ALL | SIGHASH_FORKID;
+    return vchSig;
+}
+
+static void VerifyScriptBench(benchmark::State &state,
+                              const CScript &scriptPubKey,
+                              const CScript &scriptSig, bool fGeneric) {
+    const uint32_t flags =
+        STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_SIGHASH_FORKID;
+    const CMutableTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
+    const CTransaction txSpend(BuildSpendingTransaction(scriptSig, txCredit));
+    const PrecomputedTransactionData txdata(txSpend);
+    while (state.KeepRunning()) {
+        AcceptingSignatureChecker checker(&txSpend, 0,
+                                          txCredit.vout[0].nValue, txdata);
+        ScriptError err;
+        bool fSuccess =
+            fGeneric ? VerifyScriptGeneric(scriptSig, scriptPubKey, flags,
+                                           checker, &err)
+                     : VerifyScript(scriptSig, scriptPubKey, flags, checker,
+                                    &err);
+        assert(fSuccess && err == ScriptError::OK);
+    }
+}
+
+static void VerifyScriptP2PKHBench(benchmark::State &state, bool fGeneric) {
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    VerifyScriptBench(state, GetScriptForDestination(pubkey.GetID()),
+                      CScript() << DummySignature() << ToByteVector(pubkey),
+                      fGeneric);
+}
+
+static void VerifyScriptP2SHMultisigBench(benchmark::State &state,
+                                          bool fGeneric) {
+    std::vector<CPubKey> pubkeys;
+    for (int i = 0; i < 3; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        pubkeys.push_back(key.GetPubKey());
+    }
+    const CScript redeemScript = GetScriptForMultisig(2, pubkeys);
+    VerifyScriptBench(state, GetScriptForDestination(CScriptID(redeemScript)),
+                      CScript() << OP_0 << DummySignature() << DummySignature()
+                                << ToByteVector(redeemScript),
+                      fGeneric);
+}
+
+static void VerifyScriptP2PKH(benchmark::State &state) {
+    VerifyScriptP2PKHBench(state, false);
+}
+
+static void VerifyScriptP2PKHGeneric(benchmark::State &state) {
+    VerifyScriptP2PKHBench(state, true);
+}
+
+static void VerifyScriptP2SHMultisig(benchmark::State &state) {
+    VerifyScriptP2SHMultisigBench(state, false);
+}
+
+static void VerifyScriptP2SHMultisigGeneric(benchmark::State &state) {
+    VerifyScriptP2SHMultisigBench(state, true);
+}
+
+BENCHMARK(VerifyScriptP2PKH, 300 * 1000);
+BENCHMARK(VerifyScriptP2PKHGeneric, 300 * 1000);
+BENCHMARK(VerifyScriptP2SHMultisig, 100 * 1000);
+BENCHMARK(VerifyScriptP2SHMultisigGeneric, 100 * 1000);
@@ -5,6 +5,31 @@
 
 #include <chain.h>
 
+CBlockIndex *CBlockIndexArena::Allocate() {
+    if (nUsed == CHUNK_SIZE) {
+        vChunks.emplace_back(new CBlockIndex[CHUNK_SIZE]);
+        pCurrent = vChunks.back().get();
+        nUsed = 0;
+    }
+    nSize++;
+    return &pCurrent[nUsed++];
+}
+
+CBlockIndex *CBlockIndexArena::AllocateBulk(size_t n) {
+    // Bulk allocations get their own chunk, so that Allocate() keeps filling
+    // its current one.
+    vChunks.emplace_back(new CBlockIndex[n]);
+    nSize += n;
+    return vChunks.back().get();
+}
+
+void CBlockIndexArena::Clear() {
+    vChunks.clear();
+    pCurrent = nullptr;
+    nUsed = CHUNK_SIZE;
+    nSize = 0;
+}
+
 /**
  * CChain implementation
  */
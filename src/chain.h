@@ -16,6 +16,7 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -49,9 +50,9 @@ static constexpr int64_t MAX_BLOCK_TIME_GAP = 90 * 60;
  */
 class CBlockIndex {
 public:
-    //! pointer to the hash of the block, if any. Memory is owned by this
-    //! CBlockIndex
-    const uint256 *phashBlock;
+    // The fields that walks over the block index and work comparisons use
+    // come first and are packed in 64 bytes, so that these touch as few cache
+    // lines as possible.
 
     //! pointer to the index of the predecessor of this block
     CBlockIndex *pprev;
@@ -59,9 +60,31 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex *pskip;
 
+    //! (memory only) Total amount of work (expected number of hashes) in the
+    //! chain up to and including this block
+    arith_uint256 nChainWork;
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
+    //! Verification status of this block. See enum BlockStatus
+    BlockStatus nStatus;
+
+    //! (memory only) Sequential id assigned to distinguish order in which
+    //! blocks are received.
+    int32_t nSequenceId;
+
+    //! (memory only) Number of transactions in the chain up to and including
+    //! this block.
+    //! This value will be non-zero only if and only if transactions for this
+    //! block and all its parents are available. Change to 64-bit type when
+    //! necessary; won't happen before 2030
+    unsigned int nChainTx;
+
+    //! pointer to the hash of the block, if any. Memory is owned by this
+    //! CBlockIndex
+    const uint256 *phashBlock;
+
     //! Which # file this block is stored in (blk?????.dat)
     int nFile;
 
@@ -71,25 +94,11 @@ public:
     //! Byte offset within rev?????.dat where this block's undo data is stored
     unsigned int nUndoPos;
 
-    //! (memory only) Total amount of work (expected number of hashes) in the
-    //! chain up to and including this block
-    arith_uint256 nChainWork;
-
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied
     //! upon
     unsigned int nTx;
 
-    //! (memory only) Number of transactions in the chain up to and including
-    //! this block.
-    //! This value will be non-zero only if and only if transactions for this
-    //! block and all its parents are available. Change to 64-bit type when
-    //! necessary; won't happen before 2030
-    unsigned int nChainTx;
-
-    //! Verification status of this block. See enum BlockStatus
-    BlockStatus nStatus;
-
     //! block header
     int32_t nVersion;
     uint256 hashMerkleRoot;
@@ -97,16 +106,12 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
-    //! (memory only) Sequential id assigned to distinguish order in which
-    //! blocks are received.
-    int32_t nSequenceId;
+    //! (memory only) Maximum nTime in the chain up to and including this block.
+    unsigned int nTimeMax;
 
     //! (memory only) block header metadata
     uint64_t nTimeReceived;
 
-    //! (memory only) Maximum nTime in the chain up to and including this block.
-    unsigned int nTimeMax;
-
     void SetNull() {
         phashBlock = nullptr;
         pprev = nullptr;
@@ -239,6 +244,41 @@ public:
     const CBlockIndex *GetAncestor(int height) const;
 };
 
+/**
+ * Owns CBlockIndex entries. They are allocated in chunks rather than one by
+ * one, and can only be freed all at once.
+ */
+class CBlockIndexArena {
+private:
+    //! Number of entries in the chunks Allocate() hands out entries from
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    std::vector<std::unique_ptr<CBlockIndex[]>> vChunks;
+    //! The chunk Allocate() hands out entries from, and how many it did
+    CBlockIndex *pCurrent = nullptr;
+    size_t nUsed = CHUNK_SIZE;
+    //! Number of entries allocated
+    size_t nSize = 0;
+
+public:
+    CBlockIndexArena() = default;
+    CBlockIndexArena(const CBlockIndexArena &) = delete;
+    CBlockIndexArena &operator=(const CBlockIndexArena &) = delete;
+    CBlockIndexArena(CBlockIndexArena &&) = default;
+    CBlockIndexArena &operator=(CBlockIndexArena &&) = default;
+
+    //! Allocate a null entry.
+    CBlockIndex *Allocate();
+
+    //! Allocate n contiguous null entries.
+    CBlockIndex *AllocateBulk(size_t n);
+
+    //! Free all entries.
+    void Clear();
+
+    size_t Size() const { return nSize; }
+};
+
 /**
  * Maintain a map of CBlockIndex for all known headers.
  */
@@ -8,6 +8,9 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -24,10 +27,28 @@ template <typename T> class CCheckQueueControl;
  * queue, where they are processed by N-1 worker threads. When the master is
  * done adding work, it temporarily joins the worker pool as an N'th worker,
  * until all jobs are done.
+ *
+ * Verifications are spread over per-worker deques in chunks as they are
+ * added. Each worker takes batches from the back of its own deque, and steals
+ * from the front of the others' when it runs dry, so workers never contend on
+ * a single lock. The shared mutex is only taken to sleep and wake up.
  */
 template <typename T> class CCheckQueue {
 private:
-    //! Mutex to protect the inner state
+    /**
+     * A deque of verifications, owned by one or more workers. The owners pop
+     * from the back, other workers steal from the front.
+     */
+    struct WorkerQueue {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! Number of worker deques. Slot 0 belongs to the master, the workers
+    //! share the others if there are more of them than slots.
+    static const unsigned int MAX_SLOTS = 64;
+
+    //! Mutex protecting the sleep and wake-up of workers
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -36,91 +57,112 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The per-worker queues of elements to be processed.
+    std::unique_ptr<WorkerQueue[]> slots;
+
+    //! The number of slots that have an owner, including the master's.
+    std::atomic<unsigned int> nActiveSlots;
+
+    //! The number of workers (excluding the master) that registered.
+    std::atomic<unsigned int> nWorkers;
+
+    //! The slot the next chunk of verifications is pushed to.
+    unsigned int nNextSlot;
 
     //! The number of workers (including the master) that are idle.
-    int nIdle;
+    std::atomic<int> nIdle;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of elements queued in the slots.
+    std::atomic<int64_t> nQueued;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    /**
+     * Move a batch of elements from the back (own slot) or the front (stolen)
+     * of a slot into vChecks, and return its size.
+     */
+    unsigned int Take(WorkerQueue &slot, std::vector<T> &vChecks, bool fOwn) {
+        boost::unique_lock<boost::mutex> lock(slot.mutex);
+        const unsigned int nSize = slot.checks.size();
+        if (nSize == 0) {
+            return 0;
+        }
+        // Take at most half of the slot, so batches get increasingly smaller
+        // and all workers finish approximately simultaneously. Don't do
+        // batches larger than nBatchSize.
+        const unsigned int nNow = std::min(nBatchSize, (nSize + 1) / 2);
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // We want the lock on the mutex to be as short as possible, so
+            // swap jobs from the slot to the local batch vector instead of
+            // copying.
+            if (fOwn) {
+                vChecks[i].swap(slot.checks.back());
+                slot.checks.pop_back();
+            } else {
+                vChecks[i].swap(slot.checks.front());
+                slot.checks.pop_front();
+            }
+        }
+        nQueued -= nNow;
+        return nNow;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false) {
-        boost::condition_variable &cond = fMaster ? condMaster : condWorker;
+        unsigned int nSlot = 0;
+        if (!fMaster) {
+            const unsigned int nWorker = nWorkers++;
+            nSlot = 1 + nWorker % (MAX_SLOTS - 1);
+            unsigned int nActive = nActiveSlots;
+            while (nActive < nSlot + 1 &&
+                   !nActiveSlots.compare_exchange_weak(nActive, nSlot + 1)) {
+            }
+        }
+
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            // Pick work from our own slot first, then try to steal from the
+            // others.
+            unsigned int nNow = Take(slots[nSlot], vChecks, true);
+            const unsigned int nActive = nActiveSlots;
+            for (unsigned int i = 1; nNow == 0 && i < nActive; i++) {
+                nNow = Take(slots[(nSlot + i) % nActive], vChecks, false);
+            }
+
+            if (nNow == 0) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us
-                // to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster) {
-                        // We processed the last element; inform the master it
-                        // can exit and return the result
-                        condMaster.notify_one();
-                    }
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
+                nIdle++;
+                // nIdle is incremented before nQueued is checked, while Add
+                // does the opposite, so either we see the new elements or
+                // Add sees us idle and wakes us up.
+                while (nQueued == 0) {
                     if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster) {
-                            fAllOk = true;
-                        }
-                        // return the current status
-                        return fRet;
+                        nIdle--;
+                        // return the current status, and reset it for new
+                        // work later
+                        return fAllOk.exchange(true);
                     }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+                    (fMaster ? condMaster : condWorker).wait(lock);
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for
-                // increasingly smaller batches so all workers finish
-                // approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start
-                // helping.
-                // * Don't do batches smaller than 1 (duh), or larger than
-                // nBatchSize.
-                nNow = std::max(
-                    1U, std::min(nBatchSize, (unsigned int)queue.size() /
-                                                 (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible,
-                    // so swap jobs from the global queue to the local batch
-                    // vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                nIdle--;
+                continue;
             }
+
+            // Check whether we need to do work at all
+            bool fOk = fAllOk;
             // execute work
             for (T &check : vChecks) {
                 if (fOk) {
@@ -128,6 +170,15 @@ private:
                 }
             }
             vChecks.clear();
+            if (!fOk) {
+                fAllOk = false;
+            }
+            if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                // We processed the last element; inform the master it can
+                // exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
@@ -137,7 +188,8 @@ public:
 
     //! Create a new check queue
     explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nIdle(0), nTotal(0), fAllOk(true), nTodo(0),
+        : slots(new WorkerQueue[MAX_SLOTS]), nActiveSlots(1), nWorkers(0),
+          nNextSlot(0), nIdle(0), nQueued(0), fAllOk(true), nTodo(0),
           nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
@@ -149,16 +201,36 @@ public:
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T> &vChecks) {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T &check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) {
+            return;
         }
+        // Account for the new elements before they become visible, so that
+        // nothing finishes them before they are counted.
         nTodo += vChecks.size();
-        if (vChecks.size() == 1) {
-            condWorker.notify_one();
-        } else if (vChecks.size() > 1) {
-            condWorker.notify_all();
+        nQueued += vChecks.size();
+
+        // Spread the checks over the slots in chunks of at most nBatchSize
+        // elements, round robin.
+        const unsigned int nActive = nActiveSlots;
+        auto it = vChecks.begin();
+        while (it != vChecks.end()) {
+            const size_t nChunk =
+                std::min<size_t>(nBatchSize, vChecks.end() - it);
+            WorkerQueue &slot = slots[nNextSlot++ % nActive];
+            boost::unique_lock<boost::mutex> lock(slot.mutex);
+            for (size_t i = 0; i < nChunk; i++, ++it) {
+                slot.checks.emplace_back();
+                it->swap(slot.checks.back());
+            }
+        }
+
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1) {
+                condWorker.notify_one();
+            } else {
+                condWorker.notify_all();
+            }
         }
     }
 
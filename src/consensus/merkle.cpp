@@ -6,6 +6,11 @@
 #include <hash.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#ifndef BUILD_BITCOIN_INTERNAL
+#include <thread>
+#endif
+
 /*     WARNING! If you're reading this because you're learning about crypto
        and/or designing a new system that will use merkle trees, keep in mind
        that the following merkle tree algorithm has a serious flaw related to
@@ -42,7 +47,46 @@
        root.
 */
 
-uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated) {
+/**
+ * Hash the pairs of a level of the tree into the next one, splitting the work
+ * between nThreads threads.
+ */
+static void ComputeMerkleLevel(std::vector<uint256> &hashes,
+                               unsigned int nThreads) {
+    const size_t nPairs = hashes.size() / 2;
+#ifndef BUILD_BITCOIN_INTERNAL
+    if (nThreads > 1 && nPairs >= MERKLE_PARALLEL_MIN_LEAVES / 2) {
+        // The pairs cannot be hashed in place, as each thread would overwrite
+        // the input of the previous one.
+        std::vector<uint256> next(nPairs);
+        const size_t nPerThread = (nPairs + nThreads - 1) / nThreads;
+        std::vector<std::thread> threads;
+        for (size_t begin = 0; begin < nPairs; begin += nPerThread) {
+            const size_t count = std::min(nPerThread, nPairs - begin);
+            threads.emplace_back([&hashes, &next, begin, count] {
+                SHA256D64(next[begin].begin(), hashes[2 * begin].begin(),
+                          count);
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        hashes.swap(next);
+        return;
+    }
+#endif
+    SHA256D64(hashes[0].begin(), hashes[0].begin(), nPairs);
+    hashes.resize(nPairs);
+}
+
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated,
+                          unsigned int nThreads) {
+#ifndef BUILD_BITCOIN_INTERNAL
+    if (nThreads == 0) {
+        nThreads = std::min(std::max(std::thread::hardware_concurrency(), 1U),
+                            MAX_MERKLE_THREADS);
+    }
+#endif
     bool mutation = false;
     while (hashes.size() > 1) {
         if (mutated) {
@@ -53,8 +97,7 @@ uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated) {
         if (hashes.size() & 1) {
             hashes.push_back(hashes.back());
         }
-        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
-        hashes.resize(hashes.size() / 2);
+        ComputeMerkleLevel(hashes, nThreads);
     }
     if (mutated) *mutated = mutation;
     if (hashes.size() == 0) return uint256();
@@ -69,3 +112,45 @@ uint256 BlockMerkleRoot(const CBlock &block, bool *mutated) {
     }
     return ComputeMerkleRoot(std::move(leaves), mutated);
 }
+
+std::vector<uint256> ComputeFirstMerkleBranch(std::vector<uint256> hashes) {
+    std::vector<uint256> branch;
+    // hashes[0] is left unknown: the nodes which depend on the first leaf are
+    // the first of every level, and their siblings make up the branch.
+    while (hashes.size() > 1) {
+        branch.push_back(hashes[1]);
+        if (hashes.size() & 1) {
+            hashes.push_back(hashes.back());
+        }
+        const size_t nPairs = hashes.size() / 2;
+        if (nPairs > 1) {
+            SHA256D64(hashes[1].begin(), hashes[2].begin(), nPairs - 1);
+        }
+        hashes.resize(nPairs);
+    }
+    return branch;
+}
+
+std::vector<uint256> BlockCoinbaseMerkleBranch(const CBlock &block) {
+    std::vector<uint256> leaves;
+    leaves.resize(block.vtx.size());
+    for (size_t s = 1; s < block.vtx.size(); s++) {
+        leaves[s] = block.vtx[s]->GetId();
+    }
+    return ComputeFirstMerkleBranch(std::move(leaves));
+}
+
+uint256 ComputeMerkleRootFromBranch(const uint256 &leaf,
+                                    const std::vector<uint256> &branch,
+                                    uint32_t nIndex) {
+    uint256 hash = leaf;
+    for (const uint256 &sibling : branch) {
+        if (nIndex & 1) {
+            hash = Hash(BEGIN(sibling), END(sibling), BEGIN(hash), END(hash));
+        } else {
+            hash = Hash(BEGIN(hash), END(hash), BEGIN(sibling), END(sibling));
+        }
+        nIndex >>= 1;
+    }
+    return hash;
+}
@@ -12,7 +12,21 @@
 #include <primitives/transaction.h>
 #include <uint256.h>
 
-uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated = nullptr);
+/**
+ * Trees with at least this many leaves have their lower levels hashed by
+ * several threads.
+ */
+static const size_t MERKLE_PARALLEL_MIN_LEAVES = 16384;
+/** Maximum number of threads used to hash a tree. */
+static const unsigned int MAX_MERKLE_THREADS = 8;
+
+/**
+ * Compute the Merkle root of a list of hashes. The levels of large trees are
+ * hashed by nThreads threads, or one per core up to MAX_MERKLE_THREADS if it
+ * is 0.
+ */
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated = nullptr,
+                          unsigned int nThreads = 0);
 
 /**
  * Compute the Merkle root of the transactions in a block.
@@ -20,4 +34,24 @@ uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool *mutated = nullptr);
  */
 uint256 BlockMerkleRoot(const CBlock &block, bool *mutated = nullptr);
 
+/**
+ * Compute the Merkle branch of the first leaf, the hashes it is combined with
+ * up to the root. The branch does not depend on the first leaf, so the root
+ * can be computed again in O(log n) when only that leaf changes.
+ */
+std::vector<uint256> ComputeFirstMerkleBranch(std::vector<uint256> hashes);
+
+/**
+ * Compute the Merkle branch of the coinbase of a block, which does not depend
+ * on the coinbase itself.
+ */
+std::vector<uint256> BlockCoinbaseMerkleBranch(const CBlock &block);
+
+/**
+ * Compute the Merkle root from a leaf at position nIndex and its branch.
+ */
+uint256 ComputeMerkleRootFromBranch(const uint256 &leaf,
+                                    const std::vector<uint256> &branch,
+                                    uint32_t nIndex);
+
 #endif // BITCOIN_CONSENSUS_MERKLE_H
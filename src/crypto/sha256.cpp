@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstring>
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
@@ -22,10 +23,18 @@ namespace sha256d64_sse41 {
 void Transform_4way(uint8_t *out, const uint8_t *in);
 }
 
+namespace sha256_sse41 {
+void Transform_4way(uint32_t *s, const uint8_t *const *chunks);
+}
+
 namespace sha256d64_avx2 {
 void Transform_8way(uint8_t *out, const uint8_t *in);
 }
 
+namespace sha256_avx2 {
+void Transform_8way(uint32_t *s, const uint8_t *const *chunks);
+}
+
 namespace sha256d64_shani {
 void Transform_2way(uint8_t *out, const uint8_t *in);
 }
@@ -578,6 +587,7 @@ namespace sha256 {
 
 typedef void (*TransformType)(uint32_t *, const uint8_t *, size_t);
 typedef void (*TransformD64Type)(uint8_t *, const uint8_t *);
+typedef void (*TransformMultiType)(uint32_t *, const uint8_t *const *);
 
 template <TransformType tr>
 void TransformD64Wrapper(uint8_t *out, const uint8_t *in) {
@@ -618,6 +628,29 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+/**
+ * Test a multi-lane transform: lane i starts from the state after hashing i
+ * chunks of the input and hashes the next one.
+ */
+bool SelfTestMulti(TransformMultiType tr, size_t ways,
+                   const uint8_t *data, const uint32_t (*result)[8]) {
+    uint32_t state[8 * 8];
+    const uint8_t *chunks[8];
+    for (size_t i = 0; i < ways; ++i) {
+        std::copy(result[i], result[i] + 8, state + 8 * i);
+        chunks[i] = data + 64 * i;
+    }
+    tr(state, chunks);
+    for (size_t i = 0; i < ways; ++i) {
+        if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 1])) {
+            return false;
+        }
+    }
+    return true;
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -719,6 +752,16 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test the multi-lane transforms, if available.
+    if (TransformMulti_4way &&
+        !SelfTestMulti(TransformMulti_4way, 4, data + 1, result)) {
+        return false;
+    }
+    if (TransformMulti_8way &&
+        !SelfTestMulti(TransformMulti_8way, 8, data + 1, result)) {
+        return false;
+    }
+
     return true;
 }
 
@@ -797,6 +840,7 @@ std::string SHA256AutoDetect() {
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256_sse41::Transform_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -804,6 +848,7 @@ std::string SHA256AutoDetect() {
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256_avx2::Transform_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -898,3 +943,125 @@ void SHA256D64(uint8_t *out, const uint8_t *in, size_t blocks) {
         --blocks;
     }
 }
+
+namespace {
+/**
+ * A message being double-SHA256'd in one lane of SHA256DMulti. Its full
+ * chunks are read in place, while the padded tail is copied.
+ */
+struct SHA256DLane {
+    //! Index of the message, or -1 if the lane is idle
+    ptrdiff_t index = -1;
+    //! Whether the lane hashes the 32 byte first hash
+    bool second;
+    const uint8_t *data;
+    size_t blocks;
+    uint8_t tail[128];
+    size_t tailBlocks;
+    size_t tailPos;
+
+    void Start(ptrdiff_t indexIn, const uint8_t *dataIn, size_t len,
+               bool secondIn) {
+        index = indexIn;
+        second = secondIn;
+        data = dataIn;
+        blocks = len / 64;
+        const size_t rem = len % 64;
+        tailBlocks = rem + 9 > 64 ? 2 : 1;
+        tailPos = 0;
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, data + 64 * blocks, rem);
+        tail[rem] = 0x80;
+        WriteBE64(tail + 64 * tailBlocks - 8, uint64_t(len) << 3);
+    }
+
+    const uint8_t *Chunk() const {
+        return blocks ? data : tail + 64 * tailPos;
+    }
+
+    //! Move to the next chunk, returns false when the message is done.
+    bool Next() {
+        if (blocks) {
+            data += 64;
+            --blocks;
+        } else {
+            ++tailPos;
+        }
+        return blocks || tailPos < tailBlocks;
+    }
+};
+
+void WriteState(uint8_t *out, const uint32_t *s) {
+    for (int i = 0; i < 8; ++i) {
+        WriteBE32(out + 4 * i, s[i]);
+    }
+}
+} // namespace
+
+void SHA256DMulti(uint8_t *out, const uint8_t *const *in, const size_t *len,
+                  size_t count) {
+    TransformMultiType tr = nullptr;
+    size_t ways = 1;
+    if (TransformMulti_8way) {
+        tr = TransformMulti_8way;
+        ways = 8;
+    } else if (TransformMulti_4way) {
+        tr = TransformMulti_4way;
+        ways = 4;
+    }
+
+    if (!tr || count < 2) {
+        uint8_t hash[CSHA256::OUTPUT_SIZE];
+        for (size_t i = 0; i < count; ++i) {
+            CSHA256().Write(in[i], len[i]).Finalize(hash);
+            CSHA256().Write(hash, sizeof(hash)).Finalize(out + 32 * i);
+        }
+        return;
+    }
+
+    // Idle lanes hash this chunk, and their result is ignored.
+    static const uint8_t idle[64] = {0};
+    SHA256DLane lanes[8];
+    uint32_t state[8 * 8];
+    const uint8_t *chunks[8];
+    size_t next = 0;
+    while (true) {
+        size_t active = 0;
+        for (size_t i = 0; i < ways; ++i) {
+            SHA256DLane &lane = lanes[i];
+            if (lane.index < 0 && next < count) {
+                lane.Start(next, in[next], len[next], false);
+                sha256::Initialize(state + 8 * i);
+                ++next;
+            }
+            if (lane.index >= 0) {
+                chunks[i] = lane.Chunk();
+                ++active;
+            } else {
+                chunks[i] = idle;
+            }
+        }
+        if (!active) {
+            break;
+        }
+
+        tr(state, chunks);
+
+        for (size_t i = 0; i < ways; ++i) {
+            SHA256DLane &lane = lanes[i];
+            if (lane.index < 0 || lane.Next()) {
+                continue;
+            }
+            uint8_t *hash = out + 32 * lane.index;
+            WriteState(hash, state + 8 * i);
+            if (lane.second) {
+                lane.index = -1;
+            } else {
+                // Hash the first hash again in the same lane. It is copied
+                // into the tail, so the output can be reused.
+                lane.Start(lane.index, hash, CSHA256::OUTPUT_SIZE, true);
+                sha256::Initialize(state + 8 * i);
+            }
+        }
+    }
+}
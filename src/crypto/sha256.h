@@ -39,4 +39,15 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(uint8_t *output, const uint8_t *input, size_t blocks);
 
+/**
+ * Compute multiple double-SHA256's of messages of any length, interleaving
+ * them in the lanes of the multi-lane implementations when available.
+ * output:  pointer to a count*32 byte output buffer
+ * input:   pointer to count message pointers
+ * len:     pointer to count message lengths
+ * count:   the number of hashes to compute.
+ */
+void SHA256DMulti(uint8_t *output, const uint8_t *const *input,
+                  const size_t *len, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -498,6 +498,23 @@ public:
         }
         return false;
     }
+
+    /**
+     * for_each calls fn on every element which is in the table and not
+     * marked for erasure, e.g. to persist the cache.
+     *
+     * for_each is not thread safe with respect to insert, the caller must
+     * ensure no concurrent writes happen.
+     *
+     * @param fn a callable taking a const Element&
+     */
+    template <typename F> void for_each(F fn) const {
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!collection_flags.bit_is_set(i)) {
+                fn(table[i]);
+            }
+        }
+    }
 };
 } // namespace CuckooCache
 
@@ -244,6 +244,19 @@ bool CDBWrapper::IsEmpty() {
     return !(it->Valid());
 }
 
+CDBSnapshot::CDBSnapshot(leveldb::DB *_pdb,
+                         const leveldb::ReadOptions &_readoptions,
+                         const leveldb::ReadOptions &_iteroptions)
+    : pdb(_pdb), psnapshot(_pdb->GetSnapshot()), readoptions(_readoptions),
+      iteroptions(_iteroptions) {
+    readoptions.snapshot = psnapshot;
+    iteroptions.snapshot = psnapshot;
+}
+
+CDBSnapshot::~CDBSnapshot() {
+    pdb->ReleaseSnapshot(psnapshot);
+}
+
 CDBIterator::~CDBIterator() {
     delete piter;
 }
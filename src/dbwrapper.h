@@ -16,6 +16,8 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
@@ -113,6 +115,34 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/**
+ * A consistent, read-only view of a CDBWrapper at the time it was created.
+ * Reads and iterators using the same snapshot all observe the same database
+ * state, regardless of concurrent writes.
+ */
+class CDBSnapshot {
+    friend class CDBWrapper;
+
+private:
+    leveldb::DB *pdb;
+    const leveldb::Snapshot *psnapshot;
+
+    //! options used when reading from the snapshot
+    leveldb::ReadOptions readoptions;
+
+    //! options used when iterating over values of the snapshot
+    leveldb::ReadOptions iteroptions;
+
+    CDBSnapshot(leveldb::DB *_pdb, const leveldb::ReadOptions &_readoptions,
+                const leveldb::ReadOptions &_iteroptions);
+
+public:
+    ~CDBSnapshot();
+
+    CDBSnapshot(const CDBSnapshot &) = delete;
+    CDBSnapshot &operator=(const CDBSnapshot &) = delete;
+};
+
 class CDBIterator {
 private:
     const CDBWrapper &parent;
@@ -232,14 +262,17 @@ public:
     CDBWrapper(const CDBWrapper &) = delete;
     CDBWrapper &operator=(const CDBWrapper &) = delete;
 
-    template <typename K, typename V> bool Read(const K &key, V &value) const {
+    template <typename K, typename V>
+    bool Read(const K &key, V &value,
+              const CDBSnapshot *snapshot = nullptr) const {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(
+            snapshot ? snapshot->readoptions : readoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound()) return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
@@ -303,6 +336,23 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Return an iterator reading from the given snapshot, which must outlive
+     * the iterator.
+     */
+    CDBIterator *NewIterator(const CDBSnapshot &snapshot) {
+        return new CDBIterator(*this, pdb->NewIterator(snapshot.iteroptions));
+    }
+
+    /**
+     * Take a snapshot of the current state of the database. The snapshot
+     * must not outlive this CDBWrapper.
+     */
+    std::shared_ptr<const CDBSnapshot> GetSnapshot() const {
+        return std::shared_ptr<const CDBSnapshot>(
+            new CDBSnapshot(pdb, readoptions, iteroptions));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
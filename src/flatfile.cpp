@@ -10,6 +10,13 @@
 
 #include <stdexcept>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char *prefix, size_t chunk_size)
     : m_dir(std::move(dir)), m_prefix(prefix), m_chunk_size(chunk_size) {
     if (chunk_size == 0) {
@@ -48,6 +55,53 @@ FILE *FlatFileSeq::Open(const FlatFilePos &pos, bool read_only) {
     return file;
 }
 
+FlatFileMapping::~FlatFileMapping() {
+#ifndef WIN32
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+}
+
+std::unique_ptr<FlatFileMapping> FlatFileSeq::Map(const FlatFilePos &pos) const {
+#ifdef WIN32
+    return nullptr;
+#else
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    fs::path path = FileName(pos);
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return nullptr;
+    }
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping remains valid after the descriptor is closed.
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::make_unique<FlatFileMapping>(static_cast<uint8_t *>(data),
+                                             st.st_size);
+#endif
+}
+
+void FlatFileSeq::Advise(const FlatFilePos &pos, size_t length,
+                         FileAccess access) const {
+    if (pos.IsNull()) {
+        return;
+    }
+    FILE *file = fsbridge::fopen(FileName(pos), "rb");
+    if (!file) {
+        return;
+    }
+    AdviseFileAccess(file, pos.nPos, length, access);
+    fclose(file);
+}
+
 size_t FlatFileSeq::Allocate(const FlatFilePos &pos, size_t add_size,
                              bool &out_of_space) {
     out_of_space = false;
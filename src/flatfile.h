@@ -8,7 +8,10 @@
 
 #include <fs.h>
 #include <serialize.h>
+#include <util/system.h>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 struct FlatFilePos {
@@ -45,6 +48,27 @@ struct FlatFilePos {
     std::string ToString() const;
 };
 
+/**
+ * A read-only memory mapping of a whole file of a FlatFileSeq. Data appended
+ * to the file after it was mapped is only visible through a new mapping.
+ */
+class FlatFileMapping {
+private:
+    const uint8_t *const m_data;
+    const size_t m_size;
+
+public:
+    FlatFileMapping(const uint8_t *data, size_t size)
+        : m_data(data), m_size(size) {}
+    ~FlatFileMapping();
+
+    FlatFileMapping(const FlatFileMapping &) = delete;
+    FlatFileMapping &operator=(const FlatFileMapping &) = delete;
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This
  * class facilitates access to and efficient management of these files.
@@ -72,6 +96,21 @@ public:
     /** Open a handle to the file at the given position. */
     FILE *Open(const FlatFilePos &pos, bool read_only = false);
 
+    /**
+     * Map the whole file at the given position into memory, read only.
+     * Returns nullptr if the file is empty or cannot be mapped, which is
+     * always the case on platforms without mmap.
+     */
+    std::unique_ptr<FlatFileMapping> Map(const FlatFilePos &pos) const;
+
+    /**
+     * Hint the operating system about how length bytes of the file from the
+     * given position, or the rest of the file if length is 0, are about to be
+     * used. See AdviseFileAccess.
+     */
+    void Advise(const FlatFilePos &pos, size_t length,
+                FileAccess access) const;
+
     /**
      * Allocate additional space in a file after the given starting position.
      * The amount allocated will be the minimum multiple of the sequence chunk
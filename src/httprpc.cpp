@@ -325,7 +325,30 @@ bool HTTPRPCRequestProcessor::ProcessHTTPRequest(HTTPRequest *req) {
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // Let methods such as long polls reply later, without holding
+            // this thread meanwhile.
+            bool fDeferred = false;
+            jreq.defer = [req, id = jreq.id, &fDeferred] {
+                fDeferred = true;
+                std::shared_ptr<HTTPRequest> deferred = req->Defer();
+                return JSONRPCReplyFunction(
+                    [deferred, id](const std::string &strResult,
+                                   const UniValue &error) {
+                        if (!error.isNull()) {
+                            JSONErrorReply(deferred.get(), error, id);
+                            return;
+                        }
+                        deferred->WriteHeader("Content-Type",
+                                              "application/json");
+                        deferred->WriteReply(
+                            HTTP_OK, JSONRPCWrittenReply(strResult, id));
+                    });
+            };
+
             UniValue result = rpcServer.ExecuteCommand(config, jreq);
+            if (fDeferred) {
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -37,6 +37,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <condition_variable>
+#include <deque>
 #include <future>
 
 /** Maximum size of http request (request line + headers) */
@@ -146,6 +148,21 @@ static WorkQueue<HTTPClosure> *workQueue = nullptr;
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 std::vector<evhttp_bound_socket *> boundSockets;
+//! Number of deferred requests whose reply is not sent yet
+static Mutex g_deferred_mutex;
+static std::condition_variable g_deferred_cv;
+static int g_deferred_pending GUARDED_BY(g_deferred_mutex) = 0;
+
+static void DeferredReplySent() {
+    LOCK(g_deferred_mutex);
+    if (--g_deferred_pending == 0) {
+        g_deferred_cv.notify_all();
+    }
+}
+
+static void http_deferred_reply_cb(struct evhttp_request *, void *) {
+    DeferredReplySent();
+}
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr &netaddr) {
@@ -478,6 +495,16 @@ void StopHTTPServer() {
         delete workQueue;
         workQueue = nullptr;
     }
+    {
+        // Give the deferred replies sent on shutdown, e.g. to long polls, the
+        // time to be written before the event loop exits.
+        LogPrint(BCLog::HTTP, "Waiting for deferred HTTP replies\n");
+        WAIT_LOCK(g_deferred_mutex, lock);
+        g_deferred_cv.wait_for(lock, std::chrono::milliseconds(2000), [] {
+            AssertLockHeld(g_deferred_mutex);
+            return g_deferred_pending == 0;
+        });
+    }
     if (eventBase) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
         // Exit the event loop as soon as there are no active events.
@@ -541,7 +568,7 @@ void HTTPEvent::trigger(struct timeval *tv) {
     }
 }
 HTTPRequest::HTTPRequest(struct evhttp_request *_req)
-    : req(_req), replySent(false) {}
+    : req(_req), replySent(false), deferred(false) {}
 HTTPRequest::~HTTPRequest() {
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
@@ -605,7 +632,23 @@ void HTTPRequest::WriteReply(int nStatus, const std::string &strReply) {
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
     auto req_copy = req;
-    HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
+    const bool deferred_copy = deferred;
+    HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, nStatus,
+                                                    deferred_copy] {
+        if (deferred_copy) {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+            // Requests whose connection is closed are freed without
+            // completing.
+            if (evhttp_request_get_connection(req_copy)) {
+                evhttp_request_set_on_complete_cb(
+                    req_copy, http_deferred_reply_cb, nullptr);
+            } else {
+                DeferredReplySent();
+            }
+#else
+            DeferredReplySent();
+#endif
+        }
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
         // Re-enable reading from the socket. This is the second part of the
         // libevent workaround above.
@@ -626,6 +669,19 @@ void HTTPRequest::WriteReply(int nStatus, const std::string &strReply) {
     req = nullptr;
 }
 
+std::unique_ptr<HTTPRequest> HTTPRequest::Defer() {
+    assert(!replySent && req);
+    std::unique_ptr<HTTPRequest> deferredRequest(new HTTPRequest(req));
+    deferredRequest->deferred = true;
+    {
+        LOCK(g_deferred_mutex);
+        ++g_deferred_pending;
+    }
+    replySent = true;
+    req = nullptr;
+    return deferredRequest;
+}
+
 CService HTTPRequest::GetPeer() {
     evhttp_connection *con = evhttp_request_get_connection(req);
     CService peer;
@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 
 static const int DEFAULT_HTTP_THREADS = 4;
@@ -70,6 +71,8 @@ class HTTPRequest {
 private:
     struct evhttp_request *req;
     bool replySent;
+    //! Whether the reply is waited for before stopping the HTTP server
+    bool deferred;
 
 public:
     explicit HTTPRequest(struct evhttp_request *req);
@@ -118,6 +121,14 @@ public:
      * this.
      */
     void WriteReply(int nStatus, const std::string &strReply = "");
+
+    /**
+     * Take the request over, to reply to it after the handler returned, from
+     * any thread. This object is then left as if it had replied.
+     *
+     * @note The request must be replied to before the HTTP server stops.
+     */
+    std::unique_ptr<HTTPRequest> Defer();
 };
 
 /** Event handler closure */
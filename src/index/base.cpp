@@ -88,6 +88,7 @@ void BaseIndex::ThreadSync() {
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
+        BlockFileReadahead readahead(nullptr, false);
         while (true) {
             if (m_interrupt) {
                 WriteBestBlock(pindex);
@@ -119,6 +120,7 @@ void BaseIndex::ThreadSync() {
                 last_locator_write_time = current_time;
             }
 
+            readahead.Read(pindex);
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
                 FatalError("%s: Failed to read block %s from disk", __func__,
@@ -33,6 +33,7 @@
 #include <netbase.h>
 #include <policy/policy.h>
 #include <rpc/blockchain.h>
+#include <rpc/mining.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <scheduler.h>
@@ -213,6 +214,10 @@ void Shutdown() {
     StopHTTPRPC();
     StopREST();
     StopRPC();
+    // Long polls are answered before the HTTP server stops.
+    if (g_block_template_longpolls) {
+        g_block_template_longpolls->Stop();
+    }
     StopHTTPServer();
     g_wallet_init_interface.Flush();
     StopMapPort();
@@ -222,6 +227,12 @@ void Shutdown() {
     if (peerLogic) {
         UnregisterValidationInterface(peerLogic.get());
     }
+    if (g_block_template_cache) {
+        UnregisterValidationInterface(g_block_template_cache.get());
+    }
+    if (g_block_template_longpolls) {
+        UnregisterValidationInterface(g_block_template_longpolls.get());
+    }
     if (g_connman) {
         g_connman->Stop();
     }
@@ -238,10 +249,13 @@ void Shutdown() {
     // the CScheduler/checkqueue threadGroup
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    StopBlockPrefetchThreads();
 
     // After the threads that potentially access these pointers have been
     // stopped, destruct and reset all to nullptr.
     peerLogic.reset();
+    g_block_template_cache.reset();
+    g_block_template_longpolls.reset();
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
@@ -373,6 +387,33 @@ void SetupServerArgs() {
                  _("Specify directory to hold blocks subdirectory for *.dat "
                    "files (default: <datadir>)"),
                  false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexsnapshot",
+                 strprintf(_("Whether to save a snapshot of the block index "
+                             "on shutdown to load it faster on restart "
+                             "(default: %u)"),
+                           DEFAULT_BLOCK_INDEX_SNAPSHOT),
+                 false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockprefetch=<n>",
+                 strprintf(_("Number of blocks to read and check ahead of "
+                             "connecting them, 0 to disable (default: %u)"),
+                           DEFAULT_BLOCK_PREFETCH),
+                 false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockprefetchmem=<n>",
+                 strprintf(_("Maximum memory used by the blocks read ahead, "
+                             "in MiB (default: %u)"),
+                           DEFAULT_BLOCK_PREFETCH_MEMORY),
+                 false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockreadahead=<n>",
+                 strprintf(_("Number of blocks the operating system is asked "
+                             "to read ahead of index syncs, rescans and "
+                             "block verification, 0 to disable (default: %u)"),
+                           DEFAULT_BLOCK_READAHEAD),
+                 false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blocktxarena",
+                 strprintf(_("Whether to allocate the transactions of a block "
+                             "together and free them at once (default: %u)"),
+                           DEFAULT_BLOCK_TX_ARENA),
+                 false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>",
                  _("Execute command when the best block changes (%s in cmd is "
                    "replaced by block hash)"),
@@ -473,6 +514,12 @@ void SetupServerArgs() {
                              "and load on restart (default: %u)"),
                            DEFAULT_PERSIST_MEMPOOL),
                  false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-persistscriptcache",
+                 strprintf(_("Whether to save the signature and script "
+                             "execution caches along with the mempool and "
+                             "load them on restart (default: %u)"),
+                           DEFAULT_PERSIST_SCRIPT_CACHE),
+                 false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg(
         "-pid=<file>",
@@ -515,6 +562,18 @@ void SetupServerArgs() {
                              "getrawtransaction rpc call (default: %d)"),
                            DEFAULT_TXINDEX),
                  false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-undocache=<n>",
+                 strprintf(_("Number of recently connected blocks kept in "
+                             "memory with their undo data, to disconnect them "
+                             "without reading the disk (default: %u)"),
+                           DEFAULT_UNDO_CACHE),
+                 false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-undocachemem=<n>",
+                 strprintf(_("Maximum memory used by the recently connected "
+                             "blocks and their undo data, in MiB (default: "
+                             "%u)"),
+                           DEFAULT_UNDO_CACHE_MEMORY),
+                 false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-usecashaddr",
                  _("Use Cash Address for destination encoding instead "
                    "of base58 (activate by default on Jan, 14)"),
@@ -944,6 +1003,14 @@ void SetupServerArgs() {
                   CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE_PER_KB)),
         false, OptionsCategory::BLOCK_CREATION);
 
+    gArgs.AddArg(
+        "-blocktemplatecheck",
+        strprintf(_("Check the validity of block templates as they are "
+                    "assembled. Otherwise, blocks are only checked once "
+                    "submitted (default: %d)"),
+                  DEFAULT_BLOCK_TEMPLATE_CHECK),
+        false, OptionsCategory::BLOCK_CREATION);
+
     gArgs.AddArg("-blockversion=<n>",
                  "Override block version to test forking scenarios", true,
                  OptionsCategory::BLOCK_CREATION);
@@ -1004,6 +1071,13 @@ void SetupServerArgs() {
         "Domain from which to accept cross origin requests (browser enforced)",
         false, OptionsCategory::RPC);
 
+    gArgs.AddArg(
+        "-longpollfeeincrease=<amt>",
+        strprintf(_("Fee increase (in %s) of the block template answering "
+                    "getblocktemplate long polls on the same tip "
+                    "(default: %s)"),
+                  CURRENCY_UNIT, FormatMoney(DEFAULT_LONGPOLL_FEE_INCREASE)),
+        false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcworkqueue=<n>",
                  strprintf("Set the depth of the work queue to service RPC "
                            "calls (default: %d)",
@@ -1158,23 +1232,16 @@ static void ThreadImport(const Config &config,
 
         // -reindex
         if (fReindex) {
-            int nFile = 0;
-            while (true) {
-                FlatFilePos pos(nFile, 0);
-                if (!fs::exists(GetBlockPosFilename(pos))) {
+            std::vector<fs::path> vBlockFiles;
+            for (int nFile = 0;; nFile++) {
+                fs::path path = GetBlockPosFilename(FlatFilePos(nFile, 0));
+                if (!fs::exists(path)) {
                     // No block files left to reindex
                     break;
                 }
-                FILE *file = OpenBlockFile(pos, true);
-                if (!file) {
-                    // This error is logged in OpenBlockFile
-                    break;
-                }
-                LogPrintf("Reindexing block file blk%05u.dat...\n",
-                          (unsigned int)nFile);
-                LoadExternalBlockFile(config, file, &pos);
-                nFile++;
+                vBlockFiles.push_back(path);
             }
+            LoadExternalBlockFiles(config, vBlockFiles, true);
             pblocktree->WriteReindexing(false);
             fReindex = false;
             LogPrintf("Reindexing finished\n");
@@ -1186,28 +1253,14 @@ static void ThreadImport(const Config &config,
         // hardcoded $DATADIR/bootstrap.dat
         fs::path pathBootstrap = GetDataDir() / "bootstrap.dat";
         if (fs::exists(pathBootstrap)) {
-            FILE *file = fsbridge::fopen(pathBootstrap, "rb");
-            if (file) {
-                fs::path pathBootstrapOld = GetDataDir() / "bootstrap.dat.old";
-                LogPrintf("Importing bootstrap.dat...\n");
-                LoadExternalBlockFile(config, file);
-                RenameOver(pathBootstrap, pathBootstrapOld);
-            } else {
-                LogPrintf("Warning: Could not open bootstrap file %s\n",
-                          pathBootstrap.string());
-            }
+            fs::path pathBootstrapOld = GetDataDir() / "bootstrap.dat.old";
+            LoadExternalBlockFiles(config, {pathBootstrap});
+            RenameOver(pathBootstrap, pathBootstrapOld);
         }
 
         // -loadblock=
-        for (const fs::path &path : vImportFiles) {
-            FILE *file = fsbridge::fopen(path, "rb");
-            if (file) {
-                LogPrintf("Importing blocks file %s...\n", path.string());
-                LoadExternalBlockFile(config, file);
-            } else {
-                LogPrintf("Warning: Could not open blocks file %s\n",
-                          path.string());
-            }
+        if (!vImportFiles.empty()) {
+            LoadExternalBlockFiles(config, vImportFiles);
         }
 
         // scan for better chains in the block chain database, that are not yet
@@ -1762,6 +1815,16 @@ bool AppInitParameterInteraction(Config &config) {
         }
     }
 
+    // Sanity check argument for the fee increase answering long polls
+    if (gArgs.IsArgSet("-longpollfeeincrease")) {
+        Amount n = Amount::zero();
+        if (!ParseMoney(gArgs.GetArg("-longpollfeeincrease", ""), n)) {
+            return InitError(
+                AmountErrMsg("longpollfeeincrease",
+                             gArgs.GetArg("-longpollfeeincrease", "")));
+        }
+    }
+
     // Feerate used to define dust.  Shouldn't be changed lightly as old
     // implementations may inadvertently create non-standard transactions.
     if (gArgs.IsArgSet("-dustrelayfee")) {
@@ -1912,6 +1975,8 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    SetBlockTransactionArena(
+        gArgs.GetBoolArg("-blocktxarena", DEFAULT_BLOCK_TX_ARENA));
 
     LogPrintf("Using %u threads for script verification\n",
               nScriptCheckThreads);
@@ -1920,6 +1985,8 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
             threadGroup.create_thread(&ThreadScriptCheck);
         }
     }
+    StartBlockPrefetchThreads(config);
+    InitUndoCache();
 
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop =
@@ -1977,6 +2044,19 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
         gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
     RegisterValidationInterface(peerLogic.get());
 
+    g_block_template_cache =
+        std::make_unique<BlockTemplateCache>(config, g_mempool);
+    RegisterValidationInterface(g_block_template_cache.get());
+
+    Amount nLongPollFeeIncrease = DEFAULT_LONGPOLL_FEE_INCREASE;
+    if (gArgs.IsArgSet("-longpollfeeincrease")) {
+        ParseMoney(gArgs.GetArg("-longpollfeeincrease", ""),
+                   nLongPollFeeIncrease);
+    }
+    g_block_template_longpolls = std::make_unique<BlockTemplateLongPolls>(
+        config, nLongPollFeeIncrease);
+    RegisterValidationInterface(g_block_template_longpolls.get());
+
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
     for (const std::string &cmt : gArgs.GetArgs("-uacomment")) {
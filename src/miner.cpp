@@ -62,7 +62,8 @@ BlockAssembler::Options::Options()
     : nExcessiveBlockSize(DEFAULT_MAX_BLOCK_SIZE),
       nMaxGeneratedBlockSize(DEFAULT_MAX_GENERATED_BLOCK_SIZE),
       blockMinFeeRate(DEFAULT_BLOCK_MIN_TX_FEE_PER_KB),
-      nBlockPriorityPercentage(DEFAULT_BLOCK_PRIORITY_PERCENTAGE) {}
+      nBlockPriorityPercentage(DEFAULT_BLOCK_PRIORITY_PERCENTAGE),
+      fCheckValidity(DEFAULT_BLOCK_TEMPLATE_CHECK) {}
 
 BlockAssembler::BlockAssembler(const CChainParams &params,
                                const CTxMemPool &_mempool,
@@ -75,6 +76,7 @@ BlockAssembler::BlockAssembler(const CChainParams &params,
                                  options.nMaxGeneratedBlockSize));
     // Reserve a portion of the block for high priority transactions.
     nBlockPriorityPercentage = options.nBlockPriorityPercentage;
+    fCheckValidity = options.fCheckValidity;
 }
 
 static BlockAssembler::Options DefaultOptions(const Config &config) {
@@ -98,6 +100,8 @@ static BlockAssembler::Options DefaultOptions(const Config &config) {
     }
 
     options.nBlockPriorityPercentage = config.GetBlockPriorityPercentage();
+    options.fCheckValidity =
+        gArgs.GetBoolArg("-blocktemplatecheck", DEFAULT_BLOCK_TEMPLATE_CHECK);
 
     return options;
 }
@@ -223,9 +227,11 @@ BlockAssembler::CreateNewBlock(const CScript &scriptPubKeyIn) {
     for (const CBlockTemplateEntry &tx : pblocktemplate->entries) {
         pblock->vtx.push_back(tx.tx);
     }
+    pblocktemplate->coinbaseMerkleBranch = BlockCoinbaseMerkleBranch(*pblock);
 
     CValidationState state;
-    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev,
+    if (fCheckValidity &&
+        !TestBlockValidity(state, chainparams, *pblock, pindexPrev,
                            BlockValidationOptions(nMaxGeneratedBlockSize)
                                .withCheckPoW(false)
                                .withCheckMerkleRoot(false))) {
@@ -681,6 +687,273 @@ void BlockAssembler::addPriorityTxs() {
     }
 }
 
+std::unique_ptr<BlockTemplateCache> g_block_template_cache;
+
+BlockTemplateCache::BlockTemplateCache(const Config &configIn,
+                                       CTxMemPool &mempoolIn)
+    : config(configIn), mempool(mempoolIn) {}
+
+bool BlockTemplateCache::IsRefreshDue() const {
+    return fStale &&
+           GetTime() - nLastAssembled > BLOCK_TEMPLATE_REFRESH_INTERVAL;
+}
+
+void BlockTemplateCache::Assemble() {
+    // Assemble again on the next request if anything fails from here on.
+    pindexPrev = nullptr;
+    snapshot.reset();
+
+    const CChainParams &chainparams = config.GetChainParams();
+    const BlockAssembler::Options options = DefaultOptions(config);
+    BlockAssembler assembler(chainparams, mempool, options);
+    std::unique_ptr<CBlockTemplate> pblocktemplate =
+        assembler.CreateNewBlock(CScript() << OP_TRUE);
+
+    const CBlockIndex *pindexTip = chainActive.Tip();
+    header = pblocktemplate->block.GetBlockHeader();
+    coinbase = pblocktemplate->entries[0].tx;
+    entries.assign(pblocktemplate->entries.begin() + 1,
+                   pblocktemplate->entries.end());
+
+    setTxIds.clear();
+    // Space reserved for the coinbase, as in BlockAssembler::resetBlock.
+    nBlockSize = 1000;
+    nBlockSigOps = 100;
+    nFees = Amount::zero();
+    for (const CBlockTemplateEntry &entry : entries) {
+        setTxIds.insert(entry.tx->GetId());
+        nBlockSize += entry.txSize;
+        nBlockSigOps += entry.txSigOps;
+        nFees += entry.txFee;
+    }
+
+    nHeight = pindexTip->nHeight + 1;
+    nMedianTimePast = pindexTip->GetMedianTimePast();
+    nLockTimeCutoff =
+        (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+            ? nMedianTimePast
+            : header.GetBlockTime();
+    nMaxGeneratedBlockSize = assembler.GetMaxGeneratedBlockSize();
+    blockMinFeeRate = options.blockMinFeeRate;
+    fCanonicalOrder =
+        IsMagneticAnomalyEnabled(chainparams.GetConsensus(), pindexTip);
+
+    fStale = false;
+    nLastAssembled = GetTime();
+    pindexPrev = pindexTip;
+}
+
+void BlockTemplateCache::AddTransaction(CTxMemPool::txiter it) {
+    const CTransaction &tx = it->GetTx();
+    if (setTxIds.count(tx.GetId())) {
+        return;
+    }
+
+    for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+        if (!setTxIds.count(parent->GetTx().GetId())) {
+            // The transaction may pay for its parents, which only a new
+            // selection of packages can tell.
+            fStale = true;
+            return;
+        }
+    }
+
+    // With its parents in the block, the transaction is a package on its
+    // own, which addPackageTxs would leave out below the minimum fee rate.
+    if (it->GetModifiedFee() < blockMinFeeRate.GetFee(it->GetTxSize())) {
+        return;
+    }
+
+    const uint64_t nTxSize = it->GetTxSize();
+    const uint64_t nTxSigOps = it->GetSigOpCount();
+    if (nBlockSize + nTxSize >= nMaxGeneratedBlockSize ||
+        nBlockSigOps + nTxSigOps >=
+            GetMaxBlockSigOpsCount(nBlockSize + nTxSize)) {
+        // The transaction may be worth more than some already in the block.
+        fStale = true;
+        return;
+    }
+
+    CValidationState state;
+    if (!ContextualCheckTransaction(config.GetChainParams().GetConsensus(), tx,
+                                    state, nHeight, nLockTimeCutoff,
+                                    nMedianTimePast)) {
+        return;
+    }
+
+    CBlockTemplateEntry entry(it->GetSharedTx(), it->GetFee(), nTxSize,
+                              nTxSigOps);
+    if (fCanonicalOrder) {
+        entries.insert(std::lower_bound(entries.begin(), entries.end(), entry,
+                                        [](const CBlockTemplateEntry &a,
+                                           const CBlockTemplateEntry &b) {
+                                            return a.tx->GetId() <
+                                                   b.tx->GetId();
+                                        }),
+                       std::move(entry));
+    } else {
+        // Its parents come before it already.
+        entries.push_back(std::move(entry));
+    }
+
+    setTxIds.insert(tx.GetId());
+    nBlockSize += nTxSize;
+    nBlockSigOps += nTxSigOps;
+    nFees += it->GetFee();
+    snapshot.reset();
+}
+
+void BlockTemplateCache::RemoveTransaction(const TxId &txid) {
+    if (!setTxIds.count(txid)) {
+        return;
+    }
+
+    // Descendants cannot stay in the block without the transaction. They may
+    // come before their parents in canonical order, so look for them until
+    // none is left.
+    std::set<TxId> setRemove = {txid};
+    for (bool fFound = true; fFound;) {
+        fFound = false;
+        for (const CBlockTemplateEntry &entry : entries) {
+            if (setRemove.count(entry.tx->GetId())) {
+                continue;
+            }
+            for (const CTxIn &txin : entry.tx->vin) {
+                if (setRemove.count(txin.prevout.GetTxId())) {
+                    setRemove.insert(entry.tx->GetId());
+                    fFound = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    auto itEnd = std::remove_if(
+        entries.begin(), entries.end(), [&](const CBlockTemplateEntry &entry) {
+            if (!setRemove.count(entry.tx->GetId())) {
+                return false;
+            }
+            setTxIds.erase(entry.tx->GetId());
+            nBlockSize -= entry.txSize;
+            nBlockSigOps -= entry.txSigOps;
+            nFees -= entry.txFee;
+            return true;
+        });
+    entries.erase(itEnd, entries.end());
+
+    // Other transactions may fit in the space left.
+    fStale = true;
+    snapshot.reset();
+}
+
+void BlockTemplateCache::UpdatedBlockTip(const CBlockIndex *pindexNew,
+                                         const CBlockIndex *pindexFork,
+                                         bool fInitialDownload) {
+    if (!fActive || fInitialDownload) {
+        return;
+    }
+
+    LOCK2(cs_main, mempool.cs);
+    LOCK(cs);
+    if (pindexPrev == chainActive.Tip()) {
+        return;
+    }
+
+    try {
+        Assemble();
+    } catch (const std::runtime_error &e) {
+        // The next request assembles the template again and reports it.
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const CTransactionRef &ptx) {
+    if (!fActive) {
+        return;
+    }
+
+    // If the tip changed since, the template is assembled again before it is
+    // returned, so adding the transaction to it is harmless.
+    LOCK2(mempool.cs, cs);
+    CTxMemPool::txiter it = mempool.mapTx.find(ptx->GetId());
+    if (pindexPrev != nullptr && it != mempool.mapTx.end()) {
+        AddTransaction(it);
+    }
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(
+    const CTransactionRef &ptx) {
+    if (!fActive) {
+        return;
+    }
+
+    LOCK2(mempool.cs, cs);
+    // The transaction may have entered the mempool again since.
+    if (!mempool.exists(ptx->GetId())) {
+        RemoveTransaction(ptx->GetId());
+    }
+}
+
+std::shared_ptr<const CBlockTemplate> BlockTemplateCache::Get() {
+    AssertLockHeld(cs_main);
+    LOCK2(mempool.cs, cs);
+    fActive = true;
+
+    if (pindexPrev != chainActive.Tip() || IsRefreshDue()) {
+        Assemble();
+    }
+
+    if (snapshot) {
+        return snapshot;
+    }
+
+    auto pblocktemplate = std::make_shared<CBlockTemplate>();
+    CBlock &block = pblocktemplate->block;
+    block = CBlock(header);
+
+    CMutableTransaction coinbaseTx(*coinbase);
+    coinbaseTx.vout[0].nValue =
+        nFees +
+        GetBlockSubsidy(nHeight, config.GetChainParams().GetConsensus());
+    CTransactionRef coinbaseRef = MakeTransactionRef(std::move(coinbaseTx));
+    pblocktemplate->entries.reserve(entries.size() + 1);
+    pblocktemplate->entries.emplace_back(
+        coinbaseRef, -1 * nFees, 0,
+        GetSigOpCountWithoutP2SH(*coinbaseRef, STANDARD_SCRIPT_VERIFY_FLAGS));
+    pblocktemplate->entries.insert(pblocktemplate->entries.end(),
+                                   entries.begin(), entries.end());
+
+    block.vtx.reserve(pblocktemplate->entries.size());
+    for (const CBlockTemplateEntry &entry : pblocktemplate->entries) {
+        block.vtx.push_back(entry.tx);
+    }
+    pblocktemplate->coinbaseMerkleBranch = BlockCoinbaseMerkleBranch(block);
+
+    snapshot = std::move(pblocktemplate);
+    return snapshot;
+}
+
+Amount BlockTemplateCache::GetFees() {
+    {
+        LOCK(cs);
+        if (pindexPrev != nullptr && !IsRefreshDue()) {
+            return nFees;
+        }
+    }
+
+    LOCK2(cs_main, mempool.cs);
+    LOCK(cs);
+    if (pindexPrev != chainActive.Tip() || IsRefreshDue()) {
+        Assemble();
+    }
+    return nFees;
+}
+
+void BlockTemplateCache::MarkStale() {
+    LOCK(cs);
+    fStale = true;
+}
+
 static const std::vector<uint8_t>
 getExcessiveBlockSizeSig(uint64_t nExcessiveBlockSize) {
     std::string cbmsg = "/EB" + getSubVersionEB(nExcessiveBlockSize) + "/";
@@ -690,7 +963,8 @@ getExcessiveBlockSizeSig(uint64_t nExcessiveBlockSize) {
 
 void IncrementExtraNonce(CBlock *pblock, const CBlockIndex *pindexPrev,
                          uint64_t nExcessiveBlockSize,
-                         unsigned int &nExtraNonce) {
+                         unsigned int &nExtraNonce,
+                         const std::vector<uint256> *pCoinbaseMerkleBranch) {
     // Update nExtraNonce
     static uint256 hashPrevBlock;
     if (hashPrevBlock != pblock->hashPrevBlock) {
@@ -720,5 +994,10 @@ void IncrementExtraNonce(CBlock *pblock, const CBlockIndex *pindexPrev,
            MIN_TX_SIZE);
 
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    if (pCoinbaseMerkleBranch) {
+        pblock->hashMerkleRoot = ComputeMerkleRootFromBranch(
+            pblock->vtx[0]->GetId(), *pCoinbaseMerkleBranch, 0);
+    } else {
+        pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    }
 }
@@ -7,13 +7,17 @@
 #define BITCOIN_MINER_H
 
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <validationinterface.h>
 
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <set>
 
 class CBlockIndex;
 class CChainParams;
@@ -25,6 +29,13 @@ struct Params;
 }
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -blocktemplatecheck */
+static const bool DEFAULT_BLOCK_TEMPLATE_CHECK = true;
+/**
+ * Minimum number of seconds between two assemblies of the block template
+ * served by getblocktemplate, as long as the tip does not change.
+ */
+static const int64_t BLOCK_TEMPLATE_REFRESH_INTERVAL = 5;
 
 struct CBlockTemplateEntry {
     CTransactionRef tx;
@@ -45,6 +56,10 @@ struct CBlockTemplate {
     CBlock block;
 
     std::vector<CBlockTemplateEntry> entries;
+
+    //! Merkle branch of the coinbase, to compute the merkle root again in
+    //! O(log n) when only the coinbase changes
+    std::vector<uint256> coinbaseMerkleBranch;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -157,6 +172,7 @@ private:
     int64_t nMedianTimePast;
     const CChainParams &chainparams;
     uint8_t nBlockPriorityPercentage;
+    bool fCheckValidity;
 
     const CTxMemPool *mempool;
 
@@ -170,6 +186,8 @@ public:
         uint64_t nMaxGeneratedBlockSize;
         CFeeRate blockMinFeeRate;
         uint8_t nBlockPriorityPercentage;
+        //! Check templates with TestBlockValidity as they are created
+        bool fCheckValidity;
     };
 
     BlockAssembler(const Config &config, const CTxMemPool &_mempool);
@@ -247,10 +265,103 @@ private:
         EXCLUSIVE_LOCKS_REQUIRED(mempool->cs);
 };
 
-/** Modify the extranonce in a block */
-void IncrementExtraNonce(CBlock *pblock, const CBlockIndex *pindexPrev,
-                         uint64_t nExcessiveBlockSize,
-                         unsigned int &nExtraNonce);
+/**
+ * The block template served by getblocktemplate, kept up to date with the
+ * mempool instead of being assembled on every call.
+ *
+ * A transaction entering the mempool is added to the template in place when
+ * its parents are in it already and the block has room left for it. When it
+ * cannot be, or when a transaction leaves the mempool or has its fee changed,
+ * the template goes stale and is assembled again, at most once every
+ * BLOCK_TEMPLATE_REFRESH_INTERVAL seconds. A new tip has the template
+ * assembled again in the background.
+ *
+ * Templates are checked with TestBlockValidity when they are assembled, unless
+ * -blocktemplatecheck=0 defers it to the submission of the block. Transactions
+ * added in place were checked against the same tip when entering the mempool.
+ *
+ * Nothing is maintained until a template is asked for.
+ */
+class BlockTemplateCache final : public CValidationInterface {
+private:
+    const Config &config;
+    CTxMemPool &mempool;
+
+    mutable CCriticalSection cs;
+    std::atomic<bool> fActive{false};
+
+    //! Tip the template was assembled on
+    const CBlockIndex *pindexPrev GUARDED_BY(cs) = nullptr;
+    CBlockHeader header GUARDED_BY(cs);
+    //! Coinbase of the assembled template, its value updated with the fees
+    CTransactionRef coinbase GUARDED_BY(cs);
+    //! Transactions of the template, but the coinbase, in block order
+    std::vector<CBlockTemplateEntry> entries GUARDED_BY(cs);
+    std::set<TxId> setTxIds GUARDED_BY(cs);
+
+    // Block state and limits, as in BlockAssembler
+    uint64_t nBlockSize GUARDED_BY(cs);
+    uint64_t nBlockSigOps GUARDED_BY(cs);
+    Amount nFees GUARDED_BY(cs);
+    int nHeight GUARDED_BY(cs);
+    int64_t nLockTimeCutoff GUARDED_BY(cs);
+    int64_t nMedianTimePast GUARDED_BY(cs);
+    uint64_t nMaxGeneratedBlockSize GUARDED_BY(cs);
+    CFeeRate blockMinFeeRate GUARDED_BY(cs);
+    bool fCanonicalOrder GUARDED_BY(cs);
+
+    //! Set when the template may miss better transactions
+    bool fStale GUARDED_BY(cs) = false;
+    int64_t nLastAssembled GUARDED_BY(cs) = 0;
+
+    //! The template last returned, reset whenever it changes
+    std::shared_ptr<const CBlockTemplate> snapshot GUARDED_BY(cs);
+
+    /** Whether the template is stale for long enough to assemble it again. */
+    bool IsRefreshDue() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Assemble the template from scratch on the active tip. */
+    void Assemble() EXCLUSIVE_LOCKS_REQUIRED(cs_main, mempool.cs, cs);
+    /** Add a mempool transaction in place, or mark the template stale. */
+    void AddTransaction(CTxMemPool::txiter it)
+        EXCLUSIVE_LOCKS_REQUIRED(mempool.cs, cs);
+    /** Remove a transaction, and its descendants, from the template. */
+    void RemoveTransaction(const TxId &txid) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew,
+                         const CBlockIndex *pindexFork,
+                         bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptx) override;
+    void TransactionRemovedFromMempool(const CTransactionRef &ptx) override;
+
+public:
+    BlockTemplateCache(const Config &configIn, CTxMemPool &mempoolIn);
+
+    /**
+     * Get a template built on the active tip, with a coinbase paying to
+     * OP_TRUE. The templates returned are never modified afterwards.
+     */
+    std::shared_ptr<const CBlockTemplate> Get()
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /**
+     * Fees of the template, assembled again first if it is due, without
+     * copying it as Get() does.
+     */
+    Amount GetFees();
+    /** Have the template assembled again, e.g. after a fee delta changed. */
+    void MarkStale();
+};
+
+extern std::unique_ptr<BlockTemplateCache> g_block_template_cache;
+
+/**
+ * Modify the extranonce in a block. The merkle root is computed from the
+ * coinbase merkle branch if given, or from all the transactions otherwise.
+ */
+void IncrementExtraNonce(
+    CBlock *pblock, const CBlockIndex *pindexPrev,
+    uint64_t nExcessiveBlockSize, unsigned int &nExtraNonce,
+    const std::vector<uint256> *pCoinbaseMerkleBranch = nullptr);
 int64_t UpdateTime(CBlockHeader *pblock, const Consensus::Params &params,
                    const CBlockIndex *pindexPrev);
 #endif // BITCOIN_MINER_H
@@ -1397,6 +1397,17 @@ static void ProcessGetBlockData(const Config &config, CNode *pfrom,
         if (a_recent_block &&
             a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
+        } else if (inv.type == MSG_BLOCK) {
+            // Send the block as it is serialized on disk, there is no need to
+            // deserialize it first.
+            std::vector<uint8_t> block_data;
+            if (!ReadRawBlockFromDisk(block_data, pindex,
+                                      config.GetChainParams())) {
+                assert(!"cannot load block from disk");
+            }
+            connman->PushMessage(
+                pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+            // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1405,7 +1416,9 @@ static void ProcessGetBlockData(const Config &config, CNode *pfrom,
             }
             pblock = pblockRead;
         }
-        if (inv.type == MSG_BLOCK) {
+        if (pblock == nullptr) {
+            // Already sent as raw data above.
+        } else if (inv.type == MSG_BLOCK) {
             connman->PushMessage(pfrom,
                                  msgMaker.Make(NetMsgType::BLOCK, *pblock));
         } else if (inv.type == MSG_FILTERED_BLOCK) {
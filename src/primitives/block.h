@@ -73,12 +73,14 @@ public:
         *(static_cast<CBlockHeader *>(this)) = header;
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream> void Serialize(Stream &s) const {
+        s << static_cast<const CBlockHeader &>(*this);
+        s << vtx;
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream &s, Operation ser_action) {
-        READWRITEAS(CBlockHeader, *this);
-        READWRITE(vtx);
+    template <typename Stream> void Unserialize(Stream &s) {
+        s >> static_cast<CBlockHeader &>(*this);
+        UnserializeTransactions(s, vtx);
     }
 
     void SetNull() {
@@ -9,6 +9,11 @@
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
 std::string COutPoint::ToString() const {
     return strprintf("COutPoint(%s, %u)", txid.ToString().substr(0, 10), n);
 }
@@ -70,6 +75,159 @@ CTransaction::CTransaction(const CMutableTransaction &tx)
 CTransaction::CTransaction(CMutableTransaction &&tx)
     : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion),
       nLockTime(tx.nLockTime), hash(ComputeHash()) {}
+CTransaction::CTransaction(CMutableTransaction &&tx, const uint256 &hashIn,
+                           PrecomputedHash)
+    : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion),
+      nLockTime(tx.nLockTime), hash(hashIn) {}
+
+static std::atomic<bool> fBlockTransactionArena{DEFAULT_BLOCK_TX_ARENA};
+
+void SetBlockTransactionArena(bool fEnable) {
+    fBlockTransactionArena = fEnable;
+}
+
+/**
+ * Memory for the transactions of a block, carved out of large chunks. Nothing
+ * is freed before the arena itself is destroyed. Allocate is not thread safe,
+ * but is only used while the block is deserialized.
+ */
+class BlockTransactionArena {
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> vChunk;
+    size_t nChunkSize;
+    size_t nChunkUsed = 0;
+    size_t nChunkCapacity = 0;
+
+public:
+    explicit BlockTransactionArena(size_t nChunkSizeIn)
+        : nChunkSize(nChunkSizeIn) {}
+
+    void *Allocate(size_t n) {
+        static const size_t ALIGN = alignof(std::max_align_t);
+        n = (n + ALIGN - 1) & ~(ALIGN - 1);
+        if (nChunkUsed + n > nChunkCapacity) {
+            // new[] returns memory aligned for any type.
+            nChunkCapacity = std::max(n, nChunkSize);
+            vChunk.emplace_back(new uint8_t[nChunkCapacity]);
+            nChunkUsed = 0;
+        }
+        void *p = vChunk.back().get() + nChunkUsed;
+        nChunkUsed += n;
+        return p;
+    }
+};
+
+namespace {
+/**
+ * Puts the reference counts of block transactions in their arena. Every
+ * reference count keeps the arena alive.
+ */
+template <typename T> class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    std::shared_ptr<BlockTransactionArena> arena;
+
+    explicit ArenaAllocator(std::shared_ptr<BlockTransactionArena> arenaIn)
+        : arena(std::move(arenaIn)) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(arena->Allocate(n * sizeof(T)));
+    }
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &other) const {
+        return arena == other.arena;
+    }
+    template <typename U> bool operator!=(const ArenaAllocator<U> &other) const {
+        return arena != other.arena;
+    }
+};
+
+//! Destroys a block transaction, whose memory belongs to the arena.
+struct ArenaDeleter {
+    void operator()(const CTransaction *tx) const { tx->~CTransaction(); }
+};
+
+//! Room for a transaction and its reference count, with an allocator.
+static const size_t ARENA_BYTES_PER_TX = sizeof(CTransaction) + 64;
+static const size_t MIN_ARENA_CHUNK_SIZE = 16 * 1024;
+static const size_t MAX_ARENA_CHUNK_SIZE = 1024 * 1024;
+} // namespace
+
+BlockTransactionBuilder::BlockTransactionBuilder(size_t nTxHint) {
+    if (fBlockTransactionArena) {
+        arena = std::make_shared<BlockTransactionArena>(
+            std::max(MIN_ARENA_CHUNK_SIZE,
+                     std::min(MAX_ARENA_CHUNK_SIZE,
+                              nTxHint * ARENA_BYTES_PER_TX)));
+    }
+}
+
+CTransactionRef BlockTransactionBuilder::Make(CMutableTransaction &&tx,
+                                              const uint256 &hash) {
+    if (!arena) {
+        return std::make_shared<const CTransaction>(
+            std::move(tx), hash, CTransaction::PrecomputedHash());
+    }
+    const CTransaction *p = new (arena->Allocate(sizeof(CTransaction)))
+        CTransaction(std::move(tx), hash, CTransaction::PrecomputedHash());
+    return CTransactionRef(p, ArenaDeleter(),
+                           ArenaAllocator<CTransaction>(arena));
+}
+
+CTransactionRef DetachTransaction(const CTransactionRef &tx) {
+    if (!std::get_deleter<ArenaDeleter>(tx)) {
+        return tx;
+    }
+    return MakeTransactionRef(*tx);
+}
+
+template <>
+void UnserializeTransactions(SpanReader &s, std::vector<CTransactionRef> &vtx) {
+    const size_t nSize = ReadCompactSize(s);
+    vtx.clear();
+
+    // A transaction takes at least 10 bytes, so this does not trust nSize
+    // beyond the size of the data.
+    const size_t nMaxSize = std::min(nSize, s.size() / 10 + 1);
+    std::vector<CMutableTransaction> vmtx;
+    std::vector<const uint8_t *> vInput;
+    std::vector<size_t> vLen;
+    vmtx.reserve(nMaxSize);
+    vInput.reserve(nMaxSize);
+    vLen.reserve(nMaxSize);
+    for (size_t i = 0; i < nSize; i++) {
+        const uint8_t *begin = s.data();
+        vmtx.emplace_back(deserialize, s);
+        vInput.push_back(begin);
+        vLen.push_back(s.data() - begin);
+    }
+
+    if (nSize == 0) {
+        return;
+    }
+    std::vector<uint256> vHash(nSize);
+    SHA256DMulti(vHash[0].begin(), vInput.data(), vLen.data(), nSize);
+
+    BlockTransactionBuilder builder(nSize);
+    vtx.reserve(nSize);
+    for (size_t i = 0; i < nSize; i++) {
+        vtx.push_back(builder.Make(std::move(vmtx[i]), vHash[i]));
+    }
+}
+
+template <>
+void UnserializeTransactions(CDataStream &s, std::vector<CTransactionRef> &vtx) {
+    SpanReader reader(s.GetType(), s.GetVersion(),
+                      Span<const uint8_t>(
+                          reinterpret_cast<const uint8_t *>(s.data()),
+                          s.size()));
+    UnserializeTransactions(reader, vtx);
+    s.ignore(s.size() - reader.size());
+}
 
 Amount CTransaction::GetValueOut() const {
     Amount nValueOut = Amount::zero();
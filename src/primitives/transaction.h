@@ -8,10 +8,12 @@
 #define BITCOIN_PRIMITIVES_TRANSACTION_H
 
 #include <amount.h>
+#include <crypto/sha256.h>
 #include <feerate.h>
 #include <primitives/txid.h>
 #include <script/script.h>
 #include <serialize.h>
+#include <streams.h>
 
 static const int SERIALIZE_TRANSACTION = 0x00;
 
@@ -234,12 +236,26 @@ private:
     uint256 ComputeHash() const;
 
 public:
+    /**
+     * Only BlockTransactionBuilder can make one of these, and so provide the
+     * hash of a transaction. It is a parameter rather than making the
+     * constructor private, so that it can be used with std::make_shared.
+     */
+    class PrecomputedHash {
+        PrecomputedHash() {}
+
+        friend class BlockTransactionBuilder;
+    };
+
     /** Construct a CTransaction that qualifies as IsNull() */
     CTransaction();
 
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction &tx);
     explicit CTransaction(CMutableTransaction &&tx);
+    /** Convert a CMutableTransaction whose hash is already known. */
+    CTransaction(CMutableTransaction &&tx, const uint256 &hashIn,
+                 PrecomputedHash);
 
     template <typename Stream> inline void Serialize(Stream &s) const {
         SerializeTransaction(*this, s);
@@ -350,6 +366,96 @@ static inline CTransactionRef MakeTransactionRef(Tx &&txIn) {
     return std::make_shared<const CTransaction>(std::forward<Tx>(txIn));
 }
 
+/** Number of transactions UnserializeTransactions hashes at once. */
+static const size_t TX_HASH_BATCH_SIZE = 256;
+/** Default for -blocktxarena */
+static const bool DEFAULT_BLOCK_TX_ARENA = true;
+
+/** Enable or disable the allocation of block transactions in an arena. */
+void SetBlockTransactionArena(bool fEnable);
+
+class BlockTransactionArena;
+
+/**
+ * Makes the transactions of one block. Unless disabled, they and their
+ * reference counts are allocated together in an arena, which is freed at once
+ * when the last of them is gone, instead of with one allocation each.
+ *
+ * Transactions that outlive their block, such as those kept by the mempool or
+ * the wallet, should go through DetachTransaction so they do not hold on to
+ * the memory of the whole block.
+ */
+class BlockTransactionBuilder {
+private:
+    std::shared_ptr<BlockTransactionArena> arena;
+
+public:
+    //! nTxHint is the number of transactions expected, used to size the arena
+    explicit BlockTransactionBuilder(size_t nTxHint);
+
+    CTransactionRef Make(CMutableTransaction &&tx, const uint256 &hash);
+};
+
+/**
+ * Return tx, or a copy of it that owns its own memory if tx was allocated in
+ * the arena of a block.
+ */
+CTransactionRef DetachTransaction(const CTransactionRef &tx);
+
+/**
+ * Deserialize a vector of transactions, as found in a block. Their hashes are
+ * computed a batch at a time with SHA256DMulti, rather than one by one as each
+ * transaction is constructed.
+ */
+template <typename Stream>
+void UnserializeTransactions(Stream &s, std::vector<CTransactionRef> &vtx) {
+    const size_t nSize = ReadCompactSize(s);
+    vtx.clear();
+
+    std::vector<CMutableTransaction> vBatch;
+    std::vector<uint8_t> vData;
+    std::vector<size_t> vEnd;
+    std::vector<const uint8_t *> vInput;
+    std::vector<size_t> vLen;
+    std::vector<uint256> vHash;
+    BlockTransactionBuilder builder(std::min(nSize, TX_HASH_BATCH_SIZE));
+    while (vtx.size() < nSize) {
+        const size_t nBatch = std::min(nSize - vtx.size(), TX_HASH_BATCH_SIZE);
+        vBatch.clear();
+        vData.clear();
+        vEnd.clear();
+        for (size_t i = 0; i < nBatch; i++) {
+            vBatch.emplace_back(deserialize, s);
+            CVectorWriter(SER_GETHASH, 0, vData, vData.size(), vBatch.back());
+            vEnd.push_back(vData.size());
+        }
+
+        vInput.resize(nBatch);
+        vLen.resize(nBatch);
+        vHash.resize(nBatch);
+        for (size_t i = 0; i < nBatch; i++) {
+            const size_t nBegin = i ? vEnd[i - 1] : 0;
+            vInput[i] = vData.data() + nBegin;
+            vLen[i] = vEnd[i] - nBegin;
+        }
+        SHA256DMulti(vHash[0].begin(), vInput.data(), vLen.data(), nBatch);
+
+        for (size_t i = 0; i < nBatch; i++) {
+            vtx.push_back(builder.Make(std::move(vBatch[i]), vHash[i]));
+        }
+    }
+}
+
+/**
+ * Deserialize the transactions of a block that is held in memory, e.g. as
+ * received from the network or mapped from a block file. They are hashed all
+ * at once where they are, instead of being serialized again into a buffer.
+ */
+template <>
+void UnserializeTransactions(SpanReader &s, std::vector<CTransactionRef> &vtx);
+template <>
+void UnserializeTransactions(CDataStream &s, std::vector<CTransactionRef> &vtx);
+
 /** Precompute sighash midstate to avoid quadratic hashing */
 struct PrecomputedTransactionData {
     uint256 hashPrevouts, hashSequence, hashOutputs;
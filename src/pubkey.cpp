@@ -215,6 +215,40 @@ bool CPubKey::VerifySchnorr(const uint256 &hash,
                                     hash.begin(), &pubkey);
 }
 
+bool CPubKey::VerifySchnorrBatch(
+    const std::vector<const CPubKey *> &pubkeys,
+    const std::vector<const uint256 *> &hashes,
+    const std::vector<const std::vector<uint8_t> *> &sigs) {
+    const size_t n = pubkeys.size();
+    if (hashes.size() != n || sigs.size() != n) {
+        return false;
+    }
+
+    std::vector<secp256k1_pubkey> parsed(n);
+    std::vector<const secp256k1_pubkey *> vpubkeys(n);
+    std::vector<const uint8_t *> vmsgs(n);
+    std::vector<const uint8_t *> vsigs(n);
+    for (size_t i = 0; i < n; i++) {
+        const CPubKey &pubkey = *pubkeys[i];
+        if (!pubkey.IsValid() || sigs[i]->size() != 64) {
+            return false;
+        }
+
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed[i],
+                                       &pubkey[0], pubkey.size())) {
+            return false;
+        }
+
+        vpubkeys[i] = &parsed[i];
+        vmsgs[i] = hashes[i]->begin();
+        vsigs[i] = sigs[i]->data();
+    }
+
+    return secp256k1_schnorr_verify_batch(secp256k1_context_verify,
+                                          vsigs.data(), vmsgs.data(),
+                                          vpubkeys.data(), n);
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash,
                              const std::vector<uint8_t> &vchSig) {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE) {
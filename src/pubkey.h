@@ -165,6 +165,16 @@ public:
     bool VerifySchnorr(const uint256 &hash,
                        const std::vector<uint8_t> &vchSig) const;
 
+    /**
+     * Verify a batch of Schnorr signatures at once, the i-th signature being
+     * checked against the i-th public key and hash. This is faster than
+     * verifying them one by one, but only tells whether all of them are valid.
+     */
+    static bool
+    VerifySchnorrBatch(const std::vector<const CPubKey *> &pubkeys,
+                       const std::vector<const uint256 *> &hashes,
+                       const std::vector<const std::vector<uint8_t> *> &sigs);
+
     /**
      * Check whether a DER-serialized ECDSA signature is normalized (lower-S).
      */
@@ -240,33 +240,38 @@ static bool rest_block(const Config &config, HTTPRequest *req,
             return RESTERR(req, HTTP_NOT_FOUND,
                            hashStr + " not available (pruned data)");
         }
-
-        if (!ReadBlockFromDisk(block, pblockindex,
-                               config.GetChainParams().GetConsensus())) {
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
-        }
     }
 
-    CDataStream ssBlock(SER_NETWORK,
-                        PROTOCOL_VERSION | RPCSerializationFlags());
-    ssBlock << block;
-
     switch (rf) {
         case RetFormat::BINARY: {
-            std::string binaryBlock = ssBlock.str();
+            std::vector<uint8_t> block_data;
+            if (!ReadRawBlockFromDisk(block_data, pblockindex,
+                                      config.GetChainParams())) {
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+            }
             req->WriteHeader("Content-Type", "application/octet-stream");
-            req->WriteReply(HTTP_OK, binaryBlock);
+            req->WriteReply(HTTP_OK, std::string(block_data.begin(),
+                                                 block_data.end()));
             return true;
         }
 
         case RetFormat::HEX: {
-            std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+            std::vector<uint8_t> block_data;
+            if (!ReadRawBlockFromDisk(block_data, pblockindex,
+                                      config.GetChainParams())) {
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+            }
+            std::string strHex = HexStr(block_data) + "\n";
             req->WriteHeader("Content-Type", "text/plain");
             req->WriteReply(HTTP_OK, strHex);
             return true;
         }
 
         case RetFormat::JSON: {
+            if (!ReadBlockFromDisk(block, pblockindex,
+                                   config.GetChainParams().GetConsensus())) {
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+            }
             UniValue objBlock =
                 blockToJSON(block, tip, pblockindex, showTxDetails);
             std::string strJSON = objBlock.write() + "\n";
@@ -32,9 +32,11 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <mutex>
+#include <thread>
 
 struct CUpdatedBlock {
     uint256 hash;
@@ -606,7 +608,7 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
 
     UniValue spent(UniValue::VARR);
     const CTxMemPool::txiter &it = g_mempool.mapTx.find(tx.GetId());
-    const CTxMemPool::setEntries &setChildren =
+    const CTxMemPool::TxLinkSet &setChildren =
         g_mempool.GetMemPoolChildren(it);
     for (CTxMemPool::txiter childiter : setChildren) {
         spent.push_back(childiter->GetTx().GetId().ToString());
@@ -1068,6 +1070,22 @@ static CBlock GetBlockChecked(const Config &config,
     return block;
 }
 
+static std::vector<uint8_t> GetRawBlockChecked(const Config &config,
+                                               const CBlockIndex *pblockindex) {
+    std::vector<uint8_t> data;
+    if (fHavePruned && !pblockindex->nStatus.hasData() &&
+        pblockindex->nTx > 0) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
+
+    if (!ReadRawBlockFromDisk(data, pblockindex, config.GetChainParams())) {
+        // See GetBlockChecked.
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    }
+
+    return data;
+}
+
 static UniValue getblock(const Config &config, const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() < 1 ||
         request.params.size() > 2) {
@@ -1153,16 +1171,12 @@ static UniValue getblock(const Config &config, const JSONRPCRequest &request) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
 
-    const CBlock block = GetBlockChecked(config, pblockindex);
-
     if (verbosity <= 0) {
-        CDataStream ssBlock(SER_NETWORK,
-                            PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        return HexStr(GetRawBlockChecked(config, pblockindex));
     }
 
+    const CBlock block = GetBlockChecked(config, pblockindex);
+
     return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
 }
 
@@ -1181,7 +1195,13 @@ struct CCoinsStats {
           nDiskSize(0), nTotalAmount() {}
 };
 
-static void ApplyStats(CCoinsStats &stats, CHashWriter &ss, const uint256 &hash,
+//! Number of txid ranges the UTXO set is split into by GetUTXOStats
+static const size_t UTXO_STATS_RANGES = 256;
+//! Maximum number of threads GetUTXOStats scans the UTXO set with
+static const int MAX_UTXO_STATS_THREADS = 32;
+
+template <typename Stream>
+static void ApplyStats(CCoinsStats &stats, Stream &ss, const uint256 &hash,
                        const std::map<uint32_t, Coin> &outputs) {
     assert(!outputs.empty());
     ss << hash;
@@ -1203,25 +1223,23 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter &ss, const uint256 &hash,
     ss << VARINT(0u);
 }
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats) {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
-
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
-    }
-    ss << stats.hashBlock;
+/**
+ * Calculate statistics about the coins visited by a cursor, and serialize
+ * their contribution to hash_serialized into ss. Since ranges are split by
+ * txid, the outputs of a transaction are never spread across cursors.
+ */
+static bool GetUTXORangeStats(CCoinsViewCursor &cursor, CCoinsStats &stats,
+                              CDataStream &ss,
+                              const std::atomic<bool> &interrupt) {
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
+    while (cursor.Valid()) {
+        if (interrupt) {
+            return false;
+        }
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+        if (cursor.GetKey(key) && cursor.GetValue(coin)) {
             if (!outputs.empty() && key.GetTxId() != prevkey) {
                 ApplyStats(stats, ss, prevkey, outputs);
                 outputs.clear();
@@ -1231,11 +1249,133 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats) {
         } else {
             return error("%s: unable to read value", __func__);
         }
-        pcursor->Next();
+        cursor.Next();
     }
     if (!outputs.empty()) {
         ApplyStats(stats, ss, prevkey, outputs);
     }
+    return true;
+}
+
+/**
+ * Calculate statistics about the unspent transaction output set.
+ *
+ * The coin database is split into txid ranges which are scanned concurrently
+ * from a single snapshot. Each range is serialized into its own buffer, and
+ * the buffers are hashed in txid order as they complete so hash_serialized is
+ * the same as a sequential scan would produce. Workers never run more than a
+ * few ranges ahead of the hashing, which bounds the memory used.
+ */
+static bool GetUTXOStats(CCoinsViewDB *view, CCoinsStats &stats) {
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors =
+        view->RangeCursors(UTXO_STATS_RANGES);
+    const size_t nRanges = cursors.size();
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    stats.hashBlock = cursors.front()->GetBestBlock();
+    {
+        LOCK(cs_main);
+        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
+    }
+    ss << stats.hashBlock;
+
+    struct RangeResult {
+        CCoinsStats stats;
+        CDataStream data{SER_GETHASH, PROTOCOL_VERSION};
+        bool fDone = false;
+        bool fSuccess = false;
+    };
+    std::vector<RangeResult> results(nRanges);
+
+    const int nThreads =
+        std::max(1, std::min(GetNumCores(), MAX_UTXO_STATS_THREADS));
+    const size_t nWindow = 2 * nThreads;
+
+    Mutex cs_ranges;
+    std::condition_variable cond_ranges;
+    size_t nNextRange = 0;
+    size_t nHashed = 0;
+    std::atomic<bool> interrupt{false};
+
+    auto worker = [&]() {
+        while (true) {
+            size_t r;
+            {
+                WAIT_LOCK(cs_ranges, lock);
+                cond_ranges.wait(lock, [&] {
+                    return interrupt || nNextRange >= nRanges ||
+                           nNextRange < nHashed + nWindow;
+                });
+                if (interrupt || nNextRange >= nRanges) {
+                    return;
+                }
+                r = nNextRange++;
+            }
+            // Only this worker touches the range until it is marked as done.
+            RangeResult &result = results[r];
+            const bool fSuccess = GetUTXORangeStats(
+                *cursors[r], result.stats, result.data, interrupt);
+            cursors[r].reset();
+            {
+                LOCK(cs_ranges);
+                result.fSuccess = fSuccess;
+                result.fDone = true;
+            }
+            cond_ranges.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+
+    auto stopWorkers = [&]() {
+        interrupt = true;
+        cond_ranges.notify_all();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+    };
+
+    bool fSuccess = true;
+    try {
+        for (size_t r = 0; r < nRanges && fSuccess; r++) {
+            RangeResult &result = results[r];
+            while (true) {
+                boost::this_thread::interruption_point();
+                WAIT_LOCK(cs_ranges, lock);
+                if (result.fDone ||
+                    cond_ranges.wait_for(lock, std::chrono::milliseconds(100),
+                                         [&] { return result.fDone; })) {
+                    break;
+                }
+            }
+
+            fSuccess = result.fSuccess;
+            ss.write(result.data.data(), result.data.size());
+            stats.nTransactions += result.stats.nTransactions;
+            stats.nTransactionOutputs += result.stats.nTransactionOutputs;
+            stats.nBogoSize += result.stats.nBogoSize;
+            stats.nTotalAmount += result.stats.nTotalAmount;
+            // Release the buffer now that it has been hashed.
+            result.data = CDataStream(SER_GETHASH, PROTOCOL_VERSION);
+
+            {
+                LOCK(cs_ranges);
+                nHashed = r + 1;
+            }
+            cond_ranges.notify_all();
+        }
+    } catch (...) {
+        stopWorkers();
+        throw;
+    }
+    stopWorkers();
+
+    if (!fSuccess) {
+        return false;
+    }
     stats.hashSerialized = ss.GetHash();
     stats.nDiskSize = view->EstimateSize();
     return true;
@@ -5,10 +5,20 @@
 #ifndef BITCOIN_RPC_JSONRPCREQUEST_H
 #define BITCOIN_RPC_JSONRPCREQUEST_H
 
+#include <functional>
 #include <string>
 
 #include <univalue.h>
 
+/**
+ * Sends the reply to a deferred request, from any thread: either its result,
+ * already written as JSON so that many replies can share it, or an error
+ * object.
+ */
+typedef std::function<void(const std::string &strResult,
+                           const UniValue &error)>
+    JSONRPCReplyFunction;
+
 class JSONRPCRequest {
 public:
     UniValue id;
@@ -17,6 +27,12 @@ public:
     bool fHelp;
     std::string URI;
     std::string authUser;
+    /**
+     * Set by servers able to reply after the method returned, for requests
+     * outside of batches. A method calling it must reply through the function
+     * returned, even on errors, and its own result is ignored.
+     */
+    std::function<JSONRPCReplyFunction()> defer;
 
     JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
 
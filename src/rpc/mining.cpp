@@ -30,7 +30,10 @@
 
 #include <univalue.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <future>
+#include <iterator>
 #include <memory>
 
 /**
@@ -142,7 +145,8 @@ UniValue generateBlocks(const Config &config,
         {
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(),
-                                config.GetMaxBlockSize(), nExtraNonce);
+                                config.GetMaxBlockSize(), nExtraNonce,
+                                &pblocktemplate->coinbaseMerkleBranch);
         }
 
         while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount &&
@@ -302,6 +306,9 @@ static UniValue prioritisetransaction(const Config &config,
 
     g_mempool.PrioritiseTransaction(hash, request.params[1].get_real(),
                                     nAmount);
+    if (g_block_template_cache) {
+        g_block_template_cache->MarkStale();
+    }
     return true;
 }
 
@@ -329,6 +336,93 @@ static UniValue BIP22ValidationResult(const Config &config,
     return "valid?";
 }
 
+/**
+ * The current block template, as returned by getblocktemplate in template
+ * mode.
+ */
+static UniValue BlockTemplateToJSON(const Config &config)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+    // Get the template, kept up to date with the mempool.
+    const std::shared_ptr<const CBlockTemplate> pblocktemplate =
+        g_block_template_cache->Get();
+    const CBlockIndex *pindexPrev = chainActive.Tip();
+
+    // Update nTime, on a copy as the template is shared
+    CBlockHeader header = pblocktemplate->block.GetBlockHeader();
+    UpdateTime(&header, config.GetChainParams().GetConsensus(), pindexPrev);
+    header.nNonce = 0;
+
+    UniValue aCaps(UniValue::VARR);
+    aCaps.push_back("proposal");
+
+    UniValue transactions(UniValue::VARR);
+    int index_in_template = 0;
+    for (const auto &it : pblocktemplate->block.vtx) {
+        const CTransaction &tx = *it;
+        uint256 txId = tx.GetId();
+
+        if (tx.IsCoinBase()) {
+            index_in_template++;
+            continue;
+        }
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("data", EncodeHexTx(tx));
+        entry.pushKV("txid", txId.GetHex());
+        entry.pushKV("hash", tx.GetHash().GetHex());
+        entry.pushKV("fee", pblocktemplate->entries[index_in_template].txFee /
+                                SATOSHI);
+        int64_t nTxSigOps = pblocktemplate->entries[index_in_template].txSigOps;
+        entry.pushKV("sigops", nTxSigOps);
+
+        transactions.push_back(entry);
+        index_in_template++;
+    }
+
+    UniValue aux(UniValue::VOBJ);
+    aux.pushKV("flags", HexStr(COINBASE_FLAGS.begin(), COINBASE_FLAGS.end()));
+
+    arith_uint256 hashTarget = arith_uint256().SetCompact(header.nBits);
+
+    UniValue aMutable(UniValue::VARR);
+    aMutable.push_back("time");
+    aMutable.push_back("transactions");
+    aMutable.push_back("prevblock");
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("capabilities", aCaps);
+
+    result.pushKV("version", header.nVersion);
+
+    result.pushKV("previousblockhash", header.hashPrevBlock.GetHex());
+    result.pushKV("transactions", transactions);
+    result.pushKV("coinbaseaux", aux);
+    result.pushKV("coinbasevalue",
+                  int64_t(pblocktemplate->block.vtx[0]->vout[0].nValue /
+                          SATOSHI));
+    UniValue coinbaseMerkleBranch(UniValue::VARR);
+    for (const uint256 &hash : pblocktemplate->coinbaseMerkleBranch) {
+        coinbaseMerkleBranch.push_back(hash.GetHex());
+    }
+    result.pushKV("coinbasemerklebranch", coinbaseMerkleBranch);
+    // The coinbase entry holds the fees, negated.
+    result.pushKV("longpollid",
+                  header.hashPrevBlock.GetHex() +
+                      i64tostr(-pblocktemplate->entries[0].txFee / SATOSHI));
+    result.pushKV("target", hashTarget.GetHex());
+    result.pushKV("mintime", int64_t(pindexPrev->GetMedianTimePast()) + 1);
+    result.pushKV("mutable", aMutable);
+    result.pushKV("noncerange", "00000000ffffffff");
+    // FIXME: Allow for mining block greater than 1M.
+    result.pushKV("sigoplimit", GetMaxBlockSigOpsCount(DEFAULT_MAX_BLOCK_SIZE));
+    result.pushKV("sizelimit", DEFAULT_MAX_BLOCK_SIZE);
+    result.pushKV("curtime", header.GetBlockTime());
+    result.pushKV("bits", strprintf("%08x", header.nBits));
+    result.pushKV("height", int64_t(pindexPrev->nHeight) + 1);
+
+    return result;
+}
+
 static UniValue getblocktemplate(const Config &config,
                                  const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() > 1) {
@@ -413,6 +507,12 @@ static UniValue getblocktemplate(const Config &config,
             "transaction fees (in satoshis)\n"
             "  \"coinbasetxn\" : { ... },          (json object) information "
             "for coinbase transaction\n"
+            "  \"coinbasemerklebranch\" : [        (array of string) the "
+            "hashes the coinbase txid is combined with, from the bottom up, to "
+            "compute the merkle root, hex-encoded like txids\n"
+            "     \"xxxx\"\n"
+            "     ,...\n"
+            "  ],\n"
             "  \"target\" : \"xxxx\",                (string) The hash target\n"
             "  \"mintime\" : xxx,                  (numeric) The minimum "
             "timestamp appropriate for next block time in seconds since epoch "
@@ -519,48 +619,58 @@ static UniValue getblocktemplate(const Config &config,
                            "Bitcoin is downloading blocks...");
     }
 
-    static unsigned int nTransactionsUpdatedLast;
-
     if (!lpval.isNull()) {
-        // Wait to respond until either the best block changes, OR a minute has
-        // passed and there are more transactions
+        // Wait to respond until either the best block changes, or the fees of
+        // the template grow by -longpollfeeincrease.
         uint256 hashWatchedChain;
-        std::chrono::steady_clock::time_point checktxtime;
-        unsigned int nTransactionsUpdatedLastLP;
+        Amount nFeesLP;
 
         if (lpval.isStr()) {
-            // Format: <hashBestChain><nTransactionsUpdatedLast>
+            // Format: <hashBestChain><template fees in satoshis>
             std::string lpstr = lpval.get_str();
 
             hashWatchedChain.SetHex(lpstr.substr(0, 64));
-            nTransactionsUpdatedLastLP = atoi64(lpstr.substr(64));
+            nFeesLP = atoi64(lpstr.substr(64)) * SATOSHI;
         } else {
             // NOTE: Spec does not specify behaviour for non-string longpollid,
             // but this makes testing easier
             hashWatchedChain = chainActive.Tip()->GetBlockHash();
-            nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+            nFeesLP = g_block_template_cache->GetFees();
         }
 
-        // Release the wallet and main lock while waiting
-        LEAVE_CRITICAL_SECTION(cs_main);
-        {
-            checktxtime =
-                std::chrono::steady_clock::now() + std::chrono::minutes(1);
-
-            WAIT_LOCK(g_best_block_mutex, lock);
-            while (g_best_block == hashWatchedChain && IsRPCRunning()) {
-                if (g_best_block_cv.wait_until(lock, checktxtime) ==
-                    std::cv_status::timeout) {
-                    // Timeout: Check transactions for update
-                    if (g_mempool.GetTransactionsUpdated() !=
-                        nTransactionsUpdatedLastLP) {
-                        break;
-                    }
-                    checktxtime += std::chrono::seconds(10);
+        if (request.defer) {
+            // The reply is sent once a better template is available, without
+            // holding this thread meanwhile.
+            if (g_block_template_longpolls->Wait(hashWatchedChain, nFeesLP,
+                                                 request.defer)) {
+                return NullUniValue;
+            }
+        } else {
+            // Replies can't be deferred, e.g. in a batch: block until there
+            // is a reply.
+            typedef std::pair<std::string, UniValue> Reply;
+            auto promise = std::make_shared<std::promise<Reply>>();
+            std::future<Reply> future = promise->get_future();
+            if (g_block_template_longpolls->Wait(
+                    hashWatchedChain, nFeesLP, [promise] {
+                        return [promise](const std::string &strResult,
+                                         const UniValue &error) {
+                            promise->set_value(Reply(strResult, error));
+                        };
+                    })) {
+                // Release the main lock while waiting
+                LEAVE_CRITICAL_SECTION(cs_main);
+                const Reply reply = future.get();
+                ENTER_CRITICAL_SECTION(cs_main);
+
+                if (!reply.second.isNull()) {
+                    throw reply.second;
                 }
+                UniValue result;
+                result.read(reply.first);
+                return result;
             }
         }
-        ENTER_CRITICAL_SECTION(cs_main);
 
         if (!IsRPCRunning()) {
             throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
@@ -569,103 +679,7 @@ static UniValue getblocktemplate(const Config &config,
         // expires-immediately template to stop miners?
     }
 
-    // Update block
-    static CBlockIndex *pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != chainActive.Tip() ||
-        (g_mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast &&
-         GetTime() - nStart > 5)) {
-        // Clear pindexPrev so future calls make a new block, despite any
-        // failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = g_mempool.GetTransactionsUpdated();
-        CBlockIndex *pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate =
-            BlockAssembler(config, g_mempool).CreateNewBlock(scriptDummy);
-        if (!pblocktemplate) {
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-        }
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
-
-    assert(pindexPrev);
-    // pointer for convenience
-    CBlock *pblock = &pblocktemplate->block;
-
-    // Update nTime
-    UpdateTime(pblock, config.GetChainParams().GetConsensus(), pindexPrev);
-    pblock->nNonce = 0;
-
-    UniValue aCaps(UniValue::VARR);
-    aCaps.push_back("proposal");
-
-    UniValue transactions(UniValue::VARR);
-    int index_in_template = 0;
-    for (const auto &it : pblock->vtx) {
-        const CTransaction &tx = *it;
-        uint256 txId = tx.GetId();
-
-        if (tx.IsCoinBase()) {
-            index_in_template++;
-            continue;
-        }
-
-        UniValue entry(UniValue::VOBJ);
-        entry.pushKV("data", EncodeHexTx(tx));
-        entry.pushKV("txid", txId.GetHex());
-        entry.pushKV("hash", tx.GetHash().GetHex());
-        entry.pushKV("fee", pblocktemplate->entries[index_in_template].txFee /
-                                SATOSHI);
-        int64_t nTxSigOps = pblocktemplate->entries[index_in_template].txSigOps;
-        entry.pushKV("sigops", nTxSigOps);
-
-        transactions.push_back(entry);
-        index_in_template++;
-    }
-
-    UniValue aux(UniValue::VOBJ);
-    aux.pushKV("flags", HexStr(COINBASE_FLAGS.begin(), COINBASE_FLAGS.end()));
-
-    arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
-
-    UniValue aMutable(UniValue::VARR);
-    aMutable.push_back("time");
-    aMutable.push_back("transactions");
-    aMutable.push_back("prevblock");
-
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("capabilities", aCaps);
-
-    result.pushKV("version", pblock->nVersion);
-
-    result.pushKV("previousblockhash", pblock->hashPrevBlock.GetHex());
-    result.pushKV("transactions", transactions);
-    result.pushKV("coinbaseaux", aux);
-    result.pushKV("coinbasevalue",
-                  int64_t(pblock->vtx[0]->vout[0].nValue / SATOSHI));
-    result.pushKV("longpollid", chainActive.Tip()->GetBlockHash().GetHex() +
-                                    i64tostr(nTransactionsUpdatedLast));
-    result.pushKV("target", hashTarget.GetHex());
-    result.pushKV("mintime", int64_t(pindexPrev->GetMedianTimePast()) + 1);
-    result.pushKV("mutable", aMutable);
-    result.pushKV("noncerange", "00000000ffffffff");
-    // FIXME: Allow for mining block greater than 1M.
-    result.pushKV("sigoplimit", GetMaxBlockSigOpsCount(DEFAULT_MAX_BLOCK_SIZE));
-    result.pushKV("sizelimit", DEFAULT_MAX_BLOCK_SIZE);
-    result.pushKV("curtime", pblock->GetBlockTime());
-    result.pushKV("bits", strprintf("%08x", pblock->nBits));
-    result.pushKV("height", int64_t(pindexPrev->nHeight) + 1);
-
-    return result;
+    return BlockTemplateToJSON(config);
 }
 
 class submitblock_StateCatcher : public CValidationInterface {
@@ -813,6 +827,124 @@ static UniValue estimatefee(const Config &config,
 }
 
 // clang-format off
+std::unique_ptr<BlockTemplateLongPolls> g_block_template_longpolls;
+
+BlockTemplateLongPolls::BlockTemplateLongPolls(const Config &configIn,
+                                               const Amount nFeeIncreaseIn)
+    : config(configIn), nFeeIncrease(nFeeIncreaseIn) {}
+
+bool BlockTemplateLongPolls::IsBetter(const LongPoll &longpoll,
+                                      const uint256 &hashPrevBlock,
+                                      const Amount nFees) const {
+    return hashPrevBlock != longpoll.hashPrevBlock ||
+           nFees >= longpoll.nFees + nFeeIncrease;
+}
+
+void BlockTemplateLongPolls::Answer() {
+    LOCK(cs_answer);
+    {
+        LOCK(cs);
+        if (vLongPolls.empty()) {
+            return;
+        }
+    }
+
+    uint256 hashTip;
+    {
+        LOCK(g_best_block_mutex);
+        hashTip = g_best_block;
+    }
+    Amount nFees;
+    try {
+        nFees = g_block_template_cache->GetFees();
+    } catch (const std::runtime_error &e) {
+        // Answer on tip changes only, until a template can be assembled.
+        nFees = Amount::zero();
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+
+    std::vector<LongPoll> vAnswered;
+    {
+        LOCK(cs);
+        auto it = std::partition(vLongPolls.begin(), vLongPolls.end(),
+                                 [&](const LongPoll &longpoll) {
+                                     return !IsBetter(longpoll, hashTip, nFees);
+                                 });
+        std::move(it, vLongPolls.end(), std::back_inserter(vAnswered));
+        vLongPolls.erase(it, vLongPolls.end());
+    }
+    if (vAnswered.empty()) {
+        return;
+    }
+
+    // The template is written once for all the long polls answered.
+    std::string strResult;
+    UniValue error;
+    try {
+        LOCK(cs_main);
+        strResult = BlockTemplateToJSON(config).write();
+    } catch (const UniValue &objError) {
+        error = objError;
+    } catch (const std::exception &e) {
+        error = JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+    for (const LongPoll &longpoll : vAnswered) {
+        longpoll.reply(strResult, error);
+    }
+}
+
+void BlockTemplateLongPolls::UpdatedBlockTip(const CBlockIndex *pindexNew,
+                                             const CBlockIndex *pindexFork,
+                                             bool fInitialDownload) {
+    Answer();
+}
+
+void BlockTemplateLongPolls::TransactionAddedToMempool(
+    const CTransactionRef &ptx) {
+    Answer();
+}
+
+bool BlockTemplateLongPolls::Wait(
+    const uint256 &hashPrevBlock, const Amount nFees,
+    const std::function<JSONRPCReplyFunction()> &defer) {
+    // The template is checked while holding cs, so that any better template
+    // is either seen here or answers the new long poll in Answer().
+    LOCK(cs);
+    if (fStopped) {
+        return false;
+    }
+
+    LongPoll longpoll{hashPrevBlock, nFees, nullptr};
+    uint256 hashTip;
+    {
+        LOCK(g_best_block_mutex);
+        hashTip = g_best_block;
+    }
+    if (IsBetter(longpoll, hashTip, g_block_template_cache->GetFees())) {
+        return false;
+    }
+
+    longpoll.reply = defer();
+    vLongPolls.push_back(std::move(longpoll));
+    return true;
+}
+
+void BlockTemplateLongPolls::Stop() {
+    LOCK(cs_answer);
+    std::vector<LongPoll> vAnswered;
+    {
+        LOCK(cs);
+        fStopped = true;
+        vAnswered.swap(vLongPolls);
+    }
+
+    const UniValue error =
+        JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+    for (const LongPoll &longpoll : vAnswered) {
+        longpoll.reply("", error);
+    }
+}
+
 static const ContextFreeRPCCommand commands[] = {
     //  category   name                     actor (function)       argNames
     //  ---------- ------------------------ ---------------------- ----------
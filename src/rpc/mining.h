@@ -5,17 +5,87 @@
 #ifndef BITCOIN_RPC_MINING_H
 #define BITCOIN_RPC_MINING_H
 
+#include <amount.h>
+#include <rpc/jsonrpcrequest.h>
 #include <script/script.h>
+#include <sync.h>
+#include <uint256.h>
+#include <validationinterface.h>
 
 #include <univalue.h>
 
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 class Config;
 
+/** Default for -longpollfeeincrease */
+static const Amount DEFAULT_LONGPOLL_FEE_INCREASE = COIN / 10000;
+
 /** Generate blocks (mine) */
 UniValue generateBlocks(const Config &config,
                         std::shared_ptr<CReserveScript> coinbaseScript,
                         int nGenerate, uint64_t nMaxTries, bool keepScript);
 
+/**
+ * getblocktemplate long polls (BIP22), waiting for a better template than the
+ * one they know of: one on a new tip, or one whose fees grew by at least
+ * -longpollfeeincrease.
+ *
+ * Waiting holds no RPC thread, as the replies are deferred. They are sent from
+ * the validation interface thread, with the template written once for all
+ * the long polls it answers.
+ */
+class BlockTemplateLongPolls final : public CValidationInterface {
+private:
+    struct LongPoll {
+        uint256 hashPrevBlock;
+        Amount nFees;
+        JSONRPCReplyFunction reply;
+    };
+
+    const Config &config;
+    const Amount nFeeIncrease;
+
+    //! Held while replying, so that no reply is sent once Stop() returns
+    Mutex cs_answer;
+    Mutex cs;
+    std::vector<LongPoll> vLongPolls GUARDED_BY(cs);
+    bool fStopped GUARDED_BY(cs) = false;
+
+    /** Whether a template is better than the one a long poll knows of. */
+    bool IsBetter(const LongPoll &longpoll, const uint256 &hashPrevBlock,
+                  const Amount nFees) const;
+    /** Reply to the long polls the current template is better for. */
+    void Answer() LOCKS_EXCLUDED(cs_main, cs_answer, cs);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew,
+                         const CBlockIndex *pindexFork,
+                         bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptx) override;
+
+public:
+    BlockTemplateLongPolls(const Config &configIn, const Amount nFeeIncreaseIn);
+
+    /**
+     * Wait for a template better than the one on hashPrevBlock with nFees,
+     * and reply with it through the function defer returns.
+     *
+     * @return false, without calling defer, if the current template is better
+     * already or if long polls are stopped.
+     *
+     * Must be called holding cs_main, which is taken before cs.
+     */
+    bool Wait(const uint256 &hashPrevBlock, const Amount nFees,
+              const std::function<JSONRPCReplyFunction()> &defer)
+        LOCKS_EXCLUDED(cs);
+    /** Reply to all the long polls with an error, and refuse new ones. */
+    void Stop() LOCKS_EXCLUDED(cs_answer, cs);
+};
+
+extern std::unique_ptr<BlockTemplateLongPolls> g_block_template_longpolls;
+
 #endif // BITCOIN_RPC_MINING_H
@@ -52,6 +52,13 @@ std::string JSONRPCReply(const UniValue &result, const UniValue &error,
     return reply.write() + "\n";
 }
 
+std::string JSONRPCWrittenReply(const std::string &strResult,
+                                const UniValue &id) {
+    // As written by JSONRPCReply, without writing the result again.
+    return "{\"result\":" + strResult + ",\"error\":null,\"id\":" +
+           id.write() + "}\n";
+}
+
 UniValue JSONRPCError(int code, const std::string &message) {
     UniValue error(UniValue::VOBJ);
     error.pushKV("code", code);
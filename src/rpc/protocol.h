@@ -128,6 +128,9 @@ UniValue JSONRPCReplyObj(const UniValue &result, const UniValue &error,
                          const UniValue &id);
 std::string JSONRPCReply(const UniValue &result, const UniValue &error,
                          const UniValue &id);
+/** Same as JSONRPCReply, for a result already written as JSON. */
+std::string JSONRPCWrittenReply(const std::string &strResult,
+                                const UniValue &id);
 UniValue JSONRPCError(int code, const std::string &message);
 
 /** Generate a new RPC authentication cookie and write it to disk */
@@ -1328,6 +1328,152 @@ static UniValue sendrawtransaction(const Config &config,
     return txid.GetHex();
 }
 
+/**
+ * Push the result of the mempool acceptance of a transaction, under the given
+ * key, and the reason why it was rejected if it was.
+ */
+static void PushMempoolAcceptResult(UniValue &result, const std::string &key,
+                                    bool fAccepted,
+                                    const CValidationState &state,
+                                    bool fMissingInputs) {
+    result.pushKV(key, fAccepted);
+    if (fAccepted) {
+        return;
+    }
+    if (state.IsInvalid()) {
+        result.pushKV("reject-reason",
+                      strprintf("%i: %s", state.GetRejectCode(),
+                                state.GetRejectReason()));
+    } else if (fMissingInputs) {
+        result.pushKV("reject-reason", "missing-inputs");
+    } else {
+        result.pushKV("reject-reason", state.GetRejectReason());
+    }
+}
+
+static UniValue sendrawtransactions(const Config &config,
+                                    const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 ||
+        request.params.size() > 2) {
+        throw std::runtime_error(
+            // clang-format off
+            "sendrawtransactions [\"rawtxs\"] ( allowhighfees )\n"
+            "\nSubmits raw transactions (serialized, hex-encoded) to local node and network.\n"
+            "\nThe transactions may spend each other, in any order. Their scripts are checked\n"
+            "in parallel, and they are announced to peers once all of them are processed.\n"
+            "\nSee sendrawtransaction call.\n"
+            "\nArguments:\n"
+            "1. [\"rawtxs\"]       (array, required) An array of hex strings of raw transactions.\n"
+            "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
+            "\nResult:\n"
+            "[                   (array) The result of the submission of each raw transaction in the input array.\n"
+            " {\n"
+            "  \"txid\"           (string) The transaction hash in hex\n"
+            "  \"accepted\"       (boolean) If the transaction is in the mempool\n"
+            "  \"reject-reason\"  (string) Rejection string (only present when 'accepted' is false)\n"
+            " }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("sendrawtransactions", "\"[\\\"signedhex\\\",\\\"signedhex\\\"]\"") +
+            "\nAs a json rpc call\n"
+            + HelpExampleRpc("sendrawtransactions", "[\"signedhex\",\"signedhex\"]")
+            // clang-format on
+        );
+    }
+
+    RPCTypeCheck(request.params, {UniValue::VARR, UniValue::VBOOL});
+    const UniValue &rawtxs = request.params[0].get_array();
+
+    std::vector<CTransactionRef> txs;
+    for (size_t i = 0; i < rawtxs.size(); i++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, rawtxs[i].get_str())) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR,
+                               strprintf("TX decode failed for rawtxs[%u]", i));
+        }
+        txs.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    Amount nMaxRawTxFee = maxTxFee;
+    if (!request.params[1].isNull() && request.params[1].get_bool()) {
+        nMaxRawTxFee = Amount::zero();
+    }
+
+    // Transactions already confirmed are rejected, and those already in the
+    // mempool are announced again, as by sendrawtransaction.
+    std::vector<UniValue> vResults(txs.size(), UniValue(UniValue::VOBJ));
+    std::vector<CTransactionRef> vSubmit;
+    std::vector<size_t> vSubmitIndex;
+    std::vector<TxId> vRelay;
+    {
+        LOCK(cs_main);
+        CCoinsViewCache &view = *pcoinsTip;
+        for (size_t i = 0; i < txs.size(); i++) {
+            const TxId &txid = txs[i]->GetId();
+            vResults[i].pushKV("txid", txid.GetHex());
+
+            bool fHaveChain = false;
+            for (size_t o = 0; !fHaveChain && o < txs[i]->vout.size(); o++) {
+                const Coin &existingCoin = view.AccessCoin(COutPoint(txid, o));
+                fHaveChain = !existingCoin.IsSpent();
+            }
+
+            if (fHaveChain) {
+                vResults[i].pushKV("accepted", false);
+                vResults[i].pushKV("reject-reason",
+                                   "transaction already in block chain");
+            } else if (g_mempool.exists(txid)) {
+                vResults[i].pushKV("accepted", true);
+                vRelay.push_back(txid);
+            } else {
+                vSubmit.push_back(txs[i]);
+                vSubmitIndex.push_back(i);
+            }
+        }
+    }
+
+    std::vector<bool> vAccepted;
+    std::vector<CValidationState> states;
+    std::vector<bool> vMissingInputs;
+    const size_t nAccepted =
+        AcceptToMemoryPoolBatch(config, g_mempool, vSubmit, vAccepted, states,
+                                vMissingInputs, false, nMaxRawTxFee);
+    for (size_t n = 0; n < vSubmit.size(); n++) {
+        PushMempoolAcceptResult(vResults[vSubmitIndex[n]], "accepted",
+                                vAccepted[n], states[n], vMissingInputs[n]);
+        if (vAccepted[n]) {
+            vRelay.push_back(vSubmit[n]->GetId());
+        }
+    }
+
+    // If wallet is enabled, ensure that the wallet has been made aware of the
+    // new transactions prior to returning, as sendrawtransaction does.
+    if (nAccepted > 0) {
+        std::promise<void> promise;
+        CallFunctionInValidationInterfaceQueue(
+            [&promise] { promise.set_value(); });
+        promise.get_future().wait();
+    }
+
+    if (!g_connman) {
+        throw JSONRPCError(
+            RPC_CLIENT_P2P_DISABLED,
+            "Error: Peer-to-peer functionality missing or disabled");
+    }
+
+    g_connman->ForEachNode([&vRelay](CNode *pnode) {
+        for (const TxId &txid : vRelay) {
+            pnode->PushInventory(CInv(MSG_TX, txid));
+        }
+    });
+
+    UniValue result(UniValue::VARR);
+    for (UniValue &txResult : vResults) {
+        result.push_back(std::move(txResult));
+    }
+    return result;
+}
+
 static UniValue validaterawtransaction(const Config &config,
                                    const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() < 1 ||
@@ -1411,16 +1557,17 @@ static UniValue testmempoolaccept(const Config &config,
         throw std::runtime_error(
             // clang-format off
             "testmempoolaccept [\"rawtxs\"] ( allowhighfees )\n"
-            "\nReturns if raw transaction (serialized, hex-encoded) would be accepted by mempool.\n"
-            "\nThis checks if the transaction violates the consensus or policy rules.\n"
-            "\nSee sendrawtransaction call.\n"
+            "\nReturns if raw transactions (serialized, hex-encoded) would be accepted by mempool.\n"
+            "\nThis checks if the transactions violate the consensus or policy rules.\n"
+            "Several transactions are tested as a package: they may spend each other, in any\n"
+            "order, as with sendrawtransactions. Their ancestors within the package do not\n"
+            "count against the mempool ancestor limits.\n"
+            "\nSee sendrawtransaction and sendrawtransactions calls.\n"
             "\nArguments:\n"
             "1. [\"rawtxs\"]       (array, required) An array of hex strings of raw transactions.\n"
-            "                                        Length must be one for now.\n"
             "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
             "\nResult:\n"
             "[                   (array) The result of the mempool acceptance test for each raw transaction in the input array.\n"
-            "                            Length is exactly one for now.\n"
             " {\n"
             "  \"txid\"           (string) The transaction hash in hex\n"
             "  \"allowed\"        (boolean) If the mempool allows this tx to be inserted\n"
@@ -1441,18 +1588,20 @@ static UniValue testmempoolaccept(const Config &config,
     }
 
     RPCTypeCheck(request.params, {UniValue::VARR, UniValue::VBOOL});
-    if (request.params[0].get_array().size() != 1) {
-        throw JSONRPCError(
-            RPC_INVALID_PARAMETER,
-            "Array must contain exactly one raw transaction for now");
+    const UniValue &rawtxs = request.params[0].get_array();
+    if (rawtxs.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER,
+                           "Array must contain at least one raw transaction");
     }
 
-    CMutableTransaction mtx;
-    if (!DecodeHexTx(mtx, request.params[0].get_array()[0].get_str())) {
-        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "TX decode failed");
+    std::vector<CTransactionRef> txs;
+    for (size_t i = 0; i < rawtxs.size(); i++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, rawtxs[i].get_str())) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "TX decode failed");
+        }
+        txs.push_back(MakeTransactionRef(std::move(mtx)));
     }
-    CTransactionRef tx(MakeTransactionRef(std::move(mtx)));
-    const uint256 &txid = tx->GetId();
 
     bool fLimitFree = false;
     Amount max_raw_tx_fee = maxTxFee;
@@ -1460,34 +1609,21 @@ static UniValue testmempoolaccept(const Config &config,
         max_raw_tx_fee = Amount::zero();
     }
 
-    UniValue result(UniValue::VARR);
-    UniValue result_0(UniValue::VOBJ);
-    result_0.pushKV("txid", txid.GetHex());
+    std::vector<bool> vAccepted;
+    std::vector<CValidationState> states;
+    std::vector<bool> vMissingInputs;
+    AcceptToMemoryPoolBatch(config, g_mempool, txs, vAccepted, states,
+                            vMissingInputs, fLimitFree, max_raw_tx_fee,
+                            /* test_accept */ true);
 
-    CValidationState state;
-    bool missing_inputs;
-    bool test_accept_res;
-    {
-        LOCK(cs_main);
-        test_accept_res = AcceptToMemoryPool(
-            config, g_mempool, state, std::move(tx), fLimitFree,
-            &missing_inputs, /* bypass_limits */ false, max_raw_tx_fee,
-            /* test_accept */ true);
-    }
-    result_0.pushKV("allowed", test_accept_res);
-    if (!test_accept_res) {
-        if (state.IsInvalid()) {
-            result_0.pushKV("reject-reason",
-                            strprintf("%i: %s", state.GetRejectCode(),
-                                      state.GetRejectReason()));
-        } else if (missing_inputs) {
-            result_0.pushKV("reject-reason", "missing-inputs");
-        } else {
-            result_0.pushKV("reject-reason", state.GetRejectReason());
-        }
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < txs.size(); i++) {
+        UniValue result_i(UniValue::VOBJ);
+        result_i.pushKV("txid", txs[i]->GetId().GetHex());
+        PushMempoolAcceptResult(result_i, "allowed", vAccepted[i], states[i],
+                                vMissingInputs[i]);
+        result.push_back(std::move(result_i));
     }
-
-    result.push_back(std::move(result_0));
     return result;
 }
 
@@ -1500,6 +1636,7 @@ static const ContextFreeRPCCommand commands[] = {
     { "rawtransactions",    "decoderawtransaction",      decoderawtransaction,      {"hexstring"} },
     { "rawtransactions",    "decodescript",              decodescript,              {"hexstring"} },
     { "rawtransactions",    "sendrawtransaction",        sendrawtransaction,        {"hexstring","allowhighfees"} },
+    { "rawtransactions",    "sendrawtransactions",       sendrawtransactions,       {"rawtxs","allowhighfees"} },
     { "rawtransactions",    "validaterawtransaction", validaterawtransaction, {"hexstring","allowhighfees"} },
     { "rawtransactions",    "combinerawtransaction",     combinerawtransaction,     {"txs"} },
     { "rawtransactions",    "signrawtransactionwithkey", signrawtransactionwithkey, {"hexstring","privkeys","prevtxs","sighashtype"} },
@@ -1694,9 +1694,10 @@ bool GenericTransactionSignatureChecker<T>::CheckSequence(
 template class GenericTransactionSignatureChecker<CTransaction>;
 template class GenericTransactionSignatureChecker<CMutableTransaction>;
 
-bool VerifyScript(const CScript &scriptSig, const CScript &scriptPubKey,
-                  uint32_t flags, const BaseSignatureChecker &checker,
-                  ScriptError *serror) {
+bool VerifyScriptGeneric(const CScript &scriptSig,
+                         const CScript &scriptPubKey, uint32_t flags,
+                         const BaseSignatureChecker &checker,
+                         ScriptError *serror) {
     set_error(serror, ScriptError::UNKNOWN);
 
     // If FORKID is enabled, we also ensure strict encoding.
@@ -1782,3 +1783,184 @@ bool VerifyScript(const CScript &scriptSig, const CScript &scriptPubKey,
 
     return set_success(serror);
 }
+
+/**
+ * Read the data pushes of a script onto the stack, as EvalScript would.
+ * Returns false if the script contains anything else, or any push that
+ * EvalScript would reject, so the interpreter can report the error.
+ */
+static bool GetDataPushes(const CScript &script, uint32_t flags,
+                          std::vector<valtype> &stack) {
+    if (script.size() > MAX_SCRIPT_SIZE) {
+        return false;
+    }
+
+    const bool fRequireMinimal = (flags & SCRIPT_VERIFY_MINIMALDATA) != 0;
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    valtype vchPushValue;
+    while (pc < script.end()) {
+        if (!script.GetOp(pc, opcode, vchPushValue) || opcode > OP_PUSHDATA4 ||
+            vchPushValue.size() > MAX_SCRIPT_ELEMENT_SIZE ||
+            (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) ||
+            stack.size() >= MAX_STACK_SIZE) {
+            return false;
+        }
+        stack.push_back(std::move(vchPushValue));
+    }
+
+    return true;
+}
+
+/**
+ * OP_CHECKSIG followed by the end of the scripts, the script code being the
+ * whole scriptPubKey.
+ */
+static bool VerifyCheckSig(const valtype &vchSig, const valtype &vchPubKey,
+                           const CScript &scriptPubKey, uint32_t flags,
+                           const BaseSignatureChecker &checker,
+                           ScriptError *serror) {
+    if (!CheckTransactionSignatureEncoding(vchSig, flags, serror) ||
+        !CheckPubKeyEncoding(vchPubKey, flags, serror)) {
+        // serror is set
+        return false;
+    }
+
+    bool fSuccess;
+    if (!(flags & SCRIPT_ENABLE_SIGHASH_FORKID) ||
+        !GetHashType(vchSig).hasForkId()) {
+        // Only copy the script code when the signature has to be removed.
+        CScript scriptCode(scriptPubKey);
+        CleanupScriptCode(scriptCode, vchSig, flags);
+        fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, flags);
+    } else {
+        fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptPubKey, flags);
+    }
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size()) {
+        return set_error(serror, ScriptError::SIG_NULLFAIL);
+    }
+    if (!fSuccess) {
+        return set_error(serror, ScriptError::EVAL_FALSE);
+    }
+
+    return set_success(serror);
+}
+
+static bool IsPayToPubKeyHash(const CScript &script) {
+    return script.size() == 25 && script[0] == OP_DUP &&
+           script[1] == OP_HASH160 && script[2] == 20 &&
+           script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG;
+}
+
+static bool IsPayToPubKey(const CScript &script) {
+    return ((script.size() == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE + 2 &&
+             script[0] == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE) ||
+            (script.size() == CPubKey::PUBLIC_KEY_SIZE + 2 &&
+             script[0] == CPubKey::PUBLIC_KEY_SIZE)) &&
+           script.back() == OP_CHECKSIG;
+}
+
+static bool HashEquals(const valtype &vch, const uint8_t *hash) {
+    uint160 hashPushed;
+    CHash160().Write(vch.data(), vch.size()).Finalize(hashPushed.begin());
+    return std::equal(hashPushed.begin(), hashPushed.end(), hash);
+}
+
+bool VerifyStandardScript(const CScript &scriptSig, const CScript &scriptPubKey,
+                          uint32_t flags, const BaseSignatureChecker &checker,
+                          bool &fSuccess, ScriptError *serror) {
+    // If FORKID is enabled, we also ensure strict encoding.
+    if (flags & SCRIPT_ENABLE_SIGHASH_FORKID) {
+        flags |= SCRIPT_VERIFY_STRICTENC;
+    }
+
+    // Leave the misuse of CLEANSTACK to the interpreter.
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) && !(flags & SCRIPT_VERIFY_P2SH)) {
+        return false;
+    }
+
+    std::vector<valtype> stack;
+    if (IsPayToPubKeyHash(scriptPubKey)) {
+        // <sig> <pubkey> | DUP HASH160 <hash> EQUALVERIFY CHECKSIG
+        stack.reserve(2);
+        if (!GetDataPushes(scriptSig, flags, stack) || stack.size() != 2) {
+            return false;
+        }
+        if (!HashEquals(stack[1], &scriptPubKey[3])) {
+            fSuccess = set_error(serror, ScriptError::EQUALVERIFY);
+            return true;
+        }
+        fSuccess = VerifyCheckSig(stack[0], stack[1], scriptPubKey, flags,
+                                  checker, serror);
+        return true;
+    }
+
+    if (IsPayToPubKey(scriptPubKey)) {
+        // <sig> | <pubkey> CHECKSIG
+        stack.reserve(1);
+        if (!GetDataPushes(scriptSig, flags, stack) || stack.size() != 1) {
+            return false;
+        }
+        const valtype vchPubKey(scriptPubKey.begin() + 1,
+                                scriptPubKey.end() - 1);
+        fSuccess = VerifyCheckSig(stack[0], vchPubKey, scriptPubKey, flags,
+                                  checker, serror);
+        return true;
+    }
+
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash()) {
+        // <data>... <redeemScript> | HASH160 <hash> EQUAL, then the redeem
+        // script is run by the interpreter on the data pushed.
+        if (!GetDataPushes(scriptSig, flags, stack) || stack.empty() ||
+            stack.size() >= MAX_STACK_SIZE) {
+            return false;
+        }
+        if (!HashEquals(stack.back(), &scriptPubKey[2])) {
+            fSuccess = set_error(serror, ScriptError::EVAL_FALSE);
+            return true;
+        }
+
+        CScript redeemScript(stack.back().begin(), stack.back().end());
+        stack.pop_back();
+
+        // Same as in VerifyScriptGeneric.
+        if ((flags & SCRIPT_DISALLOW_SEGWIT_RECOVERY) == 0 && stack.empty() &&
+            redeemScript.IsWitnessProgram()) {
+            fSuccess = set_success(serror);
+            return true;
+        }
+
+        if (!EvalScript(stack, redeemScript, flags, checker, serror)) {
+            // serror is set
+            fSuccess = false;
+            return true;
+        }
+        if (stack.empty() || !CastToBool(stack.back())) {
+            fSuccess = set_error(serror, ScriptError::EVAL_FALSE);
+            return true;
+        }
+        if ((flags & SCRIPT_VERIFY_CLEANSTACK) != 0 && stack.size() != 1) {
+            fSuccess = set_error(serror, ScriptError::CLEANSTACK);
+            return true;
+        }
+
+        fSuccess = set_success(serror);
+        return true;
+    }
+
+    return false;
+}
+
+bool VerifyScript(const CScript &scriptSig, const CScript &scriptPubKey,
+                  uint32_t flags, const BaseSignatureChecker &checker,
+                  ScriptError *serror) {
+    bool fSuccess;
+    if (VerifyStandardScript(scriptSig, scriptPubKey, flags, checker, fSuccess,
+                             serror)) {
+        return fSuccess;
+    }
+
+    return VerifyScriptGeneric(scriptSig, scriptPubKey, flags, checker,
+                               serror);
+}
@@ -89,6 +89,25 @@ bool VerifyScript(const CScript &scriptSig, const CScript &scriptPubKey,
                   uint32_t flags, const BaseSignatureChecker &checker,
                   ScriptError *serror = nullptr);
 
+/**
+ * Same as VerifyScript, but always runs both scripts through EvalScript.
+ */
+bool VerifyScriptGeneric(const CScript &scriptSig,
+                         const CScript &scriptPubKey, uint32_t flags,
+                         const BaseSignatureChecker &checker,
+                         ScriptError *serror = nullptr);
+
+/**
+ * Fast path of VerifyScript for the standard P2PKH, P2PK and P2SH templates,
+ * which checks them directly instead of running them through EvalScript.
+ * Returns false if the scripts are not handled, for instance because they
+ * don't match these templates or would fail outside of the signature checks.
+ * Otherwise, fSuccess and serror are set exactly as VerifyScript sets them.
+ */
+bool VerifyStandardScript(const CScript &scriptSig, const CScript &scriptPubKey,
+                          uint32_t flags, const BaseSignatureChecker &checker,
+                          bool &fSuccess, ScriptError *serror = nullptr);
+
 int FindAndDelete(CScript &script, const CScript &b);
 
 #endif // BITCOIN_SCRIPT_INTERPRETER_H
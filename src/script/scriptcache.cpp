@@ -59,3 +59,19 @@ void AddKeyInScriptCache(uint256 key) {
     AssertLockHeld(cs_main);
     scriptExecutionCache.insert(key);
 }
+
+void DumpScriptCache(uint256 &nonce, std::vector<uint256> &entries) {
+    AssertLockHeld(cs_main);
+    nonce = scriptExecutionCacheNonce;
+    scriptExecutionCache.for_each(
+        [&entries](const uint256 &entry) { entries.push_back(entry); });
+}
+
+void LoadScriptCache(const uint256 &nonce,
+                     const std::vector<uint256> &entries) {
+    AssertLockHeld(cs_main);
+    scriptExecutionCacheNonce = nonce;
+    for (const uint256 &entry : entries) {
+        scriptExecutionCache.insert(entry);
+    }
+}
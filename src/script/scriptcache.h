@@ -8,6 +8,7 @@
 #include <uint256.h>
 
 #include <cstdint>
+#include <vector>
 
 class CTransaction;
 
@@ -30,4 +31,13 @@ bool IsKeyInScriptCache(uint256 key, bool erase);
 /** Add an entry in the cache. */
 void AddKeyInScriptCache(uint256 key);
 
+/**
+ * Get the nonce and the entries of the script execution cache, so that they
+ * can be persisted across restarts.
+ */
+void DumpScriptCache(uint256 &nonce, std::vector<uint256> &entries);
+
+/** Replace the nonce of the cache and add entries which were computed with it. */
+void LoadScriptCache(const uint256 &nonce, const std::vector<uint256> &entries);
+
 #endif // BITCOIN_SCRIPT_SCRIPTCACHE_H
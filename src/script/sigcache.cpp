@@ -10,6 +10,7 @@
 #include <pubkey.h>
 #include <random.h>
 #include <uint256.h>
+#include <logging.h>
 #include <util/system.h>
 
 #include <boost/thread/shared_mutex.hpp>
@@ -35,9 +36,13 @@ public:
     void ComputeEntry(uint256 &entry, const uint256 &hash,
                       const std::vector<uint8_t> &vchSig,
                       const CPubKey &pubkey) {
-        CSHA256()
-            .Write(nonce.begin(), 32)
-            .Write(hash.begin(), 32)
+        CSHA256 hasher;
+        {
+            // The nonce is replaced when a persisted cache is loaded.
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            hasher.Write(nonce.begin(), 32);
+        }
+        hasher.Write(hash.begin(), 32)
             .Write(&pubkey[0], pubkey.size())
             .Write(&vchSig[0], vchSig.size())
             .Finalize(entry.begin());
@@ -53,6 +58,23 @@ public:
         setValid.insert(entry);
     }
     uint32_t setup_bytes(size_t n) { return setValid.setup_bytes(n); }
+
+    void Dump(uint256 &nonceOut, std::vector<uint256> &entries) {
+        // Inserts hold the lock exclusively, so a shared lock is enough to
+        // keep the table stable.
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonceOut = nonce;
+        setValid.for_each(
+            [&entries](const uint256 &entry) { entries.push_back(entry); });
+    }
+
+    void Load(const uint256 &nonceIn, const std::vector<uint256> &entries) {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonce = nonceIn;
+        for (const uint256 &entry : entries) {
+            setValid.insert(entry);
+        }
+    }
 };
 
 /**
@@ -81,6 +103,15 @@ void InitSignatureCache() {
               (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
 }
 
+void DumpSignatureCache(uint256 &nonce, std::vector<uint256> &entries) {
+    signatureCache.Dump(nonce, entries);
+}
+
+void LoadSignatureCache(const uint256 &nonce,
+                        const std::vector<uint256> &entries) {
+    signatureCache.Load(nonce, entries);
+}
+
 template <typename F>
 bool RunMemoizedCheck(const std::vector<uint8_t> &vchSig, const CPubKey &pubkey,
                       const uint256 &sighash, bool storeOrErase, const F &fun) {
@@ -113,3 +144,94 @@ bool CachingTransactionSignatureChecker::VerifySignature(
                                                             sighash);
     });
 }
+
+bool BatchingTransactionSignatureChecker::VerifySignature(
+    const std::vector<uint8_t> &vchSig, const CPubKey &pubkey,
+    const uint256 &sighash) const {
+    if (vchSig.size() != 64) {
+        return CachingTransactionSignatureChecker::VerifySignature(
+            vchSig, pubkey, sighash);
+    }
+
+    DeferredSchnorrSig deferred{vchSig, pubkey, sighash, uint256(), store,
+                                ptxTo, nIn};
+    signatureCache.ComputeEntry(deferred.cacheEntry, sighash, vchSig, pubkey);
+    if (!signatureCache.Get(deferred.cacheEntry, !store)) {
+        pdeferred->push_back(std::move(deferred));
+    }
+    return true;
+}
+
+bool SchnorrSignatureBatch::Verify(std::vector<DeferredSchnorrSig> &sigs) {
+    std::vector<const CPubKey *> pubkeys;
+    std::vector<const uint256 *> hashes;
+    std::vector<const std::vector<uint8_t> *> vchSigs;
+    pubkeys.reserve(sigs.size());
+    hashes.reserve(sigs.size());
+    vchSigs.reserve(sigs.size());
+    for (const DeferredSchnorrSig &sig : sigs) {
+        pubkeys.push_back(&sig.pubkey);
+        hashes.push_back(&sig.sighash);
+        vchSigs.push_back(&sig.vchSig);
+    }
+
+    bool fOk = CPubKey::VerifySchnorrBatch(pubkeys, hashes, vchSigs);
+    if (!fOk) {
+        // Fall back to individual verification to find the culprits.
+        fOk = true;
+        for (DeferredSchnorrSig &sig : sigs) {
+            if (sig.pubkey.VerifySchnorr(sig.sighash, sig.vchSig)) {
+                // Don't cache anything: the batch fails anyway.
+                continue;
+            }
+            LogPrintf("%s: invalid Schnorr signature in input %u of %s\n",
+                      __func__, sig.nIn, sig.ptxTo->GetId().ToString());
+            fOk = false;
+        }
+        return fOk;
+    }
+
+    for (DeferredSchnorrSig &sig : sigs) {
+        if (sig.store) {
+            signatureCache.Set(sig.cacheEntry);
+        }
+    }
+    return true;
+}
+
+bool SchnorrSignatureBatch::Add(std::vector<DeferredSchnorrSig> &&sigs) {
+    if (sigs.empty()) {
+        return fAllOk;
+    }
+
+    std::vector<DeferredSchnorrSig> batch;
+    {
+        LOCK(cs);
+        for (DeferredSchnorrSig &sig : sigs) {
+            pending.push_back(std::move(sig));
+        }
+        if (pending.size() < nBatchSize) {
+            return fAllOk;
+        }
+        batch.swap(pending);
+        pending.reserve(nBatchSize);
+    }
+
+    if (fAllOk && !Verify(batch)) {
+        fAllOk = false;
+    }
+    return fAllOk;
+}
+
+bool SchnorrSignatureBatch::Flush() {
+    std::vector<DeferredSchnorrSig> batch;
+    {
+        LOCK(cs);
+        batch.swap(pending);
+    }
+
+    if (fAllOk && !batch.empty() && !Verify(batch)) {
+        fAllOk = false;
+    }
+    return fAllOk;
+}
@@ -6,8 +6,11 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
+#include <sync.h>
 
+#include <atomic>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -16,8 +19,8 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
-
-class CPubKey;
+// Number of Schnorr signatures verified together in a batch
+static const size_t DEFAULT_SCHNORR_BATCH_SIZE = 64;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -40,9 +43,10 @@ public:
 };
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker {
-private:
+protected:
     bool store;
 
+private:
     bool IsCached(const std::vector<uint8_t> &vchSig, const CPubKey &vchPubKey,
                   const uint256 &sighash) const;
 
@@ -61,6 +65,99 @@ public:
     friend class TestCachingTransactionSignatureChecker;
 };
 
+/**
+ * A Schnorr signature whose verification was deferred, and the input it was
+ * found in.
+ */
+struct DeferredSchnorrSig {
+    std::vector<uint8_t> vchSig;
+    CPubKey pubkey;
+    uint256 sighash;
+    //! The signature cache entry, to be added once the signature is verified
+    uint256 cacheEntry;
+    bool store;
+    const CTransaction *ptxTo;
+    unsigned int nIn;
+};
+
+/**
+ * Collects the Schnorr signatures deferred by
+ * BatchingTransactionSignatureChecker, and verifies them in batches.
+ *
+ * It is shared by all the script checks of a block, which may run in parallel:
+ * whichever check fills up a batch verifies it. When a batch fails, its
+ * signatures are verified one by one to find the invalid ones.
+ */
+class SchnorrSignatureBatch {
+private:
+    Mutex cs;
+    std::vector<DeferredSchnorrSig> pending GUARDED_BY(cs);
+    const size_t nBatchSize;
+    std::atomic<bool> fAllOk;
+
+    bool Verify(std::vector<DeferredSchnorrSig> &sigs);
+
+public:
+    explicit SchnorrSignatureBatch(
+        size_t nBatchSizeIn = DEFAULT_SCHNORR_BATCH_SIZE)
+        : nBatchSize(nBatchSizeIn), fAllOk(true) {}
+
+    /**
+     * Queue signatures for verification, and verify a batch if enough of them
+     * are pending. Returns false if an invalid signature was found so far.
+     */
+    bool Add(std::vector<DeferredSchnorrSig> &&sigs);
+
+    /**
+     * Verify the signatures that are still pending. Returns true if all the
+     * signatures added to the batch are valid.
+     */
+    bool Flush();
+};
+
+/**
+ * A CachingTransactionSignatureChecker which defers the verification of
+ * Schnorr signatures, and assumes they are valid in the meantime.
+ *
+ * This is only sound when the script fails whenever a non-empty signature
+ * fails, that is with SCRIPT_VERIFY_NULLFAIL: the script then succeeds with
+ * the deferred signatures if and only if they all turn out to be valid.
+ */
+class BatchingTransactionSignatureChecker
+    : public CachingTransactionSignatureChecker {
+private:
+    const CTransaction *ptxTo;
+    unsigned int nIn;
+    std::vector<DeferredSchnorrSig> *pdeferred;
+
+public:
+    BatchingTransactionSignatureChecker(
+        const CTransaction *txToIn, unsigned int nInIn, const Amount amountIn,
+        bool storeIn, PrecomputedTransactionData &txdataIn,
+        std::vector<DeferredSchnorrSig> &deferredIn)
+        : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, storeIn,
+                                             txdataIn),
+          ptxTo(txToIn), nIn(nInIn), pdeferred(&deferredIn) {}
+
+    bool VerifySignature(const std::vector<uint8_t> &vchSig,
+                         const CPubKey &vchPubKey,
+                         const uint256 &sighash) const override;
+};
+
 void InitSignatureCache();
 
+/**
+ * Get the nonce and the valid entries of the signature cache, so that they
+ * can be persisted across restarts.
+ */
+void DumpSignatureCache(uint256 &nonce, std::vector<uint256> &entries);
+
+/**
+ * Replace the nonce of the signature cache and add entries which were
+ * computed with it. Entries computed with the previous nonce become
+ * unreachable and are eventually evicted.
+ */
+void LoadSignatureCache(const uint256 &nonce,
+                        const std::vector<uint256> &entries);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
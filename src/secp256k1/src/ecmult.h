@@ -28,4 +28,9 @@ static int secp256k1_ecmult_context_is_built(const secp256k1_ecmult_context *ctx
 /** Double multiply: R = na*A + ng*G */
 static void secp256k1_ecmult(const secp256k1_ecmult_context *ctx, secp256k1_gej *r, const secp256k1_gej *a, const secp256k1_scalar *na, const secp256k1_scalar *ng);
 
+/** Multi-multiply: R = ng*G + sum(scalars[i]*points[i]) for i in [0, n).
+ *  n must be positive and the points must not be infinity. Uses
+ *  heap-allocated temporaries. */
+static void secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, const secp256k1_callback *cb, secp256k1_gej *r, const secp256k1_scalar *ng, const secp256k1_ge *points, const secp256k1_scalar *scalars, size_t n);
+
 #endif /* SECP256K1_ECMULT_H */
@@ -403,4 +403,80 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context *ctx, secp256k1_gej
     }
 }
 
+/** Strauss' algorithm: all the points share the same chain of doublings, so
+ *  the cost per additional point is only that of its table and of the
+ *  additions, roughly half of a single secp256k1_ecmult.
+ *
+ *  The odd multiples of all the points are brought to affine coordinates
+ *  together, which only requires one field inversion for the whole batch.
+ */
+static void secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, const secp256k1_callback *cb, secp256k1_gej *r, const secp256k1_scalar *ng, const secp256k1_ge *points, const secp256k1_scalar *scalars, size_t n) {
+    const size_t table_size = ECMULT_TABLE_SIZE(WINDOW_A);
+    secp256k1_gej *prej;
+    secp256k1_ge *pre;
+    int *wnaf;
+    int *bits_na;
+    int wnaf_ng[256];
+    int bits_ng;
+    int bits;
+    secp256k1_ge tmpa;
+    size_t j;
+    int i;
+
+    VERIFY_CHECK(n > 0);
+
+    prej = (secp256k1_gej*)checked_malloc(cb, sizeof(secp256k1_gej) * table_size * n);
+    pre = (secp256k1_ge*)checked_malloc(cb, sizeof(secp256k1_ge) * table_size * n);
+    wnaf = (int*)checked_malloc(cb, sizeof(int) * 256 * n);
+    bits_na = (int*)checked_malloc(cb, sizeof(int) * n);
+
+    /* Compute the odd multiples of every point in jacobian coordinates,
+     * and their wnaf representation. */
+    bits = 0;
+    for (j = 0; j < n; j++) {
+        secp256k1_gej d;
+        size_t k;
+        VERIFY_CHECK(!secp256k1_ge_is_infinity(&points[j]));
+        secp256k1_gej_set_ge(&prej[j * table_size], &points[j]);
+        secp256k1_gej_double_var(&d, &prej[j * table_size], NULL);
+        for (k = 1; k < table_size; k++) {
+            secp256k1_gej_add_var(&prej[j * table_size + k], &prej[j * table_size + k - 1], &d, NULL);
+        }
+
+        bits_na[j] = secp256k1_ecmult_wnaf(&wnaf[j * 256], 256, &scalars[j], WINDOW_A);
+        if (bits_na[j] > bits) {
+            bits = bits_na[j];
+        }
+    }
+
+    /* Convert all of them to affine at once. */
+    secp256k1_ge_set_all_gej_var(pre, prej, table_size * n, cb);
+    free(prej);
+
+    bits_ng = secp256k1_ecmult_wnaf(wnaf_ng, 256, ng, WINDOW_G);
+    if (bits_ng > bits) {
+        bits = bits_ng;
+    }
+
+    secp256k1_gej_set_infinity(r);
+    for (i = bits - 1; i >= 0; i--) {
+        int m;
+        secp256k1_gej_double_var(r, r, NULL);
+        for (j = 0; j < n; j++) {
+            if (i < bits_na[j] && (m = wnaf[j * 256 + i])) {
+                ECMULT_TABLE_GET_GE(&tmpa, &pre[j * table_size], m, WINDOW_A);
+                secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+            }
+        }
+        if (i < bits_ng && (m = wnaf_ng[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, m, WINDOW_G);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+    }
+
+    free(bits_na);
+    free(wnaf);
+    free(pre);
+}
+
 #endif /* SECP256K1_ECMULT_IMPL_H */
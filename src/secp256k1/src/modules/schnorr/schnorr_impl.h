@@ -100,6 +100,112 @@ static int secp256k1_schnorr_sig_verify(
     return 1;
 }
 
+/**
+ * Batch verification, using option 2 above.
+ *
+ * Each equation is multiplied by a 128-bit random factor a_i, which is derived
+ * by hashing all the inputs of the batch so that an attacker cannot choose
+ * invalid signatures which cancel each others out. a_0 is set to 1.
+ * The batch is valid if sum(a_i * R_i) + sum(a_i * e_i * P_i)
+ * - (sum(a_i * s_i)) * G == 0, which is computed with a single multi
+ * multiplication.
+ *
+ * Returns 1 if all the signatures are valid, and 0 if any of them is not.
+ */
+static int secp256k1_schnorr_sig_verify_batch(
+    const secp256k1_ecmult_context* ctx,
+    const secp256k1_callback *cb,
+    const unsigned char *const *sig64,
+    secp256k1_ge *pubkeys,
+    const unsigned char *const *msg32,
+    size_t n
+) {
+    secp256k1_ge *points;
+    secp256k1_scalar *scalars;
+    secp256k1_scalar a, e, s, sum_s;
+    secp256k1_sha256 sha;
+    secp256k1_gej r;
+    secp256k1_fe Rx;
+    unsigned char seed[32];
+    unsigned char buf[36];
+    size_t i, size;
+    int overflow;
+    int ret = 0;
+
+    if (n == 0) {
+        return 1;
+    }
+
+    /* Commit to the whole batch to derive the random factors. */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n; i++) {
+        if (secp256k1_ge_is_infinity(&pubkeys[i])) {
+            return 0;
+        }
+
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_eckey_pubkey_serialize(&pubkeys[i], buf, &size, 1);
+        VERIFY_CHECK(size == 33);
+        secp256k1_sha256_write(&sha, buf, 33);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+    }
+    secp256k1_sha256_finalize(&sha, seed);
+
+    points = (secp256k1_ge*)checked_malloc(cb, sizeof(secp256k1_ge) * 2 * n);
+    scalars = (secp256k1_scalar*)checked_malloc(cb, sizeof(secp256k1_scalar) * 2 * n);
+
+    secp256k1_scalar_set_int(&a, 1);
+    secp256k1_scalar_clear(&sum_s);
+    for (i = 0; i < n; i++) {
+        /* Extract s */
+        overflow = 0;
+        secp256k1_scalar_set_b32(&s, sig64[i] + 32, &overflow);
+        if (overflow) {
+            goto end;
+        }
+
+        /* Extract R.x and lift it to R, with R.y a quadratic residue. */
+        if (!secp256k1_fe_set_b32(&Rx, sig64[i])) {
+            goto end;
+        }
+        if (!secp256k1_ge_set_xquad(&points[2 * i], &Rx)) {
+            goto end;
+        }
+
+        if (i > 0) {
+            /* a_i = H(seed || i), truncated to 128 bits. */
+            secp256k1_sha256_initialize(&sha);
+            secp256k1_sha256_write(&sha, seed, 32);
+            buf[0] = (unsigned char)i;
+            buf[1] = (unsigned char)(i >> 8);
+            buf[2] = (unsigned char)(i >> 16);
+            buf[3] = (unsigned char)(i >> 24);
+            secp256k1_sha256_write(&sha, buf, 4);
+            secp256k1_sha256_finalize(&sha, buf);
+            memset(buf, 0, 16);
+            secp256k1_scalar_set_b32(&a, buf, NULL);
+        }
+
+        /* Compute e */
+        secp256k1_schnorr_compute_e(&e, sig64[i], &pubkeys[i], msg32[i]);
+
+        scalars[2 * i] = a;
+        points[2 * i + 1] = pubkeys[i];
+        secp256k1_scalar_mul(&scalars[2 * i + 1], &a, &e);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum_s, &sum_s, &s);
+    }
+
+    secp256k1_scalar_negate(&sum_s, &sum_s);
+    secp256k1_ecmult_multi_var(ctx, cb, &r, &sum_s, points, scalars, 2 * n);
+    ret = secp256k1_gej_is_infinity(&r);
+
+end:
+    free(scalars);
+    free(points);
+    return ret;
+}
+
 static int secp256k1_schnorr_compute_e(
     secp256k1_scalar* e,
     const unsigned char *r,
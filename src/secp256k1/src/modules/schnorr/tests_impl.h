@@ -78,6 +78,65 @@ void test_schnorr_sign_verify(void) {
 
 #undef SIG_COUNT
 
+#define BATCH_SIZE 16
+
+void test_schnorr_verify_batch(void) {
+    unsigned char privkey[32];
+    unsigned char msg[BATCH_SIZE][32];
+    unsigned char sig[BATCH_SIZE][64];
+    secp256k1_pubkey pubkey[BATCH_SIZE];
+    const unsigned char *sigs[BATCH_SIZE];
+    const unsigned char *msgs[BATCH_SIZE];
+    const secp256k1_pubkey *pubkeys[BATCH_SIZE];
+    size_t i, n;
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey) == 1);
+        CHECK(secp256k1_schnorr_sign(ctx, sig[i], msg[i], privkey, NULL, NULL) == 1);
+        sigs[i] = sig[i];
+        msgs[i] = msg[i];
+        pubkeys[i] = &pubkey[i];
+    }
+
+    /* Any prefix of valid signatures verifies, including the empty one. */
+    for (n = 0; n <= BATCH_SIZE; n++) {
+        CHECK(secp256k1_schnorr_verify_batch(ctx, sigs, msgs, pubkeys, n) == 1);
+    }
+
+    /* A single invalid signature anywhere in the batch invalidates it. */
+    for (i = 0; i < BATCH_SIZE; i++) {
+        int pos = secp256k1_rand_bits(6);
+        int mod = 1 + secp256k1_rand_int(255);
+        sig[i][pos] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, sigs, msgs, pubkeys, BATCH_SIZE) == 0);
+        sig[i][pos] ^= mod;
+    }
+
+    /* Signatures that are valid on their own for another message or key. */
+    msgs[0] = msg[1];
+    msgs[1] = msg[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, sigs, msgs, pubkeys, BATCH_SIZE) == 0);
+    msgs[0] = msg[0];
+    msgs[1] = msg[1];
+    pubkeys[0] = &pubkey[1];
+    pubkeys[1] = &pubkey[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, sigs, msgs, pubkeys, BATCH_SIZE) == 0);
+    pubkeys[0] = &pubkey[0];
+    pubkeys[1] = &pubkey[1];
+
+    /* The same signature twice is fine. */
+    sigs[1] = sig[0];
+    msgs[1] = msg[0];
+    pubkeys[1] = &pubkey[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, sigs, msgs, pubkeys, BATCH_SIZE) == 1);
+}
+
+#undef BATCH_SIZE
+
 void run_schnorr_compact_test(void) {
     {
         /* Test vector 1 */
@@ -516,6 +575,9 @@ void run_schnorr_tests(void) {
     }
 
     test_schnorr_sign_verify();
+    for (i = 0; i < count; i++) {
+        test_schnorr_verify_batch();
+    }
     run_schnorr_compact_test();
 }
 
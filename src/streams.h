@@ -7,6 +7,7 @@
 #define BITCOIN_STREAMS_H
 
 #include <serialize.h>
+#include <span.h>
 #include <support/allocators/zeroafterfree.h>
 
 #include <algorithm>
@@ -184,6 +185,53 @@ public:
     }
 };
 
+/**
+ * Minimal stream for reading from an existing span of bytes, e.g. a block in a
+ * memory mapped file, without copying it into a buffer first.
+ */
+class SpanReader {
+private:
+    const int m_type;
+    const int m_version;
+    const Span<const uint8_t> m_data;
+    size_t m_pos = 0;
+
+public:
+    /**
+     * @param[in]  type Serialization Type
+     * @param[in]  version Serialization Version (including any flags)
+     * @param[in]  data Referenced bytes to read from
+     */
+    SpanReader(int type, int version, Span<const uint8_t> data)
+        : m_type(type), m_version(version), m_data(data) {}
+
+    template <typename T> SpanReader &operator>>(T &obj) {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return m_version; }
+    int GetType() const { return m_type; }
+
+    size_t size() const { return m_data.size() - m_pos; }
+    bool empty() const { return size() == 0; }
+    //! The bytes that are left to read
+    const uint8_t *data() const { return m_data.data() + m_pos; }
+
+    void read(char *dst, size_t n) {
+        if (n == 0) {
+            return;
+        }
+
+        if (n > size()) {
+            throw std::ios_base::failure("SpanReader::read(): end of data");
+        }
+        memcpy(dst, m_data.data() + m_pos, n);
+        m_pos += n;
+    }
+};
+
 /**
  * Double ended buffer combining vector and stream-like interfaces.
  *
@@ -8,6 +8,7 @@
 #include <consensus/validation.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -911,4 +912,70 @@ BOOST_AUTO_TEST_CASE(coin_write) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(coins_db_range_cursors) {
+    CCoinsViewDB db(1 << 20, true);
+
+    // Populate the database with coins spread over the whole txid space.
+    CCoinsMap map;
+    std::map<COutPoint, Coin> expected;
+    for (int i = 0; i < 1000; i++) {
+        COutPoint outpoint(TxId(InsecureRand256()), InsecureRandRange(3));
+        Coin coin(CTxOut(int64_t(InsecureRandRange(1000)) * SATOSHI, CScript()),
+                  1, false);
+        expected.emplace(outpoint, coin);
+        CCoinsCacheEntry entry;
+        entry.coin = std::move(coin);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+        map.emplace(outpoint, std::move(entry));
+    }
+    uint256 hashBlock = InsecureRand256();
+    BOOST_CHECK(db.BatchWrite(map, hashBlock));
+
+    for (size_t nRanges : {1, 3, 16, 256}) {
+        auto cursors = db.RangeCursors(nRanges);
+        BOOST_CHECK_EQUAL(cursors.size(), nRanges);
+
+        // All ranges together visit every coin once, and do so in the order
+        // of the serialized txids.
+        std::map<COutPoint, Coin> visited;
+        std::vector<uint8_t> prev;
+        for (auto &cursor : cursors) {
+            BOOST_CHECK(cursor->GetBestBlock() == hashBlock);
+            for (; cursor->Valid(); cursor->Next()) {
+                COutPoint key;
+                Coin coin;
+                BOOST_CHECK(cursor->GetKey(key));
+                BOOST_CHECK(cursor->GetValue(coin));
+                std::vector<uint8_t> txid(key.GetTxId().begin(),
+                                          key.GetTxId().end());
+                BOOST_CHECK(prev <= txid);
+                prev = txid;
+                BOOST_CHECK(visited.emplace(key, std::move(coin)).second);
+            }
+        }
+        BOOST_CHECK_EQUAL(visited.size(), expected.size());
+        for (const auto &e : expected) {
+            auto it = visited.find(e.first);
+            BOOST_REQUIRE(it != visited.end());
+            BOOST_CHECK(it->second == e.second);
+        }
+    }
+
+    // Cursors keep reading from the snapshot they were created with.
+    auto cursors = db.RangeCursors(1);
+    CCoinsMap erase;
+    CCoinsCacheEntry entry;
+    entry.flags = CCoinsCacheEntry::DIRTY;
+    erase.emplace(expected.begin()->first, std::move(entry));
+    BOOST_CHECK(db.BatchWrite(erase, InsecureRand256()));
+    BOOST_CHECK(!db.HaveCoin(expected.begin()->first));
+
+    size_t count = 0;
+    for (; cursors[0]->Valid(); cursors[0]->Next()) {
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, expected.size());
+    BOOST_CHECK(cursors[0]->GetBestBlock() == hashBlock);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -697,4 +697,28 @@ BOOST_AUTO_TEST_CASE(sha256d64) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_multi) {
+    for (int i = 0; i <= 40; ++i) {
+        std::vector<std::vector<uint8_t>> in(i);
+        std::vector<const uint8_t *> inputs(i);
+        std::vector<size_t> lens(i);
+        for (int j = 0; j < i; ++j) {
+            // Cover messages shorter than a chunk, and tails that need one or
+            // two padding chunks.
+            in[j].resize(InsecureRandRange(300));
+            for (uint8_t &byte : in[j]) {
+                byte = InsecureRandBits(8);
+            }
+            inputs[j] = in[j].data();
+            lens[j] = in[j].size();
+        }
+        std::vector<uint8_t> out1(32 * i), out2(32 * i);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j].data(), in[j].size()).Finalize(&out1[32 * j]);
+        }
+        SHA256DMulti(out2.data(), inputs.data(), lens.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
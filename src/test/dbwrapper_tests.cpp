@@ -164,6 +164,47 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator) {
     }
 }
 
+// Test that snapshot reads and iterators ignore later writes
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot) {
+    // Perform tests both obfuscated and non-obfuscated.
+    for (const bool obfuscate : {false, true}) {
+        fs::path ph = SetDataDir(std::string("dbwrapper_snapshot")
+                                     .append(obfuscate ? "_true" : "_false"));
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        char key = 'j';
+        uint256 in = InsecureRand256();
+        BOOST_CHECK(dbw.Write(key, in));
+
+        auto snapshot = dbw.GetSnapshot();
+
+        // Overwrite the first key and add a second one after the snapshot.
+        uint256 in2 = InsecureRand256();
+        BOOST_CHECK(dbw.Write(key, in2));
+        char key2 = 'k';
+        BOOST_CHECK(dbw.Write(key2, in2));
+
+        uint256 res;
+        BOOST_CHECK(dbw.Read(key, res, snapshot.get()));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        BOOST_CHECK(!dbw.Read(key2, res, snapshot.get()));
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+
+        std::unique_ptr<CDBIterator> it(dbw.NewIterator(*snapshot));
+        it->Seek(key);
+
+        char key_res;
+        BOOST_CHECK(it->GetKey(key_res));
+        BOOST_CHECK(it->GetValue(res));
+        BOOST_CHECK_EQUAL(key_res, key);
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+
+        it->Next();
+        BOOST_CHECK_EQUAL(it->Valid(), false);
+    }
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate) {
     // We're going to share this fs::path between two wrappers
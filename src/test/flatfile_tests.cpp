@@ -130,4 +130,82 @@ BOOST_AUTO_TEST_CASE(flatfile_flush) {
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map) {
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 16 * 1024);
+
+    // Missing files cannot be mapped.
+    BOOST_CHECK(!seq.Map(FlatFilePos(1, 0)));
+
+    std::string line1("All work and no play");
+    std::string line2("makes Jack a dull boy");
+    {
+        CAutoFile file(seq.Open(FlatFilePos(1, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line1, 256);
+    }
+
+    std::unique_ptr<FlatFileMapping> mapping = seq.Map(FlatFilePos(1, 0));
+#ifdef WIN32
+    BOOST_CHECK(!mapping);
+#else
+    BOOST_REQUIRE(mapping);
+    const size_t size1 = mapping->size();
+    BOOST_CHECK_EQUAL(size1, line1.size() + 1);
+
+    std::string text;
+    auto limited_text = LIMITED_STRING(text, 256);
+    SpanReader reader(SER_DISK, CLIENT_VERSION,
+                      Span<const uint8_t>(mapping->data(), size1));
+    reader >> limited_text;
+    BOOST_CHECK_EQUAL(text, line1);
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK_THROW(reader >> limited_text, std::ios_base::failure);
+
+    // Data appended later only shows up in a new mapping.
+    {
+        CAutoFile file(seq.Open(FlatFilePos(1, size1)), SER_DISK,
+                       CLIENT_VERSION);
+        file << LIMITED_STRING(line2, 256);
+    }
+    BOOST_CHECK_EQUAL(mapping->size(), size1);
+    mapping = seq.Map(FlatFilePos(1, 0));
+    BOOST_REQUIRE(mapping);
+    BOOST_CHECK_EQUAL(mapping->size(), size1 + line2.size() + 1);
+    SpanReader(SER_DISK, CLIENT_VERSION,
+               Span<const uint8_t>(mapping->data() + size1,
+                                   mapping->size() - size1)) >>
+        limited_text;
+    BOOST_CHECK_EQUAL(text, line2);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(flatfile_advise) {
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 16 * 1024);
+
+    // Hints about missing files are ignored, and do not create them.
+    seq.Advise(FlatFilePos(2, 0), 0, FileAccess::WILLNEED);
+    BOOST_CHECK(!fs::exists(seq.FileName(FlatFilePos(2, 0))));
+
+    std::string line("The Times 03/Jan/2009 Chancellor on brink of second "
+                     "bailout for banks");
+    {
+        CAutoFile file(seq.Open(FlatFilePos(2, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line, 256);
+    }
+
+    // Hints never change the content of the file.
+    for (const FileAccess access :
+         {FileAccess::SEQUENTIAL, FileAccess::WILLNEED, FileAccess::DONTNEED}) {
+        seq.Advise(FlatFilePos(2, 0), 0, access);
+        seq.Advise(FlatFilePos(2, 4), 8, access);
+
+        std::string text;
+        CAutoFile file(seq.Open(FlatFilePos(2, 0), true), SER_DISK,
+                       CLIENT_VERSION);
+        file >> LIMITED_STRING(text, 256);
+        BOOST_CHECK_EQUAL(text, line);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
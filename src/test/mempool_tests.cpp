@@ -1054,4 +1054,141 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests) {
     BOOST_CHECK_EQUAL(descendants, 6ULL);
 }
 
+// Check the ancestor and descendant state of every entry against the entries
+// found by walking the mempool.
+static void CheckPackageState(const CTxMemPool &pool)
+    EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    for (CTxMemPool::txiter it = pool.mapTx.begin(); it != pool.mapTx.end();
+         it++) {
+        CTxMemPool::setEntries setAncestors, setDescendants;
+        std::string dummy;
+        BOOST_CHECK(pool.CalculateMemPoolAncestors(*it, setAncestors, nNoLimit,
+                                                   nNoLimit, nNoLimit, nNoLimit,
+                                                   dummy, false));
+        setAncestors.insert(it);
+        pool.CalculateDescendants(it, setDescendants);
+
+        uint64_t nSize = 0;
+        Amount nFees = Amount::zero();
+        int64_t nSigOps = 0;
+        for (CTxMemPool::txiter ancestor : setAncestors) {
+            nSize += ancestor->GetTxSize();
+            nFees += ancestor->GetModifiedFee();
+            nSigOps += ancestor->GetSigOpCount();
+        }
+        BOOST_CHECK_EQUAL(it->GetCountWithAncestors(), setAncestors.size());
+        BOOST_CHECK_EQUAL(it->GetSizeWithAncestors(), nSize);
+        BOOST_CHECK_EQUAL(it->GetModFeesWithAncestors(), nFees);
+        BOOST_CHECK_EQUAL(it->GetSigOpCountWithAncestors(), nSigOps);
+
+        nSize = 0;
+        nFees = Amount::zero();
+        for (CTxMemPool::txiter descendant : setDescendants) {
+            nSize += descendant->GetTxSize();
+            nFees += descendant->GetModifiedFee();
+        }
+        BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), setDescendants.size());
+        BOOST_CHECK_EQUAL(it->GetSizeWithDescendants(), nSize);
+        BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), nFees);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MempoolLongChainTest) {
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // A chain of transactions, in which chain[20] also spends chain[5], so
+    // that some entries have several parents or children.
+    const size_t nChainLength = 30;
+    std::vector<CTransactionRef> chain;
+    for (size_t i = 0; i < nChainLength; i++) {
+        if (i == 0) {
+            chain.push_back(make_tx(MK_OUTPUTS(1000 * COIN, 1 * COIN)));
+        } else if (i == 20) {
+            chain.push_back(make_tx(MK_OUTPUTS(1000 * COIN, 1 * COIN),
+                                    MK_INPUTS(chain[19], chain[5]),
+                                    MK_INPUT_IDX(0, 1)));
+        } else {
+            chain.push_back(make_tx(MK_OUTPUTS(1000 * COIN, 1 * COIN),
+                                    MK_INPUTS(chain.back())));
+        }
+        pool.addUnchecked(chain.back()->GetId(),
+                          entry.Fee((i + 1) * 100 * SATOSHI)
+                              .SigOpsCost(i % 3)
+                              .FromTx(chain.back()));
+    }
+    CheckPackageState(pool);
+
+    std::vector<uint64_t> vCountWithAncestors;
+    for (const CTransactionRef &tx : chain) {
+        vCountWithAncestors.push_back(
+            pool.mapTx.find(tx->GetId())->GetCountWithAncestors());
+    }
+    BOOST_CHECK_EQUAL(vCountWithAncestors.back(), nChainLength);
+
+    // The limits are found exceeded from the state of the parent.
+    CTransactionRef tip = make_tx(MK_OUTPUTS(1 * COIN), MK_INPUTS(chain.back()));
+    CTxMemPool::setEntries setAncestors;
+    std::string errString;
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(
+        entry.FromTx(tip), setAncestors, nChainLength, 1000000, 1000000,
+        1000000, errString));
+    BOOST_CHECK_EQUAL(errString,
+                      "too many unconfirmed ancestors [limit: 30]");
+    BOOST_CHECK(setAncestors.empty());
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(
+        entry.FromTx(tip), setAncestors, nChainLength + 1, 1000000, 1000000,
+        1000000, errString));
+    BOOST_CHECK_EQUAL(setAncestors.size(), nChainLength);
+
+    // Mine the start of the chain, past the transaction spent twice.
+    const size_t nBlockTxs = 10;
+    std::vector<CTransactionRef> block(chain.begin(),
+                                       chain.begin() + nBlockTxs);
+    pool.removeForBlock(block, 1);
+    BOOST_CHECK_EQUAL(pool.size(), nChainLength - nBlockTxs);
+    CheckPackageState(pool);
+    for (size_t i = nBlockTxs; i < nChainLength; i++) {
+        BOOST_CHECK_EQUAL(
+            pool.mapTx.find(chain[i]->GetId())->GetCountWithAncestors(),
+            i - nBlockTxs + 1);
+    }
+
+    // Disconnect that block again.
+    std::vector<TxId> vBlockTxIds;
+    for (size_t i = 0; i < nBlockTxs; i++) {
+        pool.addUnchecked(chain[i]->GetId(),
+                          entry.Fee((i + 1) * 100 * SATOSHI)
+                              .SigOpsCost(i % 3)
+                              .FromTx(chain[i]));
+        vBlockTxIds.push_back(chain[i]->GetId());
+    }
+    pool.UpdateTransactionsFromBlock(vBlockTxIds);
+    BOOST_CHECK_EQUAL(pool.size(), nChainLength);
+    CheckPackageState(pool);
+    for (size_t i = 0; i < nChainLength; i++) {
+        BOOST_CHECK_EQUAL(
+            pool.mapTx.find(chain[i]->GetId())->GetCountWithAncestors(),
+            vCountWithAncestors[i]);
+    }
+
+    // Evict the end of the chain, including the transaction spending two
+    // others.
+    pool.removeRecursive(*chain[15]);
+    BOOST_CHECK_EQUAL(pool.size(), 15UL);
+    CheckPackageState(pool);
+
+    // Mine a block with transactions sorted by txid.
+    block.assign(chain.begin(), chain.begin() + 12);
+    std::sort(block.begin(), block.end(),
+              [](const CTransactionRef &a, const CTransactionRef &b) {
+                  return a->GetId() < b->GetId();
+              });
+    pool.removeForBlock(block, 2);
+    BOOST_CHECK_EQUAL(pool.size(), 3UL);
+    CheckPackageState(pool);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,23 +12,6 @@
 
 BOOST_FIXTURE_TEST_SUITE(merkle_tests, TestingSetup)
 
-static uint256
-ComputeMerkleRootFromBranch(const uint256 &leaf,
-                            const std::vector<uint256> &vMerkleBranch,
-                            uint32_t nIndex) {
-    uint256 hash = leaf;
-    for (std::vector<uint256>::const_iterator it = vMerkleBranch.begin();
-         it != vMerkleBranch.end(); ++it) {
-        if (nIndex & 1) {
-            hash = Hash(BEGIN(*it), END(*it), BEGIN(hash), END(hash));
-        } else {
-            hash = Hash(BEGIN(hash), END(hash), BEGIN(*it), END(*it));
-        }
-        nIndex >>= 1;
-    }
-    return hash;
-}
-
 /**
  * This implements a constant-space merkle root/path calculator, limited to 2^32
  * leaves.
@@ -292,4 +275,50 @@ BOOST_AUTO_TEST_CASE(merkle_test) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkle_parallel_test) {
+    // Trees around the size above which their levels are hashed by several
+    // threads, with and without a duplicated last leaf.
+    for (size_t size :
+         {MERKLE_PARALLEL_MIN_LEAVES - 1, MERKLE_PARALLEL_MIN_LEAVES,
+          MERKLE_PARALLEL_MIN_LEAVES + 1, 3 * MERKLE_PARALLEL_MIN_LEAVES + 5}) {
+        std::vector<uint256> leaves(size);
+        for (uint256 &leaf : leaves) {
+            leaf = InsecureRand256();
+        }
+        for (bool mutate : {false, true}) {
+            if (mutate) {
+                leaves.push_back(leaves.back());
+            }
+            uint256 root;
+            bool mutated = false;
+            MerkleComputation(leaves, &root, &mutated, -1, nullptr);
+            for (unsigned int nThreads : {1, 2, 3, 8}) {
+                bool parallelMutated = !mutated;
+                BOOST_CHECK(ComputeMerkleRoot(leaves, &parallelMutated,
+                                              nThreads) == root);
+                BOOST_CHECK_EQUAL(parallelMutated, mutated);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkle_first_branch_test) {
+    for (size_t size : {1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 31, 1000, 4097}) {
+        std::vector<uint256> leaves(size);
+        for (uint256 &leaf : leaves) {
+            leaf = InsecureRand256();
+        }
+        const std::vector<uint256> branch = ComputeFirstMerkleBranch(leaves);
+        BOOST_CHECK(branch == ComputeMerkleBranch(leaves, 0));
+        BOOST_CHECK(ComputeMerkleRootFromBranch(leaves[0], branch, 0) ==
+                    ComputeMerkleRoot(leaves));
+
+        // The branch does not depend on the first leaf.
+        leaves[0] = InsecureRand256();
+        BOOST_CHECK(ComputeFirstMerkleBranch(leaves) == branch);
+        BOOST_CHECK(ComputeMerkleRootFromBranch(leaves[0], branch, 0) ==
+                    ComputeMerkleRoot(leaves));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -21,6 +21,7 @@
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <test/test_bitcoin.h>
 
@@ -416,6 +417,18 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity) {
     BOOST_CHECK_EXCEPTION(
         AssemblerForTest(chainparams, g_mempool).CreateNewBlock(scriptPubKey),
         std::runtime_error, HasReason("bad-txns-inputs-missingorspent"));
+
+    // Unless checking the template is left to the submission of the block.
+    {
+        BlockAssembler::Options options;
+        options.blockMinFeeRate = blockMinFeeRate;
+        options.nBlockPriorityPercentage = 0;
+        options.fCheckValidity = false;
+        BOOST_CHECK(pblocktemplate =
+                        BlockAssembler(chainparams, g_mempool, options)
+                            .CreateNewBlock(scriptPubKey));
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+    }
     g_mempool.clear();
 
     // Child with higher priority than parent.
@@ -787,4 +800,126 @@ BOOST_AUTO_TEST_CASE(TestCBlockTemplateEntry) {
     BOOST_CHECK_EQUAL(txEntry.txSigOps, 10);
 }
 
+/**
+ * The template of getblocktemplate follows the transactions entering and
+ * leaving the mempool, and the tip, without being assembled again.
+ */
+BOOST_FIXTURE_TEST_CASE(BlockTemplateCache_updates, TestChain100Setup) {
+    const Config &config = GetConfig();
+    const CChainParams &chainparams = config.GetChainParams();
+    const CScript redeemScript = CScript() << OP_TRUE;
+    const CScript scriptPubKey =
+        GetScriptForDestination(CScriptID(redeemScript));
+
+    // A mature coinbase paying to P2SH(OP_TRUE), so that it can be spent
+    // without signatures, and by standard transactions.
+    const CTransactionRef coinbase =
+        CreateAndProcessBlock({}, scriptPubKey).vtx[0];
+    for (int i = 0; i < COINBASE_MATURITY; i++) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+
+    const auto Spend = [&](const COutPoint &prevout, const Amount nValue) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vin[0].scriptSig = CScript() << ToByteVector(redeemScript);
+        tx.vout.resize(2);
+        tx.vout[0].nValue = nValue;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+        // Pad the transaction to the minimum size.
+        tx.vout[1].nValue = Amount::zero();
+        tx.vout[1].scriptPubKey = CScript()
+                                  << OP_RETURN << std::vector<uint8_t>(64);
+        return tx;
+    };
+    const auto Accept = [&](const CMutableTransaction &tx) {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(config, g_mempool, state,
+                                       MakeTransactionRef(tx), false, nullptr));
+    };
+    const auto Get = [](BlockTemplateCache &cache) {
+        LOCK(cs_main);
+        std::shared_ptr<const CBlockTemplate> pblocktemplate = cache.Get();
+        BOOST_CHECK(pblocktemplate->block.hashPrevBlock ==
+                    chainActive.Tip()->GetBlockHash());
+        return pblocktemplate;
+    };
+
+    const CMutableTransaction parent =
+        Spend(COutPoint(coinbase->GetId(), 0), coinbase->vout[0].nValue - CENT);
+    const CMutableTransaction child =
+        Spend(COutPoint(parent.GetId(), 0), parent.vout[0].nValue - CENT);
+
+    GetMainSignals().RegisterWithMempoolSignals(g_mempool);
+    BlockTemplateCache cache(config, g_mempool);
+    RegisterValidationInterface(&cache);
+
+    const std::shared_ptr<const CBlockTemplate> empty = Get(cache);
+    BOOST_CHECK_EQUAL(empty->block.vtx.size(), 1);
+
+    // The transactions are added in place, to a new template.
+    Accept(parent);
+    Accept(child);
+    SyncWithValidationInterfaceQueue();
+    const std::shared_ptr<const CBlockTemplate> full = Get(cache);
+    BOOST_CHECK(Get(cache) == full);
+    BOOST_CHECK_EQUAL(empty->block.vtx.size(), 1);
+    BOOST_CHECK_EQUAL(full->block.vtx.size(), 3);
+    BOOST_CHECK(full->block.vtx[0]->vout[0].nValue ==
+                GetBlockSubsidy(chainActive.Height() + 1,
+                                chainparams.GetConsensus()) +
+                    2 * CENT);
+    BOOST_CHECK(full->entries[0].txFee == -2 * CENT);
+
+    // They are the transactions a new assembly picks, in the same order.
+    std::unique_ptr<CBlockTemplate> pblocktemplate =
+        BlockAssembler(config, g_mempool).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3);
+    for (size_t i = 1; i < pblocktemplate->block.vtx.size(); i++) {
+        BOOST_CHECK(full->block.vtx[i]->GetId() ==
+                    pblocktemplate->block.vtx[i]->GetId());
+        BOOST_CHECK(full->entries[i].txFee == CENT);
+    }
+
+    // Rolling the extranonce computes the same merkle root from the coinbase
+    // branch as from all the transactions.
+    BOOST_CHECK(full->coinbaseMerkleBranch ==
+                pblocktemplate->coinbaseMerkleBranch);
+    CBlock block = full->block;
+    unsigned int nExtraNonce = 0;
+    IncrementExtraNonce(&block, chainActive.Tip(), config.GetMaxBlockSize(),
+                        nExtraNonce, &full->coinbaseMerkleBranch);
+    BOOST_CHECK(block.hashMerkleRoot == BlockMerkleRoot(block));
+
+    // A transaction leaving the mempool takes its descendants out of the
+    // template.
+    {
+        LOCK(g_mempool.cs);
+        g_mempool.removeRecursive(CTransaction(parent),
+                                  MemPoolRemovalReason::EXPIRY);
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(Get(cache)->block.vtx.size(), 1);
+
+    // Confirmed transactions leave the template of the new tip, to which
+    // their children are added.
+    Accept(parent);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(Get(cache)->block.vtx.size(), 2);
+    CreateAndProcessBlock({parent}, scriptPubKey);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(Get(cache)->block.vtx.size(), 1);
+    Accept(child);
+    SyncWithValidationInterfaceQueue();
+    const std::shared_ptr<const CBlockTemplate> next = Get(cache);
+    BOOST_CHECK_EQUAL(next->block.vtx.size(), 2);
+    BOOST_CHECK(next->block.vtx[1]->GetId() == child.GetId());
+
+    UnregisterValidationInterface(&cache);
+    GetMainSignals().UnregisterWithMempoolSignals(g_mempool);
+    g_mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,10 +7,12 @@
 #include <script/script_error.h>
 #include <script/sighashtype.h>
 #include <script/sign.h>
+#include <script/standard.h>
 
 #include <core_io.h>
 #include <key.h>
 #include <keystore.h>
+#include <policy/policy.h>
 #include <rpc/server.h>
 #include <streams.h>
 #include <util/strencodings.h>
@@ -121,6 +123,37 @@ static ScriptError ParseScriptError(const std::string &name) {
 
 BOOST_FIXTURE_TEST_SUITE(script_tests, BasicTestingSetup)
 
+/**
+ * Check that VerifyScript, which may take the standard templates fast path,
+ * agrees with the interpreter, under flags and under all the flag sets one bit
+ * away from them.
+ */
+static void CheckFastPath(const CScript &scriptSig, const CScript &scriptPubKey,
+                          uint32_t flags, const BaseSignatureChecker &checker,
+                          const std::string &message) {
+    for (int bit = -1; bit < 32; bit++) {
+        uint32_t testFlags = bit < 0 ? flags : flags ^ (1U << bit);
+        if ((testFlags & SCRIPT_VERIFY_CLEANSTACK) &&
+            !(testFlags & SCRIPT_VERIFY_P2SH)) {
+            continue;
+        }
+        ScriptError err, errGeneric;
+        bool fResult =
+            VerifyScript(scriptSig, scriptPubKey, testFlags, checker, &err);
+        bool fResultGeneric = VerifyScriptGeneric(scriptSig, scriptPubKey,
+                                                  testFlags, checker,
+                                                  &errGeneric);
+        BOOST_CHECK_MESSAGE(fResult == fResultGeneric &&
+                                err == errGeneric,
+                            strprintf("fast path returned %d (%s) instead of "
+                                      "%d (%s) with flags %x: %s",
+                                      fResult, FormatScriptError(err),
+                                      fResultGeneric,
+                                      FormatScriptError(errGeneric), testFlags,
+                                      message));
+    }
+}
+
 static CMutableTransaction
 BuildCreditingTransaction(const CScript &scriptPubKey, const Amount nValue) {
     CMutableTransaction txCredit;
@@ -176,6 +209,10 @@ static void DoTest(const CScript &scriptPubKey, const CScript &scriptSig,
                         std::string(FormatScriptError(err)) + " where " +
                             std::string(FormatScriptError(scriptError)) +
                             " expected: " + message);
+    CheckFastPath(scriptSig, scriptPubKey, flags,
+                  MutableTransactionSignatureChecker(&tx, 0,
+                                                     txCredit.vout[0].nValue),
+                  message);
 #if defined(HAVE_CONSENSUS_LIB)
     CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
     stream << tx2;
@@ -2733,6 +2770,143 @@ BOOST_AUTO_TEST_CASE(script_standard_push) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(script_standard_fast_path) {
+    CKey key0, key1, key2;
+    key0.MakeNewKey(true);
+    key1.MakeNewKey(false);
+    key2.MakeNewKey(true);
+    const CPubKey pubkey0 = key0.GetPubKey();
+    const CPubKey pubkey1 = key1.GetPubKey();
+    const CPubKey pubkey2 = key2.GetPubKey();
+
+    const CScript multisig =
+        GetScriptForMultisig(1, std::vector<CPubKey>{pubkey0, pubkey2});
+    const CScript p2pkh = GetScriptForDestination(pubkey0.GetID());
+    const CScript p2pkhWrong = GetScriptForDestination(pubkey2.GetID());
+    const CScript p2pk = CScript() << ToByteVector(pubkey1) << OP_CHECKSIG;
+    const CScript p2sh = GetScriptForDestination(CScriptID(multisig));
+    const CScript p2shP2pkh = GetScriptForDestination(CScriptID(p2pkh));
+
+    const uint32_t flagSets[] = {
+        SCRIPT_VERIFY_NONE,
+        SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC,
+        MANDATORY_SCRIPT_VERIFY_FLAGS,
+        STANDARD_SCRIPT_VERIFY_FLAGS,
+        STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_SCHNORR_MULTISIG,
+    };
+
+    for (const SigHashType sigHashType :
+         {SigHashType(), SigHashType().withForkId(),
+          SigHashType().withForkId().withAnyoneCanPay()}) {
+        for (const bool fSchnorr : {false, true}) {
+            for (const CScript &scriptPubKey :
+                 {p2pkh, p2pkhWrong, p2pk, p2sh, p2shP2pkh}) {
+                const CTransaction txCredit{
+                    BuildCreditingTransaction(scriptPubKey, 1 * SATOSHI)};
+                CMutableTransaction tx =
+                    BuildSpendingTransaction(CScript(), txCredit);
+
+                const CKey &key = scriptPubKey == p2pk ? key1 : key0;
+                const CPubKey &pubkey = scriptPubKey == p2pk ? pubkey1 : pubkey0;
+                CScript scriptCode = scriptPubKey;
+                if (scriptPubKey == p2sh) {
+                    scriptCode = multisig;
+                } else if (scriptPubKey == p2shP2pkh) {
+                    scriptCode = p2pkh;
+                }
+                uint256 hash = SignatureHash(scriptCode, CTransaction(tx), 0,
+                                             sigHashType, 1 * SATOSHI);
+                std::vector<uint8_t> vchSig;
+                if (fSchnorr) {
+                    BOOST_CHECK(key.SignSchnorr(hash, vchSig));
+                } else {
+                    BOOST_CHECK(key.SignECDSA(hash, vchSig));
+                }
+                vchSig.push_back(uint8_t(sigHashType.getRawSigHashType()));
+                std::vector<uint8_t> vchBadSig = vchSig;
+                vchBadSig[10] ^= 0x01;
+
+                // Variations of the scriptSig, valid or not.
+                std::vector<std::vector<std::vector<uint8_t>>> pushesSets;
+                for (const std::vector<uint8_t> &sig :
+                     {vchSig, vchBadSig, std::vector<uint8_t>()}) {
+                    if (scriptPubKey == p2pk) {
+                        pushesSets.push_back({sig});
+                    } else if (scriptPubKey == p2sh) {
+                        pushesSets.push_back({{}, sig, ToByteVector(multisig)});
+                        pushesSets.push_back({{1}, sig, ToByteVector(multisig)});
+                    } else if (scriptPubKey == p2shP2pkh) {
+                        pushesSets.push_back(
+                            {sig, ToByteVector(pubkey), ToByteVector(p2pkh)});
+                    } else {
+                        pushesSets.push_back({sig, ToByteVector(pubkey)});
+                        pushesSets.push_back({sig, ToByteVector(pubkey2)});
+                    }
+                }
+                pushesSets.push_back({});
+                pushesSets.push_back({vchSig, vchSig, ToByteVector(pubkey)});
+
+                for (const auto &pushes : pushesSets) {
+                    CScript scriptSig;
+                    for (const std::vector<uint8_t> &push : pushes) {
+                        scriptSig << push;
+                    }
+                    // Same pushes, but the last one is not minimally encoded.
+                    CScript scriptSigNonMinimal;
+                    for (size_t i = 0; i < pushes.size(); i++) {
+                        if (i + 1 < pushes.size()) {
+                            scriptSigNonMinimal << pushes[i];
+                        } else {
+                            scriptSigNonMinimal.push_back(OP_PUSHDATA1);
+                            scriptSigNonMinimal.push_back(uint8_t(pushes[i].size()));
+                            scriptSigNonMinimal.insert(scriptSigNonMinimal.end(),
+                                                       pushes[i].begin(),
+                                                       pushes[i].end());
+                        }
+                    }
+
+                    for (const CScript &sig : {scriptSig, scriptSigNonMinimal}) {
+                        tx.vin[0].scriptSig = sig;
+                        MutableTransactionSignatureChecker checker(
+                            &tx, 0, 1 * SATOSHI);
+                        for (const uint32_t flags : flagSets) {
+                            CheckFastPath(sig, scriptPubKey, flags, checker,
+                                          ScriptToAsmStr(sig));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Standard spends actually take the fast path.
+    const CTransaction txCredit{BuildCreditingTransaction(p2pkh, 1 * SATOSHI)};
+    CMutableTransaction tx = BuildSpendingTransaction(CScript(), txCredit);
+    uint256 hash =
+        SignatureHash(p2pkh, CTransaction(tx), 0, SigHashType().withForkId(),
+                      1 * SATOSHI, nullptr, STANDARD_SCRIPT_VERIFY_FLAGS);
+    std::vector<uint8_t> vchSig;
+    BOOST_CHECK(key0.SignECDSA(hash, vchSig));
+    vchSig.push_back(uint8_t(SigHashType().withForkId().getRawSigHashType()));
+    tx.vin[0].scriptSig = CScript() << vchSig << ToByteVector(pubkey0);
+    bool fSuccess = false;
+    ScriptError err;
+    BOOST_CHECK(VerifyStandardScript(
+        tx.vin[0].scriptSig, p2pkh,
+        STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_SIGHASH_FORKID,
+        MutableTransactionSignatureChecker(&tx, 0, 1 * SATOSHI), fSuccess,
+        &err));
+    BOOST_CHECK(fSuccess);
+    BOOST_CHECK(err == ScriptError::OK);
+
+    // But not scripts that are merely push only.
+    BOOST_CHECK(!VerifyStandardScript(
+        CScript() << OP_1 << ToByteVector(pubkey0), p2pkh,
+        STANDARD_SCRIPT_VERIFY_FLAGS,
+        MutableTransactionSignatureChecker(&tx, 0, 1 * SATOSHI), fSuccess,
+        &err));
+}
+
 BOOST_AUTO_TEST_CASE(script_IsPushOnly_on_invalid_scripts) {
     // IsPushOnly returns false when given a script containing only pushes that
     // are invalid due to truncation. IsPushOnly() is consensus critical because
@@ -115,4 +115,139 @@ BOOST_AUTO_TEST_CASE(sig_pubkey_hash_variations) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_signature_batch) {
+    CDataStream stream(
+        ParseHex(
+            "010000000122739e70fbee987a8be1788395a2f2e6ad18ccb7ff611cd798071539"
+            "dde3c38e000000000151ffffffff010000000000000000016a00000000"),
+        SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction dummyTx(deserialize, stream);
+    PrecomputedTransactionData txdata(dummyTx);
+
+    std::vector<CPubKey> pubkeys;
+    std::vector<uint256> hashes;
+    std::vector<std::vector<uint8_t>> sigs;
+    for (int n = 0; n < 40; n++) {
+        CKey key;
+        key.MakeNewKey(n % 2 == 0);
+        std::string strMsg = strprintf("Schnorr batch %i", n);
+        uint256 hashMsg = Hash(strMsg.begin(), strMsg.end());
+        std::vector<uint8_t> sig;
+        BOOST_CHECK(key.SignSchnorr(hashMsg, sig));
+        pubkeys.push_back(key.GetPubKey());
+        hashes.push_back(hashMsg);
+        sigs.push_back(sig);
+    }
+
+    std::vector<const CPubKey *> vpubkeys;
+    std::vector<const uint256 *> vhashes;
+    std::vector<const std::vector<uint8_t> *> vsigs;
+    for (size_t i = 0; i < sigs.size(); i++) {
+        vpubkeys.push_back(&pubkeys[i]);
+        vhashes.push_back(&hashes[i]);
+        vsigs.push_back(&sigs[i]);
+    }
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch(vpubkeys, vhashes, vsigs));
+    // A signature for another message invalidates the whole batch.
+    vhashes[7] = &hashes[8];
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpubkeys, vhashes, vsigs));
+    vhashes[7] = &hashes[7];
+    vhashes.pop_back();
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpubkeys, vhashes, vsigs));
+
+    // The checker defers the Schnorr signatures and reports them as valid.
+    std::vector<DeferredSchnorrSig> deferred;
+    BatchingTransactionSignatureChecker checker(&dummyTx, 0, 0 * SATOSHI, true,
+                                                txdata, deferred);
+    for (size_t i = 0; i < sigs.size(); i++) {
+        BOOST_CHECK(checker.VerifySignature(sigs[i], pubkeys[i], hashes[i]));
+    }
+    BOOST_CHECK_EQUAL(deferred.size(), sigs.size());
+
+    // ECDSA signatures are verified immediately.
+    CKey ecdsaKey;
+    ecdsaKey.MakeNewKey(true);
+    std::vector<uint8_t> ecdsaSig;
+    BOOST_CHECK(ecdsaKey.SignECDSA(hashes[0], ecdsaSig));
+    BOOST_CHECK(checker.VerifySignature(ecdsaSig, ecdsaKey.GetPubKey(),
+                                        hashes[0]));
+    BOOST_CHECK(!checker.VerifySignature(ecdsaSig, ecdsaKey.GetPubKey(),
+                                         hashes[1]));
+    BOOST_CHECK_EQUAL(deferred.size(), sigs.size());
+
+    {
+        SchnorrSignatureBatch batch(16);
+        std::vector<DeferredSchnorrSig> first(deferred.begin(),
+                                              deferred.begin() + 20);
+        std::vector<DeferredSchnorrSig> second(deferred.begin() + 20,
+                                               deferred.end());
+        BOOST_CHECK(batch.Add(std::move(first)));
+        BOOST_CHECK(batch.Add(std::move(second)));
+        BOOST_CHECK(batch.Flush());
+    }
+
+    // The verified signatures made it into the cache.
+    std::vector<DeferredSchnorrSig> cached;
+    BatchingTransactionSignatureChecker cachedChecker(
+        &dummyTx, 0, 0 * SATOSHI, true, txdata, cached);
+    for (size_t i = 0; i < sigs.size(); i++) {
+        BOOST_CHECK(
+            cachedChecker.VerifySignature(sigs[i], pubkeys[i], hashes[i]));
+    }
+    BOOST_CHECK(cached.empty());
+
+    // An invalid signature is found, whether it is in a full batch or in the
+    // remainder flushed at the end.
+    for (size_t bad : {size_t(3), size_t(38)}) {
+        SchnorrSignatureBatch batch(16);
+        bool fOk = true;
+        for (size_t i = 0; i < deferred.size(); i++) {
+            std::vector<DeferredSchnorrSig> one{deferred[i]};
+            if (i == bad) {
+                one[0].sighash = hashes[bad - 1];
+            }
+            fOk = batch.Add(std::move(one));
+            // The first batch is verified when its 16th signature is added.
+            BOOST_CHECK_EQUAL(fOk, bad >= 16 || i < 15);
+        }
+        BOOST_CHECK(!batch.Flush());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_dump_load) {
+    CDataStream stream(
+        ParseHex(
+            "010000000122739e70fbee987a8be1788395a2f2e6ad18ccb7ff611cd798071539"
+            "dde3c38e000000000151ffffffff010000000000000000016a00000000"),
+        SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction dummyTx(deserialize, stream);
+    PrecomputedTransactionData txdata(dummyTx);
+    CachingTransactionSignatureChecker checker(&dummyTx, 0, 0 * SATOSHI, true,
+                                               txdata);
+    TestCachingTransactionSignatureChecker testChecker(checker);
+
+    CKey key = DecodeSecret(strSecret1C);
+    CPubKey pubkey = key.GetPubKey();
+    std::string strMsg = "Sigcache dump test";
+    uint256 hashMsg = Hash(strMsg.begin(), strMsg.end());
+    std::vector<uint8_t> sig;
+    BOOST_CHECK(key.SignECDSA(hashMsg, sig));
+
+    BOOST_CHECK(testChecker.VerifyAndStore(sig, pubkey, hashMsg));
+    BOOST_CHECK(testChecker.IsCached(sig, pubkey, hashMsg));
+
+    uint256 nonce;
+    std::vector<uint256> entries;
+    DumpSignatureCache(nonce, entries);
+    BOOST_CHECK(!entries.empty());
+
+    // A fresh nonce hides everything that was cached so far...
+    LoadSignatureCache(InsecureRand256(), {});
+    BOOST_CHECK(!testChecker.IsCached(sig, pubkey, hashMsg));
+
+    // ... and restoring the dumped nonce and entries brings them back.
+    LoadSignatureCache(nonce, entries);
+    BOOST_CHECK(testChecker.IsCached(sig, pubkey, hashMsg));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
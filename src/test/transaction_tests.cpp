@@ -802,4 +802,85 @@ BOOST_AUTO_TEST_CASE(txsize_activation_test) {
     BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-undersize");
 }
 
+BOOST_AUTO_TEST_CASE(block_transactions_unserialize) {
+    // Enough transactions of varying sizes for several hashing batches.
+    CBlock block;
+    for (size_t i = 0; i < 2 * TX_HASH_BATCH_SIZE + 3; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1 + i % 3);
+        for (CTxIn &in : mtx.vin) {
+            in.prevout = COutPoint(TxId(InsecureRand256()), i);
+            in.scriptSig = CScript() << std::vector<uint8_t>(i % 200, 0x51);
+        }
+        mtx.vout.resize(1 + i % 5);
+        mtx.nLockTime = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    std::vector<uint8_t> data;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, data, 0, block);
+
+    // Blocks read from a stream, or parsed in place from memory, get the same
+    // transactions.
+    CBlock fromStream, fromSpan, fromDataStream;
+    VectorReader(SER_NETWORK, PROTOCOL_VERSION, data, 0) >> fromStream;
+    SpanReader(SER_NETWORK, PROTOCOL_VERSION,
+               Span<const uint8_t>(data.data(), data.size())) >>
+        fromSpan;
+    CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+    stream >> fromDataStream;
+    BOOST_CHECK(stream.empty());
+
+    for (const CBlock *block2 : {&fromStream, &fromSpan, &fromDataStream}) {
+        BOOST_REQUIRE_EQUAL(block2->vtx.size(), block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            BOOST_CHECK(block2->vtx[i]->GetId() == block.vtx[i]->GetId());
+            BOOST_CHECK(block2->vtx[i]->GetHash() == block.vtx[i]->GetHash());
+            BOOST_CHECK(*block2->vtx[i] == *block.vtx[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_transactions_arena) {
+    CBlock block;
+    for (size_t i = 0; i < 1000; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(TxId(InsecureRand256()), i);
+        mtx.vout.resize(1 + i % 3);
+        mtx.nLockTime = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    std::vector<uint8_t> data;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, data, 0, block);
+
+    // Transactions that are not part of a block are not copied.
+    BOOST_CHECK(DetachTransaction(block.vtx[0]) == block.vtx[0]);
+
+    CTransactionRef kept, detached;
+    for (bool fArena : {true, false}) {
+        SetBlockTransactionArena(fArena);
+        {
+            CBlock fromSpan;
+            SpanReader(SER_NETWORK, PROTOCOL_VERSION,
+                       Span<const uint8_t>(data.data(), data.size())) >>
+                fromSpan;
+            kept = fromSpan.vtx[500];
+            detached = DetachTransaction(kept);
+            BOOST_CHECK_EQUAL(detached == kept, !fArena);
+            BOOST_CHECK_EQUAL(kept.use_count(), fArena ? 2 : 3);
+        }
+
+        // The arena outlives the block for as long as any of its
+        // transactions does.
+        BOOST_CHECK(*kept == *block.vtx[500]);
+        BOOST_CHECK(kept->GetId() == block.vtx[500]->GetId());
+        BOOST_CHECK(*detached == *block.vtx[500]);
+        BOOST_CHECK(detached->GetHash() == block.vtx[500]->GetHash());
+        BOOST_CHECK(DetachTransaction(detached) == detached);
+    }
+    SetBlockTransactionArena(DEFAULT_BLOCK_TX_ARENA);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
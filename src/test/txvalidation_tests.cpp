@@ -7,6 +7,7 @@
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/standard.h>
 #include <test/test_bitcoin.h>
 #include <txmempool.h>
 #include <validation.h>
@@ -57,4 +58,125 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup) {
     BOOST_CHECK_EQUAL(nDoS, 100);
 }
 
+/**
+ * Ensure that a batch of transactions gets the same results as accepting them
+ * one by one, whatever their order, and even when some of their scripts fail.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_batch, TestChain100Setup) {
+    const Config &config = GetConfig();
+    const CScript redeemScript = CScript() << OP_TRUE;
+    const CScript scriptPubKey =
+        GetScriptForDestination(CScriptID(redeemScript));
+    const CScript scriptSig = CScript() << ToByteVector(redeemScript);
+
+    // A mature coinbase paying to P2SH(OP_TRUE), so that it can be spent
+    // without signatures, and by standard transactions.
+    const CTransactionRef coinbase =
+        CreateAndProcessBlock({}, scriptPubKey).vtx[0];
+    for (int i = 0; i < COINBASE_MATURITY; i++) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+
+    const auto Spend = [&](const COutPoint &prevout,
+                           const CScript &scriptSigIn, const Amount nValue) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vin[0].scriptSig = scriptSigIn;
+        tx.vout.resize(2);
+        tx.vout[0].nValue = nValue;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+        // Pad the transaction to the minimum size.
+        tx.vout[1].nValue = Amount::zero();
+        tx.vout[1].scriptPubKey = CScript()
+                                  << OP_RETURN << std::vector<uint8_t>(64);
+        return MakeTransactionRef(tx);
+    };
+
+    // The last output of the parent can only be spent by OP_2.
+    const CScript redeemScriptTwo = CScript() << OP_2 << OP_EQUAL;
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vin[0].prevout = COutPoint(coinbase->GetId(), 0);
+    parent.vin[0].scriptSig = scriptSig;
+    parent.vout.resize(4);
+    for (CTxOut &txout : parent.vout) {
+        txout.nValue = 10 * CENT;
+        txout.scriptPubKey = scriptPubKey;
+    }
+    parent.vout[3].scriptPubKey =
+        GetScriptForDestination(CScriptID(redeemScriptTwo));
+    const CTransactionRef parentRef = MakeTransactionRef(parent);
+    const TxId parentId = parentRef->GetId();
+
+    std::vector<CTransactionRef> txs = {
+        // Listed before the transaction it spends.
+        Spend(COutPoint(parentId, 0), scriptSig, 9 * CENT),
+        parentRef,
+        Spend(COutPoint(parentId, 1), scriptSig, 9 * CENT),
+        // Fails its script.
+        Spend(COutPoint(parentId, 3),
+              CScript() << OP_1 << ToByteVector(redeemScriptTwo), 9 * CENT),
+        // Double spends the second child.
+        Spend(COutPoint(parentId, 1), scriptSig, 8 * CENT),
+        // Spends a transaction which is nowhere to be found.
+        Spend(COutPoint(TxId(InsecureRand256()), 0), scriptSig, 9 * CENT),
+    };
+    // Spends the transaction which fails its script.
+    txs.push_back(Spend(COutPoint(txs[3]->GetId(), 0), scriptSig, 8 * CENT));
+
+    std::vector<bool> vAccepted;
+    std::vector<CValidationState> states;
+    std::vector<bool> vMissingInputs;
+
+    // Testing the batch gives the same results as adding it, as a package,
+    // but adds nothing.
+    for (const bool test_accept : {true, false}) {
+        BOOST_CHECK_EQUAL(AcceptToMemoryPoolBatch(config, g_mempool, txs,
+                                                  vAccepted, states,
+                                                  vMissingInputs, false,
+                                                  Amount::zero(), test_accept),
+                          3);
+        BOOST_CHECK_EQUAL(g_mempool.size(), test_accept ? 0 : 3);
+        BOOST_CHECK_EQUAL(vAccepted.size(), txs.size());
+        BOOST_CHECK_EQUAL(states.size(), txs.size());
+        BOOST_CHECK_EQUAL(vMissingInputs.size(), txs.size());
+
+        for (size_t i = 0; i < txs.size(); i++) {
+            BOOST_CHECK_EQUAL(vAccepted[i], i < 3);
+        }
+
+        for (const size_t i : {0, 1, 2}) {
+            BOOST_CHECK(states[i].IsValid());
+            BOOST_CHECK(!vMissingInputs[i]);
+            BOOST_CHECK_EQUAL(g_mempool.exists(txs[i]->GetId()),
+                              !test_accept);
+        }
+
+        BOOST_CHECK(states[3].IsInvalid());
+        BOOST_CHECK_EQUAL(
+            states[3].GetRejectReason(),
+            "mandatory-script-verify-flag-failed (Script evaluated without "
+            "error but finished with a false/empty top stack element)");
+
+        BOOST_CHECK(states[4].IsInvalid());
+        BOOST_CHECK_EQUAL(states[4].GetRejectReason(), "txn-mempool-conflict");
+
+        for (const size_t i : {5, 6}) {
+            BOOST_CHECK(!states[i].IsInvalid());
+            BOOST_CHECK(vMissingInputs[i]);
+        }
+
+        for (const size_t i : {3, 4, 5, 6}) {
+            BOOST_CHECK(!g_mempool.exists(txs[i]->GetId()));
+        }
+    }
+
+    // Transactions already accepted are rejected as such.
+    BOOST_CHECK_EQUAL(AcceptToMemoryPoolBatch(config, g_mempool, txs, vAccepted,
+                                              states, vMissingInputs, false),
+                      0);
+    BOOST_CHECK_EQUAL(states[1].GetRejectReason(), "txn-already-in-mempool");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,18 +5,24 @@
 
 #include <validation.h>
 
+#include <chain.h>
 #include <chainparams.h>
 #include <clientversion.h>
 #include <config.h>
 #include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <pow.h>
 #include <primitives/transaction.h>
 #include <streams.h>
+#include <txdb.h>
 #include <util/system.h>
 
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <vector>
@@ -34,8 +40,8 @@ static CBlock makeLargeDummyBlock(const size_t num_tx) {
 
 BOOST_FIXTURE_TEST_SUITE(validation_tests, TestingSetup)
 
-/** Test that LoadExternalBlockFile works with the buffer size set
-below the size of a large block. Currently, LoadExternalBlockFile has the
+/** Test that LoadExternalBlockFiles works with the buffer size set
+below the size of a large block. Currently, LoadExternalBlockFiles has the
 buffer size for CBufferedFile set to 2 * MAX_TX_SIZE. Test with a value
 of 10 * MAX_TX_SIZE. */
 BOOST_AUTO_TEST_CASE(validation_load_external_block_file) {
@@ -75,8 +81,354 @@ BOOST_AUTO_TEST_CASE(validation_load_external_block_file) {
         outs.release();
     }
 
-    fseek(fp, 0, SEEK_SET);
-    BOOST_CHECK_NO_THROW({ LoadExternalBlockFile(config, fp, 0); });
+    fclose(fp);
+    BOOST_CHECK_NO_THROW(
+        { LoadExternalBlockFiles(config, {tmpfile_name}, false); });
+}
+
+static CBlock MakeBlock(const CBlockHeader &prev, int nHeight,
+                        const Consensus::Params &params) {
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    coinbase.vout.resize(2);
+    coinbase.vout[0].nValue = GetBlockSubsidy(nHeight, params);
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    // Pad the coinbase up to the minimum transaction size.
+    coinbase.vout[1].nValue = Amount::zero();
+    coinbase.vout[1].scriptPubKey =
+        CScript() << OP_RETURN << std::vector<uint8_t>(MIN_TX_SIZE, 0);
+
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = prev.GetHash();
+    block.nTime = prev.nTime + 1;
+    block.nBits = prev.nBits;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, params)) {
+        ++block.nNonce;
+    }
+    return block;
+}
+
+static void WriteBlocks(const fs::path &path, const std::vector<CBlock> &blocks,
+                        const CChainParams &chainparams) {
+    CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    for (const CBlock &block : blocks) {
+        file << chainparams.DiskMagic()
+             << uint32_t(GetSerializeSize(block, SER_DISK, CLIENT_VERSION))
+             << block;
+    }
+}
+
+struct RegtestingSetup : public TestingSetup {
+    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+/** Test that blocks are imported from several files, whatever their order. */
+BOOST_FIXTURE_TEST_CASE(validation_load_external_block_files_out_of_order,
+                        RegtestingSetup) {
+    const fs::path dir = SetDataDir("validation_load_external_block_files");
+    const Config &config = GetConfig();
+    const CChainParams &chainparams = config.GetChainParams();
+    const Consensus::Params &params = chainparams.GetConsensus();
+
+    std::vector<CBlock> blocks;
+    CBlockHeader prev = chainparams.GenesisBlock().GetBlockHeader();
+    for (int nHeight = 1; nHeight <= 6; nHeight++) {
+        blocks.push_back(MakeBlock(prev, nHeight, params));
+        prev = blocks.back().GetBlockHeader();
+    }
+
+    // Children come before their parents, and across files.
+    WriteBlocks(dir / "a.dat", {blocks[5], blocks[3], blocks[4]}, chainparams);
+    WriteBlocks(dir / "b.dat", {blocks[2], blocks[0]}, chainparams);
+    WriteBlocks(dir / "c.dat", {blocks[1]}, chainparams);
+    BOOST_CHECK(LoadExternalBlockFiles(
+        config, {dir / "a.dat", dir / "b.dat", dir / "c.dat"}, false));
+
+    {
+        LOCK(cs_main);
+        for (const CBlock &block : blocks) {
+            const CBlockIndex *pindex = LookupBlockIndex(block.GetHash());
+            BOOST_REQUIRE(pindex);
+            BOOST_CHECK(pindex->nStatus.hasData());
+        }
+    }
+
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(config, state));
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(chainActive.Height(), 6);
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_read_raw_block_from_disk,
+                        TestChain100Setup) {
+    const Config &config = GetConfig();
+    const CChainParams &chainparams = config.GetChainParams();
+
+    for (int nHeight : {0, 1, 50, 100}) {
+        const CBlockIndex *pindex;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[nHeight];
+        }
+        CBlock block;
+        BOOST_REQUIRE(
+            ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()));
+        std::vector<uint8_t> block_data;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(block_data, pindex, chainparams));
+
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+        BOOST_CHECK(std::vector<uint8_t>(ss.begin(), ss.end()) == block_data);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_block_index_snapshot, TestChain100Setup) {
+    const Consensus::Params &params = Params().GetConsensus();
+    const fs::path path = GetBlocksDir() / "blockindex.dat";
+
+    // A full flush leaves a snapshot of the block index behind.
+    FlushStateToDisk();
+    std::vector<const CBlockIndex *> vSorted;
+    {
+        LOCK(cs_main);
+        for (const std::pair<const uint256, CBlockIndex *> &item :
+             mapBlockIndex) {
+            vSorted.push_back(item.second);
+        }
+    }
+    std::sort(vSorted.begin(), vSorted.end(),
+              [](const CBlockIndex *a, const CBlockIndex *b) {
+                  return a->nHeight < b->nHeight;
+              });
+
+    CBlockIndexArena arena;
+    std::vector<std::pair<uint256, CBlockIndex *>> vIndex;
+    BOOST_REQUIRE(
+        pblocktree->LoadBlockIndexSnapshot(path, params, arena, vIndex));
+    BOOST_REQUIRE_EQUAL(vIndex.size(), vSorted.size());
+    BOOST_CHECK_EQUAL(arena.Size(), vSorted.size());
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        CBlockIndex *pindex = vIndex[i].second;
+        pindex->phashBlock = &vIndex[i].first;
+        const CBlockIndex *pexpected = vSorted[i];
+        BOOST_CHECK(pindex->GetBlockHash() == pexpected->GetBlockHash());
+        BOOST_CHECK(pindex->GetBlockHeader().GetHash() ==
+                    pexpected->GetBlockHash());
+        BOOST_CHECK_EQUAL(pindex->nHeight, pexpected->nHeight);
+        BOOST_CHECK(pindex->nStatus == pexpected->nStatus);
+        BOOST_CHECK_EQUAL(pindex->nTx, pexpected->nTx);
+        BOOST_CHECK_EQUAL(pindex->nFile, pexpected->nFile);
+        BOOST_CHECK_EQUAL(pindex->nDataPos, pexpected->nDataPos);
+        BOOST_CHECK_EQUAL(pindex->nUndoPos, pexpected->nUndoPos);
+    }
+
+    // Rewriting any block index record makes the snapshot stale.
+    BOOST_REQUIRE(pblocktree->WriteBatchSync({}, 0, {vSorted.back()}));
+    vIndex.clear();
+    BOOST_CHECK(
+        !pblocktree->LoadBlockIndexSnapshot(path, params, arena, vIndex));
+
+    // A damaged snapshot is rejected.
+    BOOST_REQUIRE(pblocktree->WriteBlockIndexSnapshot(path, vSorted));
+    {
+        FILE *file = fsbridge::fopen(path, "rb+");
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE_EQUAL(fseek(file, -1, SEEK_END), 0);
+        const int ch = fgetc(file);
+        BOOST_REQUIRE_EQUAL(fseek(file, -1, SEEK_END), 0);
+        fputc(ch ^ 1, file);
+        fclose(file);
+    }
+    BOOST_CHECK(
+        !pblocktree->LoadBlockIndexSnapshot(path, params, arena, vIndex));
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_block_index_height_order,
+                        TestChain100Setup) {
+    const Config &config = GetConfig();
+    FlushStateToDisk();
+
+    // However the block index is loaded, the entries end up in height order.
+    for (const std::string snapshot : {"0", "1"}) {
+        gArgs.ForceSetArg("-blockindexsnapshot", snapshot);
+        UnloadBlockIndex();
+        LOCK(cs_main);
+        BOOST_REQUIRE(LoadBlockIndex(config));
+        BOOST_REQUIRE(LoadChainTip(config));
+        BOOST_REQUIRE_EQUAL(chainActive.Height(), 100);
+        for (int nHeight = 1; nHeight <= 100; nHeight++) {
+            BOOST_CHECK(chainActive[nHeight] == chainActive[nHeight - 1] + 1);
+            BOOST_CHECK(chainActive[nHeight]->pprev ==
+                        chainActive[nHeight - 1]);
+        }
+    }
+    gArgs.ClearArg("-blockindexsnapshot");
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_block_prefetch, TestChain100Setup) {
+    const Config &config = GetConfig();
+    gArgs.ForceSetArg("-blockprefetch", "4");
+    StartBlockPrefetchThreads(config);
+
+    // Disconnect half of the chain and connect it again from disk, with the
+    // blocks read and checked ahead by the prefetch threads.
+    CBlockIndex *pindexTip;
+    CBlockIndex *pindexInvalid;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+        pindexInvalid = chainActive[50];
+    }
+    CValidationState state;
+    BOOST_REQUIRE(InvalidateBlock(config, state, pindexInvalid));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 49);
+        ResetBlockFailureFlags(pindexInvalid);
+    }
+    BOOST_REQUIRE(ActivateBestChain(config, state));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip() == pindexTip);
+    }
+
+    StopBlockPrefetchThreads();
+    gArgs.ClearArg("-blockprefetch");
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_undo_cache, TestChain100Setup) {
+    const Config &config = GetConfig();
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+
+    // Mine blocks spending a coinbase each, so that disconnecting them
+    // restores coins from their undo data. There are enough of them to be
+    // disconnected in several batches. The coinbases pay to OP_TRUE, so that
+    // they can be spent without signatures.
+    const size_t nBlocks = 2 * MAX_DISCONNECT_BATCH + 5;
+    std::vector<CTransactionRef> vCoinbases;
+    for (size_t i = 0; i < nBlocks; i++) {
+        vCoinbases.push_back(CreateAndProcessBlock({}, scriptPubKey).vtx[0]);
+    }
+    for (int i = 0; i < COINBASE_MATURITY; i++) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+
+    int nBaseHeight;
+    {
+        LOCK(cs_main);
+        nBaseHeight = chainActive.Height();
+    }
+    std::vector<CTransactionRef> vSpends;
+    for (size_t i = 0; i < nBlocks; i++) {
+        CMutableTransaction spend;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(vCoinbases[i]->GetId(), 0);
+        spend.vout.resize(2);
+        spend.vout[0].nValue = 11 * CENT;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+        // Pad the transaction to the minimum size.
+        spend.vout[1].nValue = Amount::zero();
+        spend.vout[1].scriptPubKey = CScript()
+                                     << OP_RETURN << std::vector<uint8_t>(64);
+
+        vSpends.push_back(MakeTransactionRef(spend));
+        CreateAndProcessBlock({spend}, scriptPubKey);
+    }
+
+    const auto CheckCoins = [&](size_t nConnected) {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), nBaseHeight + nConnected);
+        BOOST_CHECK(pcoinsTip->GetBestBlock() ==
+                    chainActive.Tip()->GetBlockHash());
+        for (size_t i = 0; i < nBlocks; i++) {
+            const bool fConnected = i < nConnected;
+            BOOST_CHECK_EQUAL(
+                pcoinsTip->HaveCoin(COutPoint(vCoinbases[i]->GetId(), 0)),
+                !fConnected);
+            BOOST_CHECK_EQUAL(
+                pcoinsTip->HaveCoin(COutPoint(vSpends[i]->GetId(), 0)),
+                fConnected);
+        }
+    };
+    CheckCoins(nBlocks);
+
+    // Disconnect and connect the blocks again, with all, some or none of them
+    // in the undo cache.
+    CBlockIndex *pindexInvalid;
+    {
+        LOCK(cs_main);
+        pindexInvalid = chainActive[nBaseHeight + 1];
+    }
+    for (const size_t nCache :
+         {nBlocks, size_t(DEFAULT_UNDO_CACHE), size_t(0)}) {
+        gArgs.ForceSetArg("-undocache", std::to_string(nCache));
+        InitUndoCache();
+
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(config, state, pindexInvalid));
+        CheckCoins(0);
+        {
+            LOCK(cs_main);
+            ResetBlockFailureFlags(pindexInvalid);
+        }
+        BOOST_REQUIRE(ActivateBestChain(config, state));
+        CheckCoins(nBlocks);
+    }
+
+    gArgs.ClearArg("-undocache");
+    InitUndoCache();
+}
+
+BOOST_FIXTURE_TEST_CASE(validation_block_readahead, TestChain100Setup) {
+    const Consensus::Params &params =
+        GetConfig().GetChainParams().GetConsensus();
+    CBlockIndex *pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    const CBlockIndex *pindexMid = pindexTip->GetAncestor(50);
+
+    // Hinting blocks never gets in the way of reading them, whichever way
+    // the chain is scanned, and however far ahead.
+    for (const int64_t nReadahead :
+         {int64_t(0), int64_t(1), DEFAULT_BLOCK_READAHEAD, int64_t(1000)}) {
+        gArgs.ForceSetArg("-blockreadahead", std::to_string(nReadahead));
+
+        // Up to the tip of the active chain, as an index sync.
+        BlockFileReadahead readaheadTip(nullptr, false);
+        for (int i = 1; i <= pindexTip->nHeight; i++) {
+            const CBlockIndex *pindex = pindexTip->GetAncestor(i);
+            readaheadTip.Read(pindex);
+            CBlock block;
+            BOOST_CHECK(ReadBlockFromDisk(block, pindex, params));
+        }
+
+        // Up to a given block, as a rescan.
+        BlockFileReadahead readaheadForward(pindexMid, true);
+        for (int i = 1; i <= pindexMid->nHeight; i++) {
+            const CBlockIndex *pindex = pindexTip->GetAncestor(i);
+            readaheadForward.Read(pindex);
+            CBlock block;
+            BOOST_CHECK(ReadBlockFromDisk(block, pindex, params));
+        }
+
+        // From the tip down to a given block, as VerifyDB.
+        BlockFileReadahead readaheadBackward(pindexMid, true);
+        for (const CBlockIndex *pindex = pindexTip; pindex != pindexMid;
+             pindex = pindex->pprev) {
+            readaheadBackward.Read(pindex);
+            CBlock block;
+            BOOST_CHECK(ReadBlockFromDisk(block, pindex, params));
+        }
+    }
+
+    gArgs.ClearArg("-blockreadahead");
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,17 +7,25 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <hash.h>
 #include <init.h>
 #include <pow.h>
 #include <random.h>
+#include <span.h>
+#include <streams.h>
 #include <ui_interface.h>
 #include <uint256.h>
 #include <util/system.h>
 
 #include <boost/thread.hpp> // boost::this_thread::interruption_point() (mingw)
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
 
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
@@ -29,6 +37,14 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_BLOCK_INDEX_SNAPSHOT = 'S';
+
+//! Version of the block index snapshot file format
+static const uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
+//! Number of entries in each independently decodable chunk of a snapshot
+static const size_t BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE = 16384;
+//! Maximum number of threads decoding a block index snapshot
+static const unsigned int MAX_BLOCK_INDEX_SNAPSHOT_THREADS = 8;
 
 namespace {
 
@@ -187,17 +203,42 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const {
      */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
-    } else {
-        // Make sure Valid() and GetKey() return false
-        i->keyTmp.first = 0;
-    }
+    i->CacheKey();
     return i;
 }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>>
+CCoinsViewDB::RangeCursors(size_t nRanges) const {
+    assert(nRanges >= 1 && nRanges <= 256);
+
+    auto snapshot = db.GetSnapshot();
+    uint256 hashBestChain;
+    if (!db.Read(DB_BEST_BLOCK, hashBestChain, snapshot.get())) {
+        hashBestChain = uint256();
+    }
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    cursors.reserve(nRanges);
+    for (size_t r = 0; r < nRanges; r++) {
+        // Ranges are delimited by the first byte of the serialized txid, which
+        // is what the database keys are ordered by.
+        // The end of the last range wraps around to the null txid, which
+        // leaves it unbounded.
+        uint256 begin, end;
+        *begin.begin() = uint8_t((r * 256) / nRanges);
+        *end.begin() = uint8_t(((r + 1) * 256) / nRanges);
+
+        CCoinsViewDBCursor *i = new CCoinsViewDBCursor(
+            snapshot, const_cast<CDBWrapper &>(db).NewIterator(*snapshot),
+            hashBestChain, TxId(end));
+        COutPoint first(TxId(begin), 0);
+        i->pcursor->Seek(CoinEntry(&first));
+        i->CacheKey();
+        cursors.emplace_back(i);
+    }
+    return cursors;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const {
     // Return cached key
     if (keyTmp.first == DB_COIN) {
@@ -221,8 +262,17 @@ bool CCoinsViewDBCursor::Valid() const {
 
 void CCoinsViewDBCursor::Next() {
     pcursor->Next();
+    CacheKey();
+}
+
+void CCoinsViewDBCursor::CacheKey() {
     CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) ||
+        (!txidEnd.IsNull() && entry.key == DB_COIN &&
+         // Keys are ordered by serialized txid, which is not the order of
+         // uint256::Compare.
+         memcmp(keyTmp.second.GetTxId().begin(), txidEnd.begin(),
+                txidEnd.size()) >= 0)) {
         // Invalidate cached key after last record so that Valid() and GetKey()
         // return false
         keyTmp.first = 0;
@@ -241,6 +291,10 @@ bool CBlockTreeDB::WriteBatchSync(
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
+    if (!blockinfo.empty()) {
+        // The block index snapshot no longer matches the records.
+        batch.Erase(DB_BLOCK_INDEX_SNAPSHOT);
+    }
     for (std::vector<const CBlockIndex *>::const_iterator it =
              blockinfo.begin();
          it != blockinfo.end(); it++) {
@@ -309,6 +363,250 @@ bool CBlockTreeDB::LoadBlockIndexGuts(
     return true;
 }
 
+namespace {
+/**
+ * A CBlockIndex entry as stored in a block index snapshot. The parent is
+ * referred to by its position in the snapshot, plus one (zero for none), and
+ * the block hash is stored so entries can be decoded independently.
+ */
+class CSnapshotBlockIndex {
+public:
+    CBlockIndex *pindex;
+    uint64_t nParentPos;
+    uint256 hash;
+
+    explicit CSnapshotBlockIndex(CBlockIndex *pindexIn,
+                                 uint64_t nParentPosIn = 0,
+                                 const uint256 &hashIn = uint256())
+        : pindex(pindexIn), nParentPos(nParentPosIn), hash(hashIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream &s, Operation ser_action) {
+        READWRITE(hash);
+        READWRITE(VARINT(nParentPos));
+        READWRITE(VARINT(pindex->nHeight, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(pindex->nStatus);
+        READWRITE(VARINT(pindex->nTx));
+        if (pindex->nStatus.hasData() || pindex->nStatus.hasUndo()) {
+            READWRITE(VARINT(pindex->nFile, VarIntMode::NONNEGATIVE_SIGNED));
+        }
+        if (pindex->nStatus.hasData()) {
+            READWRITE(VARINT(pindex->nDataPos));
+        }
+        if (pindex->nStatus.hasUndo()) {
+            READWRITE(VARINT(pindex->nUndoPos));
+        }
+        READWRITE(pindex->nVersion);
+        READWRITE(pindex->hashMerkleRoot);
+        READWRITE(pindex->nTime);
+        READWRITE(pindex->nBits);
+        READWRITE(pindex->nNonce);
+    }
+};
+
+//! Run fn(i) for every i in [0, n) on a few threads.
+template <typename F> bool ParallelFor(size_t n, F fn) {
+    std::atomic<size_t> nNext{0};
+    std::atomic<bool> fOk{true};
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < n && fOk; i = nNext++) {
+            if (!fn(i)) {
+                fOk = false;
+            }
+        }
+    };
+    const unsigned int nThreads = std::max<unsigned int>(
+        1, std::min<unsigned int>(MAX_BLOCK_INDEX_SNAPSHOT_THREADS,
+                                  std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < nThreads && i < n; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return fOk;
+}
+} // namespace
+
+bool CBlockTreeDB::WriteBlockIndexSnapshot(
+    const fs::path &path, const std::vector<const CBlockIndex *> &vIndex) {
+    std::unordered_map<const CBlockIndex *, uint64_t> mapPos;
+    mapPos.reserve(vIndex.size());
+
+    // Serialize the entries, in chunks that can be decoded independently.
+    CDataStream body(SER_DISK, CLIENT_VERSION);
+    std::vector<uint64_t> vChunkPos;
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        const CBlockIndex *pindex = vIndex[i];
+        uint64_t nParentPos = 0;
+        if (pindex->pprev) {
+            auto it = mapPos.find(pindex->pprev);
+            if (it == mapPos.end()) {
+                return error("%s: block index is not sorted by height",
+                             __func__);
+            }
+            nParentPos = it->second + 1;
+        }
+        mapPos.emplace(pindex, i);
+
+        if (i % BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE == 0) {
+            vChunkPos.push_back(body.size());
+        }
+        body << CSnapshotBlockIndex(const_cast<CBlockIndex *>(pindex),
+                                    nParentPos, pindex->GetBlockHash());
+    }
+
+    const uint256 id = GetRandHash();
+    const fs::path pathTmp = path.string() + ".new";
+    FILE *file = fsbridge::fopen(pathTmp, "wb");
+    if (!file) {
+        return error("%s: failed to open %s", __func__, pathTmp.string());
+    }
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    try {
+        fileout << BLOCK_INDEX_SNAPSHOT_VERSION << id
+                << uint64_t(vIndex.size()) << vChunkPos;
+        fileout.write(body.data(), body.size());
+    } catch (const std::exception &e) {
+        return error("%s: failed to write %s: %s", __func__, pathTmp.string(),
+                     e.what());
+    }
+    if (!FileCommit(fileout.Get())) {
+        return error("%s: failed to commit %s", __func__, pathTmp.string());
+    }
+    fileout.fclose();
+    if (!RenameOver(pathTmp, path)) {
+        return error("%s: failed to rename %s", __func__, pathTmp.string());
+    }
+
+    // Only now that the file is complete, declare it up to date.
+    return Write(DB_BLOCK_INDEX_SNAPSHOT, id, true);
+}
+
+bool CBlockTreeDB::LoadBlockIndexSnapshot(
+    const fs::path &path, const Consensus::Params &params,
+    CBlockIndexArena &arena,
+    std::vector<std::pair<uint256, CBlockIndex *>> &vIndex) {
+    uint256 idExpected;
+    if (!Read(DB_BLOCK_INDEX_SNAPSHOT, idExpected)) {
+        return false;
+    }
+
+    FILE *file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> vData;
+    {
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        uint8_t buf[1 << 16];
+        size_t nRead;
+        while ((nRead = fread(buf, 1, sizeof(buf), filein.Get())) > 0) {
+            vData.insert(vData.end(), buf, buf + nRead);
+        }
+    }
+
+    SpanReader reader(SER_DISK, CLIENT_VERSION,
+                      Span<const uint8_t>(vData.data(), vData.size()));
+    uint32_t nVersion;
+    uint256 id;
+    uint64_t nCount;
+    std::vector<uint64_t> vChunkPos;
+    try {
+        reader >> nVersion >> id >> nCount >> vChunkPos;
+    } catch (const std::exception &e) {
+        return error("%s: failed to read %s: %s", __func__, path.string(),
+                     e.what());
+    }
+    if (nVersion != BLOCK_INDEX_SNAPSHOT_VERSION || id != idExpected) {
+        LogPrintf("%s: block index snapshot %s is out of date\n", __func__,
+                  path.string());
+        return false;
+    }
+
+    // Every entry takes more than one byte, which bounds nCount before
+    // anything gets allocated.
+    const Span<const uint8_t> body(vData.data() + vData.size() - reader.size(),
+                                   reader.size());
+    const size_t nChunks = vChunkPos.size();
+    if (nCount > body.size() ||
+        nChunks != (nCount + BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE - 1) /
+                       BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE) {
+        return error("%s: %s is corrupt", __func__, path.string());
+    }
+    for (size_t c = 0; c < nChunks; c++) {
+        const uint64_t nEnd = c + 1 < nChunks ? vChunkPos[c + 1] : body.size();
+        if (vChunkPos[c] > nEnd) {
+            return error("%s: %s is corrupt", __func__, path.string());
+        }
+    }
+
+    CBlockIndex *base = arena.AllocateBulk(nCount);
+    vIndex.resize(nCount);
+
+    // Decode the chunks in parallel. Parents always come before their
+    // children, but may be in a chunk another thread is still decoding, so
+    // only link them here and check the hashes once everything is decoded.
+    bool fOk = ParallelFor(nChunks, [&](size_t c) {
+        const size_t nBegin = c * BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE;
+        const size_t nEnd = std::min<size_t>(
+            nBegin + BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE, nCount);
+        const uint64_t nChunkEnd =
+            c + 1 < nChunks ? vChunkPos[c + 1] : body.size();
+        SpanReader chunk(SER_DISK, CLIENT_VERSION,
+                         Span<const uint8_t>(body.data() + vChunkPos[c],
+                                             nChunkEnd - vChunkPos[c]));
+        try {
+            for (size_t i = nBegin; i < nEnd; i++) {
+                CSnapshotBlockIndex entry(&base[i]);
+                chunk >> entry;
+                if (entry.nParentPos > i) {
+                    return false;
+                }
+                base[i].pprev =
+                    entry.nParentPos ? &base[entry.nParentPos - 1] : nullptr;
+                vIndex[i] = std::make_pair(entry.hash, &base[i]);
+            }
+        } catch (const std::exception &) {
+            return false;
+        }
+        return true;
+    });
+
+    fOk = fOk && ParallelFor(nChunks, [&](size_t c) {
+        const size_t nBegin = c * BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE;
+        const size_t nEnd = std::min<size_t>(
+            nBegin + BLOCK_INDEX_SNAPSHOT_CHUNK_SIZE, nCount);
+        for (size_t i = nBegin; i < nEnd; i++) {
+            const CBlockIndex &index = base[i];
+            CBlockHeader header;
+            header.nVersion = index.nVersion;
+            if (index.pprev) {
+                header.hashPrevBlock = vIndex[index.pprev - base].first;
+            }
+            header.hashMerkleRoot = index.hashMerkleRoot;
+            header.nTime = index.nTime;
+            header.nBits = index.nBits;
+            header.nNonce = index.nNonce;
+            if (header.GetHash() != vIndex[i].first ||
+                !CheckProofOfWork(vIndex[i].first, index.nBits, params)) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    if (!fOk) {
+        vIndex.clear();
+        return error("%s: %s is corrupt", __func__, path.string());
+    }
+    return true;
+}
+
 namespace {
 //! Legacy class to deserialize pre-pertxout database entries without reindex.
 class CCoins {
@@ -17,11 +17,13 @@
 #include "timestampindex.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 class CBlockIndex;
+class CBlockIndexArena;
 class CCoinsViewDBCursor;
 class uint256;
 
@@ -68,6 +70,15 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Split the coin database into nRanges ranges of txid prefixes and return
+     * one cursor per range, in txid order. All the cursors read from the same
+     * database snapshot, so they can be consumed concurrently and together
+     * visit every coin exactly once. nRanges must be between 1 and 256.
+     */
+    std::vector<std::unique_ptr<CCoinsViewCursor>>
+    RangeCursors(size_t nRanges) const;
+
     //! Attempt to update from an older database format.
     //! Returns whether an error occurred.
     bool Upgrade();
@@ -89,9 +100,25 @@ public:
 private:
     CCoinsViewDBCursor(CDBIterator *pcursorIn, const uint256 &hashBlockIn)
         : CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(std::shared_ptr<const CDBSnapshot> snapshotIn,
+                       CDBIterator *pcursorIn, const uint256 &hashBlockIn,
+                       const TxId &txidEndIn)
+        : CCoinsViewCursor(hashBlockIn), snapshot(std::move(snapshotIn)),
+          pcursor(pcursorIn), txidEnd(txidEndIn) {}
+
+    //! Cache the key of the record the iterator points to, or invalidate the
+    //! cursor if it is past the last coin of its range.
+    void CacheKey();
+
+    //! Must outlive pcursor, so it is declared first.
+    std::shared_ptr<const CDBSnapshot> snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
 
+    //! Unless null, iteration stops at the first coin whose txid is not below
+    //! txidEnd.
+    TxId txidEnd;
+
     friend class CCoinsViewDB;
 };
 
@@ -112,6 +139,24 @@ public:
     bool LoadBlockIndexGuts(
         const Consensus::Params &params,
         std::function<CBlockIndex *(const uint256 &)> insertBlockIndex);
+
+    /**
+     * Write all of vIndex, sorted by height, to a snapshot file at path that
+     * can be loaded much faster than the block index records. The snapshot
+     * stays valid until block index records are written again.
+     */
+    bool
+    WriteBlockIndexSnapshot(const fs::path &path,
+                            const std::vector<const CBlockIndex *> &vIndex);
+    /**
+     * Load the block index snapshot at path if it is valid. Entries are
+     * allocated from arena and returned with their hash in height order,
+     * linked to their parents. Their phashBlock is left unset.
+     */
+    bool LoadBlockIndexSnapshot(
+        const fs::path &path, const Consensus::Params &params,
+        CBlockIndexArena &arena,
+        std::vector<std::pair<uint256, CBlockIndex *>> &vIndex);
 };
 
 #endif // BITCOIN_TXDB_H
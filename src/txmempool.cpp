@@ -24,6 +24,7 @@
 #include <version.h>
 
 #include <algorithm>
+#include <unordered_map>
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef &_tx, const Amount _nFee,
                                  int64_t _nTime, double _entryPriority,
@@ -75,54 +76,118 @@ void CTxMemPoolEntry::UpdateLockPoints(const LockPoints &lp) {
     lockPoints = lp;
 }
 
-// Update the given tx for any in-mempool descendants.
-// Assumes that setMemPoolChildren is correct for the given tx and all
-// descendants.
-void CTxMemPool::UpdateForDescendants(txiter updateIt,
-                                      cacheMap &cachedDescendants,
-                                      const std::set<TxId> &setExclude) {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
-
-    while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
-        setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
-        for (txiter childEntry : setChildren) {
-            cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
-            if (cacheIt != cachedDescendants.end()) {
-                // We've already calculated this one, just add the entries for
-                // this set but don't traverse again.
-                for (txiter cacheEntry : cacheIt->second) {
-                    setAllDescendants.insert(cacheEntry);
-                }
-            } else if (!setAllDescendants.count(childEntry)) {
-                // Schedule for later processing
-                stageEntries.insert(childEntry);
+namespace {
+//! Sizes, fees, counts and sigops summed over some mempool entries.
+struct EntryTotals {
+    int64_t nSize = 0;
+    Amount nFee = Amount::zero();
+    int64_t nCount = 0;
+    int64_t nSigOps = 0;
+
+    void Add(const CTxMemPoolEntry &entry) {
+        nSize += entry.GetTxSize();
+        nFee += entry.GetModifiedFee();
+        nCount++;
+        nSigOps += entry.GetSigOpCount();
+    }
+};
+} // namespace
+
+static CTxMemPool::TxLinkSet GetLinks(const CTxMemPool &pool,
+                                      CTxMemPool::txiter it, bool fChildren)
+    EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+    return fChildren ? pool.GetMemPoolChildren(it) : pool.GetMemPoolParents(it);
+}
+
+/**
+ * For every entry reachable from entries through children (fDescendants) or
+ * through parents, entries included, sum up the entries in entries which are
+ * its strict ancestors (fDescendants) or strict descendants.
+ *
+ * The entries reached are returned in topological order, away from entries.
+ * An entry linked to a single parent (or child) gets the totals of that one
+ * plus the link itself, so that along a chain this costs time proportional to
+ * the number of entries reached rather than to the square of the chain depth.
+ * Only entries reached through several links walk all their ancestors (or
+ * descendants), so that the ones found through several paths count once.
+ */
+static std::vector<std::pair<CTxMemPool::txiter, EntryTotals>>
+SumLinkedEntries(const CTxMemPool &pool, const CTxMemPool::setEntries &entries,
+                 bool fDescendants) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+    typedef CTxMemPool::txiter txiter;
+
+    // Depth first search, in which every entry is finished after all the
+    // entries it leads to. Reversing that order visits every entry after all
+    // the entries it is reached from.
+    std::unordered_map<TxId, size_t, SaltedTxidHasher> mapIndex;
+    std::vector<txiter> vOrder;
+    struct Frame {
+        txiter it;
+        CTxMemPool::TxLinkSet::const_iterator next, end;
+    };
+    std::vector<Frame> stack;
+    for (txiter root : entries) {
+        if (!mapIndex.emplace(root->GetTx().GetId(), 0).second) {
+            continue;
+        }
+        const CTxMemPool::TxLinkSet links = GetLinks(pool, root, fDescendants);
+        stack.push_back(Frame{root, links.begin(), links.end()});
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.next == frame.end) {
+                vOrder.push_back(frame.it);
+                stack.pop_back();
+                continue;
+            }
+            const txiter it = *frame.next;
+            ++frame.next;
+            if (mapIndex.emplace(it->GetTx().GetId(), 0).second) {
+                const CTxMemPool::TxLinkSet itLinks =
+                    GetLinks(pool, it, fDescendants);
+                stack.push_back(Frame{it, itLinks.begin(), itLinks.end()});
             }
         }
     }
-    // setAllDescendants now contains all in-mempool descendants of updateIt.
-    // Update and add to cached descendant map
-    int64_t modifySize = 0;
-    int64_t modifyCount = 0;
-    Amount modifyFee = Amount::zero();
-    for (txiter cit : setAllDescendants) {
-        if (!setExclude.count(cit->GetTx().GetId())) {
-            modifySize += cit->GetTxSize();
-            modifyFee += cit->GetModifiedFee();
-            modifyCount++;
-            cachedDescendants[updateIt].insert(cit);
-            // Update ancestor state for each descendant
-            mapTx.modify(cit,
-                         update_ancestor_state(updateIt->GetTxSize(),
-                                               updateIt->GetModifiedFee(), 1,
-                                               updateIt->GetSigOpCount()));
+    std::reverse(vOrder.begin(), vOrder.end());
+    for (size_t i = 0; i < vOrder.size(); i++) {
+        mapIndex[vOrder[i]->GetTx().GetId()] = i;
+    }
+
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::vector<std::pair<txiter, EntryTotals>> totals;
+    totals.reserve(vOrder.size());
+    for (txiter it : vOrder) {
+        EntryTotals itTotals;
+        const CTxMemPool::TxLinkSet links = GetLinks(pool, it, !fDescendants);
+        if (links.size() == 1) {
+            const txiter link = *links.begin();
+            auto found = mapIndex.find(link->GetTx().GetId());
+            if (found != mapIndex.end()) {
+                itTotals = totals[found->second].second;
+            }
+            if (entries.count(link)) {
+                itTotals.Add(*link);
+            }
+        } else if (links.size() > 1) {
+            CTxMemPool::setEntries setLinked;
+            if (fDescendants) {
+                std::string dummy;
+                pool.CalculateMemPoolAncestors(*it, setLinked, nNoLimit,
+                                               nNoLimit, nNoLimit, nNoLimit,
+                                               dummy, false);
+            } else {
+                pool.CalculateDescendants(it, setLinked);
+                setLinked.erase(it);
+            }
+            for (txiter linked : setLinked) {
+                if (entries.count(linked)) {
+                    itTotals.Add(*linked);
+                }
+            }
         }
+        totals.emplace_back(it, itTotals);
     }
-    mapTx.modify(updateIt,
-                 update_descendant_state(modifySize, modifyFee, modifyCount));
+    return totals;
 }
 
 // txidsToUpdate is the set of transaction hashes from a disconnected block
@@ -133,48 +198,63 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt,
 void CTxMemPool::UpdateTransactionsFromBlock(
     const std::vector<TxId> &txidsToUpdate) {
     LOCK(cs);
-    // For each entry in txidsToUpdate, store the set of in-mempool, but not
-    // in-txidsToUpdate transactions, so that we don't have to recalculate
-    // descendants when we come across a previously seen entry.
-    cacheMap mapMemPoolDescendantsToUpdate;
-
     // Use a set for lookups into txidsToUpdate (these entries are already
     // accounted for in the state of their ancestors)
     std::set<TxId> setAlreadyIncluded(txidsToUpdate.begin(),
                                       txidsToUpdate.end());
 
-    // Iterate in reverse, so that whenever we are looking at a transaction
-    // we are sure that all in-mempool descendants have already been processed.
-    // This maximizes the benefit of the descendant cache and guarantees that
-    // setMemPoolChildren will be updated, an assumption made in
-    // UpdateForDescendants.
-    for (const TxId &txid : reverse_iterate(txidsToUpdate)) {
-        // we cache the in-mempool children to avoid duplicate updates
-        setEntries setChildren;
-        // calculate children from mapNextTx
+    setEntries setBlockEntries;
+    for (const TxId &txid : txidsToUpdate) {
         txiter it = mapTx.find(txid);
         if (it == mapTx.end()) {
             continue;
         }
+        setBlockEntries.insert(it);
 
-        auto iter = mapNextTx.lower_bound(COutPoint(txid, 0));
-        // First calculate the children, and update setMemPoolChildren to
+        // Calculate children from mapNextTx, and update setMemPoolChildren to
         // include them, and update their setMemPoolParents to include this tx.
+        auto iter = mapNextTx.lower_bound(COutPoint(txid, 0));
         for (; iter != mapNextTx.end() && iter->first->GetTxId() == txid;
              ++iter) {
             const TxId &childTxId = iter->second->GetId();
             txiter childIter = mapTx.find(childTxId);
             assert(childIter != mapTx.end());
-            // We can skip updating entries we've encountered before or that are
-            // in the block (which are already accounted for).
-            if (setChildren.insert(childIter).second &&
-                !setAlreadyIncluded.count(childTxId)) {
+            // We can skip updating entries that are in the block (which are
+            // already accounted for).
+            if (!setAlreadyIncluded.count(childTxId)) {
                 UpdateChild(it, childIter, true);
                 UpdateParent(childIter, it, true);
             }
         }
-        UpdateForDescendants(it, mapMemPoolDescendantsToUpdate,
-                             setAlreadyIncluded);
+    }
+
+    // Add the block transactions to the ancestor state of their descendants
+    // outside of the block...
+    setEntries setDescendants;
+    for (const auto &descendant :
+         SumLinkedEntries(*this, setBlockEntries, true)) {
+        if (setAlreadyIncluded.count(descendant.first->GetTx().GetId())) {
+            continue;
+        }
+        setDescendants.insert(descendant.first);
+        const EntryTotals &added = descendant.second;
+        mapTx.modify(descendant.first,
+                     update_ancestor_state(added.nSize, added.nFee,
+                                           added.nCount, added.nSigOps));
+    }
+
+    // ... and those descendants to the descendant state of the block
+    // transactions.
+    for (const auto &ancestor :
+         SumLinkedEntries(*this, setDescendants, false)) {
+        const EntryTotals &added = ancestor.second;
+        if (added.nCount == 0 ||
+            !setAlreadyIncluded.count(ancestor.first->GetTx().GetId())) {
+            continue;
+        }
+        mapTx.modify(ancestor.first,
+                     update_descendant_state(added.nSize, added.nFee,
+                                             added.nCount));
     }
 }
 
@@ -204,11 +284,29 @@ bool CTxMemPool::CalculateMemPoolAncestors(
                 return false;
             }
         }
+
+        // The ancestors of every parent are ancestors of this transaction too,
+        // so that the limits can be found exceeded without walking them all.
+        for (txiter piter : parentHashes) {
+            if (piter->GetCountWithAncestors() + 1 > limitAncestorCount) {
+                errString =
+                    strprintf("too many unconfirmed ancestors [limit: %u]",
+                              limitAncestorCount);
+                return false;
+            }
+            if (piter->GetSizeWithAncestors() + entry.GetTxSize() >
+                limitAncestorSize) {
+                errString = strprintf("exceeds ancestor size limit [limit: %u]",
+                                      limitAncestorSize);
+                return false;
+            }
+        }
     } else {
         // If we're not searching for parents, we require this to be an entry in
         // the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        const TxLinkSet &parents = GetMemPoolParents(it);
+        parentHashes.insert(parents.begin(), parents.end());
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
@@ -241,7 +339,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(
             return false;
         }
 
-        const setEntries &setMemPoolParents = GetMemPoolParents(stageit);
+        const TxLinkSet &setMemPoolParents = GetMemPoolParents(stageit);
         for (txiter phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
             if (setAncestors.count(phash) == 0) {
@@ -262,7 +360,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it,
                                    setEntries &setAncestors) {
-    setEntries parentIters = GetMemPoolParents(it);
+    const TxLinkSet &parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
     for (txiter piter : parentIters) {
         UpdateChild(piter, it, add);
@@ -293,7 +391,7 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it,
 }
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it) {
-    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
+    const TxLinkSet &setMemPoolChildren = GetMemPoolChildren(it);
     for (txiter updateIt : setMemPoolChildren) {
         UpdateParent(updateIt, it, false);
     }
@@ -301,57 +399,57 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it) {
 
 void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove,
                                             bool updateDescendants) {
-    // For each entry, walk back all ancestors and decrement size associated
-    // with this transaction.
-    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
     if (updateDescendants) {
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
         // confirmed in a block. Here we only update statistics and not data in
-        // mapLinks (which we need to preserve until we're finished with all
+        // entry links (which we need to preserve until we're finished with all
         // operations that need to traverse the mempool).
-        for (txiter removeIt : entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
-            int64_t modifySize = -int64_t(removeIt->GetTxSize());
-            Amount modifyFee = -1 * removeIt->GetModifiedFee();
-            int modifySigOps = -removeIt->GetSigOpCount();
-            for (txiter dit : setDescendants) {
-                mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee,
-                                                        -1, modifySigOps));
+        for (const auto &descendant :
+             SumLinkedEntries(*this, entriesToRemove, true)) {
+            const EntryTotals &removed = descendant.second;
+            if (removed.nCount == 0 ||
+                entriesToRemove.count(descendant.first)) {
+                continue;
             }
+            mapTx.modify(descendant.first,
+                         update_ancestor_state(
+                             -removed.nSize, -1 * removed.nFee,
+                             -removed.nCount, -removed.nSigOps));
         }
     }
 
+    // Walk back all ancestors and decrement the size, fees and count of the
+    // transactions being removed among their descendants.
+    // If we happen to be in the middle of processing a reorg, then the mempool
+    // can be in an inconsistent state. In this case, the set of ancestors
+    // reachable via entry links will be the same as the set of ancestors whose
+    // packages include these transactions, because when we add a new
+    // transaction to the mempool in addUnchecked(), we assume it has no
+    // children, and in the case of a reorg where that assumption is false, the
+    // in-mempool children aren't linked to the in-block tx's until
+    // UpdateTransactionsFromBlock() is called. So if we're being called during
+    // a reorg, ie before UpdateTransactionsFromBlock() has been called, then
+    // entry links will differ from the set of mempool parents we'd calculate
+    // by searching, and it's important that we use the entry links notion of
+    // ancestor transactions as the set of things to update for removal.
+    for (const auto &ancestor :
+         SumLinkedEntries(*this, entriesToRemove, false)) {
+        const EntryTotals &removed = ancestor.second;
+        if (removed.nCount == 0 || entriesToRemove.count(ancestor.first)) {
+            continue;
+        }
+        mapTx.modify(ancestor.first,
+                     update_descendant_state(-removed.nSize, -1 * removed.nFee,
+                                             -removed.nCount));
+    }
+    // Sever the links from the parents of each transaction being removed...
     for (txiter removeIt : entriesToRemove) {
-        setEntries setAncestors;
-        const CTxMemPoolEntry &entry = *removeIt;
-        std::string dummy;
-        // Since this is a tx that is already in the mempool, we can call CMPA
-        // with fSearchForParents = false.  If the mempool is in a consistent
-        // state, then using true or false should both be correct, though false
-        // should be a bit faster.
-        // However, if we happen to be in the middle of processing a reorg, then
-        // the mempool can be in an inconsistent state. In this case, the set of
-        // ancestors reachable via mapLinks will be the same as the set of
-        // ancestors whose packages include this transaction, because when we
-        // add a new transaction to the mempool in addUnchecked(), we assume it
-        // has no children, and in the case of a reorg where that assumption is
-        // false, the in-mempool children aren't linked to the in-block tx's
-        // until UpdateTransactionsFromBlock() is called. So if we're being
-        // called during a reorg, ie before UpdateTransactionsFromBlock() has
-        // been called, then mapLinks[] will differ from the set of mempool
-        // parents we'd calculate by searching, and it's important that we use
-        // the mapLinks[] notion of ancestor transactions as the set of things
-        // to update for removal.
-        CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit,
-                                  nNoLimit, nNoLimit, dummy, false);
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
-    }
-    // After updating all the ancestor sizes, we can now sever the link between
+        for (txiter parentIt : GetMemPoolParents(removeIt)) {
+            UpdateChild(parentIt, removeIt, false);
+        }
+    }
+    // ... and after updating all the ancestor sizes, sever the link between
     // each transaction being removed and any mempool children (ie, update
     // setMemPoolParents for each direct child of a transaction being removed).
     for (txiter removeIt : entriesToRemove) {
@@ -414,7 +512,6 @@ void CTxMemPool::addUnchecked(const uint256 &hash, const CTxMemPoolEntry &entry,
     // Add to memory pool without checking anything.
     // Used by AcceptToMemoryPool(), which DOES do all the appropriate checks.
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
-    mapLinks.insert(std::make_pair(newit, TxLinks()));
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting into
@@ -620,10 +717,9 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason) {
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) +
-                        memusage::DynamicUsage(mapLinks[it].children);
+    cachedInnerUsage -= memusage::DynamicUsage(it->vMemPoolParents) +
+                        memusage::DynamicUsage(it->vMemPoolChildren);
     const TxId txid = it->GetTx().GetId();
-    mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
     removeAddressIndex(txid);
@@ -650,7 +746,7 @@ void CTxMemPool::CalculateDescendants(txiter entryit,
         setDescendants.insert(it);
         stage.erase(it);
 
-        const setEntries &setChildren = GetMemPoolChildren(it);
+        const TxLinkSet &setChildren = GetMemPoolChildren(it);
         for (txiter childiter : setChildren) {
             if (!setDescendants.count(childiter)) {
                 stage.insert(childiter);
@@ -783,14 +879,16 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
         }
     }
 
+    // Remove the block transactions at once, so that the state of their
+    // in-mempool descendants is updated once rather than once per ancestor.
+    setEntries stage;
+    for (const CTxMemPoolEntry *entry : entries) {
+        stage.insert(mapTx.iterator_to(*entry));
+    }
+    RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+
     for (const CTransactionRef &tx :
          reverse_iterate(disconnectpool.GetQueuedTx().get<insertion_order>())) {
-        txiter it = mapTx.find(tx->GetId());
-        if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
-        }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetId());
     }
@@ -802,7 +900,6 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
 }
 
 void CTxMemPool::_clear() {
-    mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
     vTxHashes.clear();
@@ -858,11 +955,8 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const {
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction &tx = it->GetTx();
-        txlinksMap::const_iterator linksiter = mapLinks.find(it);
-        assert(linksiter != mapLinks.end());
-        const TxLinks &links = linksiter->second;
-        innerUsage += memusage::DynamicUsage(links.parents) +
-                      memusage::DynamicUsage(links.children);
+        innerUsage += memusage::DynamicUsage(it->vMemPoolParents) +
+                      memusage::DynamicUsage(it->vMemPoolChildren);
         bool fDependsWait = false;
         setEntries setParentCheck;
         for (const CTxIn &txin : tx.vin) {
@@ -886,7 +980,9 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const {
             assert(it3->second == &tx);
             i++;
         }
-        assert(setParentCheck == GetMemPoolParents(it));
+        const TxLinkSet parents = GetMemPoolParents(it);
+        assert(std::equal(setParentCheck.begin(), setParentCheck.end(),
+                          parents.begin(), parents.end()));
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -923,7 +1019,9 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const {
                 child_sizes += childit->GetTxSize();
             }
         }
-        assert(setChildrenCheck == GetMemPoolChildren(it));
+        const TxLinkSet children = GetMemPoolChildren(it);
+        assert(std::equal(setChildrenCheck.begin(), setChildrenCheck.end(),
+                          children.begin(), children.end()));
         // Also check to make sure size is greater than sum with immediate
         // children. Just a sanity check, not definitive that this calc is
         // correct...
@@ -1171,7 +1269,6 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
                mapTx.size() +
            memusage::DynamicUsage(mapNextTx) +
            memusage::DynamicUsage(mapDeltas) +
-           memusage::DynamicUsage(mapLinks) +
            memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
@@ -1227,38 +1324,52 @@ void CTxMemPool::addUnchecked(const uint256 &hash,
     return addUnchecked(hash, entry, setAncestors);
 }
 
-void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add) {
-    setEntries s;
-    if (add && mapLinks[entry].children.insert(child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].children.erase(child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+static bool CompareEntryByHash(const CTxMemPoolEntry *a,
+                               const CTxMemPoolEntry *b) {
+    return a->GetTx().GetId() < b->GetTx().GetId();
+}
+
+// Adds or removes other in the sorted links of an entry, and accounts for the
+// memory they use.
+static void UpdateLinks(std::vector<const CTxMemPoolEntry *> &links,
+                        const CTxMemPoolEntry &other, bool add,
+                        uint64_t &cachedInnerUsage) {
+    auto pos = std::lower_bound(links.begin(), links.end(), &other,
+                                CompareEntryByHash);
+    const bool found = pos != links.end() && *pos == &other;
+    if (add == found) {
+        return;
+    }
+
+    cachedInnerUsage -= memusage::DynamicUsage(links);
+    if (add) {
+        links.insert(pos, &other);
+    } else if (links.size() > 1) {
+        links.erase(pos);
+    } else {
+        // Release the allocation of entries which lost all their links, as
+        // most of them never get new ones.
+        std::vector<const CTxMemPoolEntry *>().swap(links);
     }
+    cachedInnerUsage += memusage::DynamicUsage(links);
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add) {
+    UpdateLinks(entry->vMemPoolChildren, *child, add, cachedInnerUsage);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add) {
-    setEntries s;
-    if (add && mapLinks[entry].parents.insert(parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].parents.erase(parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLinks(entry->vMemPoolParents, *parent, add, cachedInnerUsage);
 }
 
-const CTxMemPool::setEntries &
-CTxMemPool::GetMemPoolParents(txiter entry) const {
+CTxMemPool::TxLinkSet CTxMemPool::GetMemPoolParents(txiter entry) const {
     assert(entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.parents;
+    return TxLinkSet(entry->vMemPoolParents, mapTx);
 }
 
-const CTxMemPool::setEntries &
-CTxMemPool::GetMemPoolChildren(txiter entry) const {
+CTxMemPool::TxLinkSet CTxMemPool::GetMemPoolChildren(txiter entry) const {
     assert(entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.children;
+    return TxLinkSet(entry->vMemPoolChildren, mapTx);
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
@@ -1357,7 +1468,7 @@ uint64_t CTxMemPool::CalculateDescendantMaximum(txiter entry) const {
         if (!counted.insert(candidate).second) {
             continue;
         }
-        const setEntries &parents = GetMemPoolParents(candidate);
+        const TxLinkSet &parents = GetMemPoolParents(candidate);
         if (parents.size() == 0) {
             maximum = std::max(maximum, candidate->GetCountWithDescendants());
         } else {
@@ -1498,8 +1609,9 @@ void DisconnectedBlockTransactions::updateMempoolForReorg(const Config &config,
         // ignore validation errors in resurrected transactions
         CValidationState stateDummy;
         if (!fAddToMempool || tx->IsCoinBase() ||
-            !AcceptToMemoryPool(config, g_mempool, stateDummy, tx, false,
-                                nullptr, true)) {
+            !AcceptToMemoryPool(config, g_mempool, stateDummy,
+                                DetachTransaction(tx), false, nullptr,
+                                true)) {
             // If the transaction doesn't make it in to the mempool, remove any
             // transactions that depend on it (which would now be orphans).
             g_mempool.removeRecursive(*tx, MemPoolRemovalReason::REORG);
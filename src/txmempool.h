@@ -172,6 +172,10 @@ public:
 
     //!< Index in mempool's vTxHashes
     mutable size_t vTxHashesIdx;
+    //!< Direct in-mempool parents and children, sorted by txid. They are
+    //!< maintained by the mempool, see CTxMemPool::GetMemPoolParents().
+    mutable std::vector<const CTxMemPoolEntry *> vMemPoolParents;
+    mutable std::vector<const CTxMemPoolEntry *> vMemPoolChildren;
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -434,8 +438,8 @@ typedef std::pair<double, Amount> TXModifier;
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive. To facilitate this, we track the
- * set of in-mempool direct parents and direct children in mapLinks. Within each
- * CTxMemPoolEntry, we track the size and fees of all descendants.
+ * set of in-mempool direct parents and direct children of each entry. Within
+ * each CTxMemPoolEntry, we also track the size and fees of all descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
  * children (because any such children would be an orphan). So in
@@ -467,7 +471,7 @@ typedef std::pair<double, Amount> TXModifier;
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock(). Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the entry links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely on them to
  * walk the mempool are not generally safe to use).
  *
@@ -574,23 +578,70 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries &GetMemPoolParents(txiter entry) const
+    /**
+     * A view of the direct in-mempool parents or children of an entry, sorted
+     * like setEntries. They are kept in the entry itself, as most entries only
+     * have a few of them, which a sorted vector holds in a single allocation
+     * rather than in one tree node each.
+     */
+    class TxLinkSet {
+    private:
+        typedef std::vector<const CTxMemPoolEntry *> Links;
+
+        const Links &vLinks;
+        const indexed_transaction_set &mapTx;
+
+    public:
+        class const_iterator {
+        private:
+            Links::const_iterator it;
+            const indexed_transaction_set *mapTx;
+
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef txiter value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const txiter *pointer;
+            typedef txiter reference;
+
+            const_iterator(Links::const_iterator itIn,
+                           const indexed_transaction_set *mapTxIn)
+                : it(itIn), mapTx(mapTxIn) {}
+
+            txiter operator*() const { return mapTx->iterator_to(**it); }
+            const_iterator &operator++() {
+                ++it;
+                return *this;
+            }
+            bool operator==(const const_iterator &other) const {
+                return it == other.it;
+            }
+            bool operator!=(const const_iterator &other) const {
+                return it != other.it;
+            }
+        };
+
+        TxLinkSet(const Links &vLinksIn, const indexed_transaction_set &mapTxIn)
+            : vLinks(vLinksIn), mapTx(mapTxIn) {}
+
+        const_iterator begin() const {
+            return const_iterator(vLinks.begin(), &mapTx);
+        }
+        const_iterator end() const {
+            return const_iterator(vLinks.end(), &mapTx);
+        }
+        size_t size() const { return vLinks.size(); }
+        bool empty() const { return vLinks.empty(); }
+    };
+
+    TxLinkSet GetMemPoolParents(txiter entry) const
         EXCLUSIVE_LOCKS_REQUIRED(cs);
-    const setEntries &GetMemPoolChildren(txiter entry) const
+    TxLinkSet GetMemPoolChildren(txiter entry) const
         EXCLUSIVE_LOCKS_REQUIRED(cs);
     uint64_t CalculateDescendantMaximum(txiter entry) const
         EXCLUSIVE_LOCKS_REQUIRED(cs);
 
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
-
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
-    };
-
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
 
     typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
     addressDeltaMap mapAddress;
@@ -709,6 +760,8 @@ public:
      * for).
      * Note: txidsToUpdate should be the set of transactions from the
      * disconnected block that have been accepted back into the mempool.
+     * This costs time proportional to the number of entries updated, as long
+     * as they are linked in chains.
      */
     void UpdateTransactionsFromBlock(const std::vector<TxId> &txidsToUpdate)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -722,7 +775,7 @@ public:
      *  limitDescendantSize = max size of descendants any ancestor can have
      *  errString = populated with error reason if any limits are hit
      * fSearchForParents = whether to search a tx's vin for in-mempool parents,
-     * or look up parents from mapLinks. Must be true for entries not in the
+     * or look up parents from the entry links. Must be true for entries not in the
      * mempool
      */
     bool CalculateMemPoolAncestors(
@@ -804,22 +857,6 @@ public:
         NotifyEntryRemoved;
 
 private:
-    /**
-     * UpdateForDescendants is used by UpdateTransactionsFromBlock to update the
-     * descendants for a single transaction that has been added to the mempool
-     * but may have child transactions in the mempool, eg during a chain reorg.
-     * setExclude is the set of descendant transactions in the mempool that must
-     * not be accounted for (because any descendants in setExclude were added to
-     * the mempool after the transaction being updated and hence their state is
-     * already reflected in the parent state).
-     *
-     * cachedDescendants will be updated with the descendants of the transaction
-     * being updated, so that future invocations don't need to walk the same
-     * transaction again, if encountered in another transaction chain.
-     */
-    void UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants,
-                              const std::set<TxId> &setExclude)
-        EXCLUSIVE_LOCKS_REQUIRED(cs);
     /**
      * Update ancestors of hash to add/remove it as a descendant transaction.
      */
@@ -136,11 +136,11 @@ DisconnectResult UndoCoinSpend(const Coin &undo, CCoinsViewCache &view,
 
 /**
  * Undo a block from the block and the undoblock data.
- * See DisconnectBlock for more details.
+ * See DisconnectBlock for more details. Changes to the address and spent
+ * indexes are buffered, for the caller to write.
  */
 DisconnectResult ApplyBlockUndo(const CBlockUndo &blockUndo,
                                 const CBlock &block, const CBlockIndex *pindex,
-                                CCoinsViewCache &coins,
-                                bool fJustCheck = false);
+                                CCoinsViewCache &coins);
 
 #endif // BITCOIN_UNDO_H
@@ -1226,6 +1226,26 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
 #endif
 }
 
+void AdviseFileAccess(FILE *file, int64_t offset, int64_t length,
+                      FileAccess access) {
+#if !defined(WIN32) && defined(POSIX_FADV_WILLNEED)
+    int advice = POSIX_FADV_NORMAL;
+    switch (access) {
+        case FileAccess::SEQUENTIAL:
+            advice = POSIX_FADV_SEQUENTIAL;
+            break;
+        case FileAccess::WILLNEED:
+            advice = POSIX_FADV_WILLNEED;
+            break;
+        case FileAccess::DONTNEED:
+            advice = POSIX_FADV_DONTNEED;
+            break;
+    }
+    // Allowed to fail; this function is advisory anyway.
+    posix_fadvise(fileno(file), offset, length, advice);
+#endif
+}
+
 #ifdef WIN32
 fs::path GetSpecialFolderPath(int nFolder, bool fCreate) {
     char pszPath[MAX_PATH] = "";
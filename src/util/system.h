@@ -64,6 +64,16 @@ bool FileCommit(FILE *file);
 bool TruncateFile(FILE *file, unsigned int length);
 int RaiseFileDescriptorLimit(int nMinFD);
 void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
+
+/** How a range of a file is about to be used, see AdviseFileAccess */
+enum class FileAccess { SEQUENTIAL, WILLNEED, DONTNEED };
+/**
+ * Hint the operating system about how length bytes of a file from offset, or
+ * the rest of the file if length is 0, are about to be used. This is only
+ * advisory, and does nothing on platforms without posix_fadvise.
+ */
+void AdviseFileAccess(FILE *file, int64_t offset, int64_t length,
+                      FileAccess access);
 bool RenameOver(fs::path src, fs::path dest);
 bool LockDirectory(const fs::path &directory, const std::string lockfile_name,
                    bool probe_only = false);
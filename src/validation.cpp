@@ -18,6 +18,8 @@
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <fs.h>
 #include <hash.h>
@@ -53,7 +55,12 @@
 #include <boost/thread.hpp> // boost::this_thread::interruption_point() (mingw)
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <list>
+#include <map>
+#include <set>
 #include <sstream>
 #include <thread>
 
@@ -127,6 +134,8 @@ private:
 public:
     CChain chainActive;
     BlockMap mapBlockIndex;
+    //! Owns the entries of mapBlockIndex
+    CBlockIndexArena blockIndexArena;
     std::multimap<CBlockIndex *, CBlockIndex *> mapBlocksUnlinked;
     CBlockIndex *pindexBestInvalid = nullptr;
     CBlockIndex *pindexBestParked = nullptr;
@@ -157,13 +166,18 @@ public:
     bool ConnectBlock(const CBlock &block, CValidationState &state,
                       CBlockIndex *pindex, CCoinsViewCache &view,
                       const CChainParams &params,
-                      BlockValidationOptions options, bool fJustCheck = false)
+                      BlockValidationOptions options, bool fJustCheck = false,
+                      CBlockUndo *pblockundo = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block disconnection on our pcoinsTip:
     bool DisconnectTip(const Config &config, CValidationState &state,
                        DisconnectedBlockTransactions *disconnectpool)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool DisconnectTipsTo(const Config &config, CValidationState &state,
+                          const CBlockIndex *pindexFork,
+                          DisconnectedBlockTransactions *disconnectpool)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Manual block validity manipulation:
     bool PreciousBlock(const Config &config, CValidationState &state,
@@ -207,6 +221,21 @@ private:
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex *InsertBlockIndex(const uint256 &hash);
+    /**
+     * Load the block index from its snapshot, if there is a valid one, and
+     * return the entries in height order.
+     */
+    bool LoadBlockIndexSnapshot(
+        const Config &config, CBlockTreeDB &blocktree,
+        std::vector<std::pair<int, CBlockIndex *>> &vSortedByHeight)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /**
+     * Move all block index entries to a single allocation, in the order of
+     * vSortedByHeight, and update it to point to the moved entries.
+     */
+    void MoveBlockIndexToHeightOrder(
+        std::vector<std::pair<int, CBlockIndex *>> &vSortedByHeight)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /**
      * Make various assertions about the state of the block index.
      *
@@ -307,6 +336,9 @@ std::set<const CBlockIndex *> setDirtyBlockIndex;
 
 /** Dirty block file entries. */
 std::set<int> setDirtyFileInfo;
+
+/** Whether the block index snapshot on disk matches the block index. */
+bool fBlockIndexSnapshotCurrent = false;
 } // namespace
 
 BlockValidationOptions::BlockValidationOptions(const Config &config)
@@ -349,6 +381,7 @@ static void FindFilesToPrune(std::set<int> &setFilesToPrune,
 static FILE *OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
+static fs::path GetBlockIndexSnapshotPath();
 static uint32_t GetNextBlockScriptFlags(const Consensus::Params &params,
                                         const CBlockIndex *pindex);
 
@@ -372,7 +405,8 @@ bool TestLockPointValidity(const LockPoints *lp) {
 }
 
 bool CheckSequenceLocks(const CTxMemPool &pool, const CTransaction &tx,
-                        int flags, LockPoints *lp, bool useExistingLockPoints) {
+                        int flags, LockPoints *lp, bool useExistingLockPoints,
+                        const CCoinsView *pcoinsView) {
     AssertLockHeld(cs_main);
     AssertLockHeld(pool.cs);
 
@@ -396,12 +430,13 @@ bool CheckSequenceLocks(const CTxMemPool &pool, const CTransaction &tx,
     } else {
         // pcoinsTip contains the UTXO set for chainActive.Tip()
         CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        const CCoinsView &view = pcoinsView ? *pcoinsView : viewMemPool;
         std::vector<int> prevheights;
         prevheights.resize(tx.vin.size());
         for (size_t txinIndex = 0; txinIndex < tx.vin.size(); txinIndex++) {
             const CTxIn &txin = tx.vin[txinIndex];
             Coin coin;
-            if (!viewMemPool.GetCoin(txin.prevout, coin)) {
+            if (!view.GetCoin(txin.prevout, coin)) {
                 return error("%s: Missing input", __func__);
             }
             if (coin.GetHeight() == MEMPOOL_HEIGHT) {
@@ -896,28 +931,101 @@ static UniValue ValidateTransaction(
     return transactionAssessment;
 }
 
-static bool AcceptToMemoryPoolWorker(
-    const Config &config, CTxMemPool &pool, CValidationState &state,
-    const CTransactionRef &ptx, bool fLimitFree, bool *pfMissingInputs,
-    int64_t nAcceptTime, bool fOverrideMempoolLimit, const Amount nAbsurdFee,
-    std::vector<COutPoint> &coins_to_uncache, bool test_accept)
-    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+/**
+ * Check the scripts of every input of a transaction against the given flags,
+ * or queue these checks in pvChecks. Unlike CheckInputs, this neither needs
+ * cs_main nor uses the script execution cache.
+ */
+static bool CheckInputScripts(const CTransaction &tx, CValidationState &state,
+                              const CCoinsViewCache &inputs,
+                              const uint32_t flags, bool sigCacheStore,
+                              const PrecomputedTransactionData &txdata,
+                              std::vector<CScriptCheck> *pvChecks = nullptr,
+                              SchnorrSignatureBatch *pschnorrbatch = nullptr);
+
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+namespace {
+//! Backend of the views which already hold all the coins they are asked for
+CCoinsView coinsDummy;
+
+/**
+ * A transaction on its way into the mempool. It is accepted in three steps:
+ * PreChecks under cs_main and pool.cs, ScriptChecks without any lock, so that
+ * the scripts of several transactions can be checked in parallel, and Finalize
+ * under both locks again, which checks again what may have changed in between.
+ */
+struct MemPoolAccept {
+    MemPoolAccept(const CTransactionRef &ptxIn, int64_t nAcceptTimeIn)
+        : ptx(ptxIn), nAcceptTime(nAcceptTimeIn), view(&coinsDummy) {}
+
+    const CTransactionRef ptx;
+    const int64_t nAcceptTime;
+    CValidationState state;
+    bool fMissingInputs = false;
+    std::vector<COutPoint> coins_to_uncache;
+
+    //! The coins spent by the transaction
+    CCoinsViewCache view;
+    std::unique_ptr<CTxMemPoolEntry> entry;
+    CTxMemPool::setEntries setAncestors;
+    std::unique_ptr<PrecomputedTransactionData> txdata;
+
+    //! The tip and the mempool update count PreChecks ran against
+    const CBlockIndex *pindexTip = nullptr;
+    unsigned int nTransactionsUpdated = 0;
+
+    uint32_t scriptVerifyFlags = SCRIPT_VERIFY_NONE;
+    uint32_t nextBlockScriptVerifyFlags = SCRIPT_VERIFY_NONE;
+    //! Whether the script execution cache knows the scripts to be valid
+    bool fScriptsCached = false;
+    bool fNextBlockScriptsCached = false;
+    //! Result of ScriptChecks
+    bool fScriptsValid = false;
+};
+} // namespace
+
+//! Calculate the in-mempool ancestors of entry, up to the configured limits.
+static bool CalculateAncestors(CTxMemPool &pool, const CTxMemPoolEntry &entry,
+                               CTxMemPool::setEntries &setAncestors,
+                               std::string &errString)
+    EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+    size_t nLimitAncestors =
+        gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+    size_t nLimitAncestorSize =
+        gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) * 1000;
+    size_t nLimitDescendants =
+        gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+    size_t nLimitDescendantSize =
+        gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) *
+        1000;
+    return pool.CalculateMemPoolAncestors(
+        entry, setAncestors, nLimitAncestors, nLimitAncestorSize,
+        nLimitDescendants, nLimitDescendantSize, errString);
+}
+
+/**
+ * The checks of AcceptToMemoryPool which need the chain and the mempool:
+ * everything but the scripts. The inputs are looked up in the mempool and
+ * pcoinsTip, or in pcoinsPackage if not nullptr, which may also hold the
+ * outputs of other transactions submitted together.
+ */
+static bool PreChecks(const Config &config, CTxMemPool &pool,
+                      MemPoolAccept &ws, bool fLimitFree,
+                      const Amount nAbsurdFee,
+                      CCoinsView *pcoinsPackage = nullptr)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs) {
     AssertLockHeld(cs_main);
+    AssertLockHeld(pool.cs);
 
     const Consensus::Params &consensusParams =
         config.GetChainParams().GetConsensus();
 
+    const CTransactionRef &ptx = ws.ptx;
     const CTransaction &tx = *ptx;
     const TxId txid = tx.GetId();
-
-    std::vector<std::string> errorList;
-
-    // mempool "read lock" (held through
-    // GetMainSignals().TransactionAddedToMempool())
-    LOCK(pool.cs);
-    if (pfMissingInputs) {
-        *pfMissingInputs = false;
-    }
+    CValidationState &state = ws.state;
+    CCoinsViewCache &view = ws.view;
 
     // Coinbase is only valid in a block, not as a loose transaction.
     if (!CheckRegularTransaction(tx, state)) {
@@ -959,281 +1067,391 @@ static bool AcceptToMemoryPoolWorker(
         }
     }
 
-    {
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
-
-        LockPoints lp;
-        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
-        view.SetBackend(viewMemPool);
-
-        // Do all inputs exist?
-        for (const CTxIn &txin : tx.vin) {
-            if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
-                coins_to_uncache.push_back(txin.prevout);
-            }
+    LockPoints lp;
+    CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+    view.SetBackend(pcoinsPackage ? *pcoinsPackage : viewMemPool);
 
-            if (!view.HaveCoin(txin.prevout)) {
-                // Are inputs missing because we already have the tx?
-                for (size_t out = 0; out < tx.vout.size(); out++) {
-                    // Optimistically just do efficient check of cache for
-                    // outputs.
-                    if (pcoinsTip->HaveCoinInCache(COutPoint(txid, out))) {
-                        return state.Invalid(false, REJECT_DUPLICATE,
-                                             "txn-already-known");
-                    }
+    // Do all inputs exist?
+    for (const CTxIn &txin : tx.vin) {
+        if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+            ws.coins_to_uncache.push_back(txin.prevout);
+        }
+
+        if (!view.HaveCoin(txin.prevout)) {
+            // Are inputs missing because we already have the tx?
+            for (size_t out = 0; out < tx.vout.size(); out++) {
+                // Optimistically just do efficient check of cache for
+                // outputs.
+                if (pcoinsTip->HaveCoinInCache(COutPoint(txid, out))) {
+                    view.SetBackend(coinsDummy);
+                    return state.Invalid(false, REJECT_DUPLICATE,
+                                         "txn-already-known");
                 }
+            }
 
-                // Otherwise assume this might be an orphan tx for which we just
-                // haven't seen parents yet.
-                if (pfMissingInputs) {
-                    *pfMissingInputs = true;
-                }
+            // Otherwise assume this might be an orphan tx for which we just
+            // haven't seen parents yet.
+            view.SetBackend(coinsDummy);
+            ws.fMissingInputs = true;
 
-                // fMissingInputs and !state.IsInvalid() is used to detect this
-                // condition, don't set state.Invalid()
-                return false;
-            }
+            // fMissingInputs and !state.IsInvalid() is used to detect this
+            // condition, don't set state.Invalid()
+            return false;
         }
+    }
 
-        // Are the actual inputs available?
-        if (!view.HaveInputs(tx)) {
-            return state.Invalid(false, REJECT_DUPLICATE,
-                                 "bad-txns-inputs-spent");
-        }
+    // Are the actual inputs available?
+    if (!view.HaveInputs(tx)) {
+        view.SetBackend(coinsDummy);
+        return state.Invalid(false, REJECT_DUPLICATE, "bad-txns-inputs-spent");
+    }
 
-        // Bring the best block into scope.
-        view.GetBestBlock();
+    // Bring the best block into scope.
+    view.GetBestBlock();
 
-        // We have all inputs cached now, so switch back to dummy, so we don't
-        // need to keep lock on mempool.
-        view.SetBackend(dummy);
+    // We have all inputs cached now, so switch back to dummy, so we don't
+    // need to keep lock on mempool.
+    view.SetBackend(coinsDummy);
 
-        // Only accept BIP68 sequence locked transactions that can be mined in
-        // the next block; we don't want our mempool filled up with transactions
-        // that can't be mined yet. Must keep pool.cs for this unless we change
-        // CheckSequenceLocks to take a CoinsViewCache instead of create its
-        // own.
-        if (!CheckSequenceLocks(pool, tx, STANDARD_LOCKTIME_VERIFY_FLAGS,
-                                &lp)) {
-            return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
-        }
+    // Only accept BIP68 sequence locked transactions that can be mined in
+    // the next block; we don't want our mempool filled up with transactions
+    // that can't be mined yet. Must keep pool.cs for this unless we change
+    // CheckSequenceLocks to take a CoinsViewCache instead of create its
+    // own.
+    if (!CheckSequenceLocks(pool, tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp,
+                            false, pcoinsPackage)) {
+        return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
+    }
 
-        Amount nFees = Amount::zero();
-        if (!Consensus::CheckTxInputs(tx, state, view, GetSpendHeight(view),
-                                      nFees)) {
-            return error("%s: Consensus::CheckTxInputs: %s, %s", __func__,
-                         tx.GetId().ToString(), FormatStateMessage(state));
-        }
+    Amount nFees = Amount::zero();
+    if (!Consensus::CheckTxInputs(tx, state, view, GetSpendHeight(view),
+                                  nFees)) {
+        return error("%s: Consensus::CheckTxInputs: %s, %s", __func__,
+                     tx.GetId().ToString(), FormatStateMessage(state));
+    }
 
-        // Check for non-standard pay-to-script-hash in inputs
-        if (fRequireStandard && !AreInputsStandard(tx, view)) {
-            return state.Invalid(false, REJECT_NONSTANDARD,
-                                 "bad-txns-nonstandard-inputs");
-        }
+    // Check for non-standard pay-to-script-hash in inputs
+    if (fRequireStandard && !AreInputsStandard(tx, view)) {
+        return state.Invalid(false, REJECT_NONSTANDARD,
+                             "bad-txns-nonstandard-inputs");
+    }
 
-        int64_t nSigOpsCount =
-            GetTransactionSigOpCount(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
+    int64_t nSigOpsCount =
+        GetTransactionSigOpCount(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
 
-        // nModifiedFees includes any fee deltas from PrioritiseTransaction
-        Amount nModifiedFees = nFees;
-        double nPriorityDummy = 0;
-        pool.ApplyDeltas(txid, nPriorityDummy, nModifiedFees);
+    // nModifiedFees includes any fee deltas from PrioritiseTransaction
+    Amount nModifiedFees = nFees;
+    double nPriorityDummy = 0;
+    pool.ApplyDeltas(txid, nPriorityDummy, nModifiedFees);
 
-        Amount inChainInputValue;
-        double dPriority =
-            view.GetPriority(tx, chainActive.Height(), inChainInputValue);
+    Amount inChainInputValue;
+    double dPriority =
+        view.GetPriority(tx, chainActive.Height(), inChainInputValue);
 
-        // Keep track of transactions that spend a coinbase, which we re-scan
-        // during reorgs to ensure COINBASE_MATURITY is still met.
-        bool fSpendsCoinbase = false;
-        for (const CTxIn &txin : tx.vin) {
-            const Coin &coin = view.AccessCoin(txin.prevout);
-            if (coin.IsCoinBase()) {
-                fSpendsCoinbase = true;
-                break;
-            }
+    // Keep track of transactions that spend a coinbase, which we re-scan
+    // during reorgs to ensure COINBASE_MATURITY is still met.
+    bool fSpendsCoinbase = false;
+    for (const CTxIn &txin : tx.vin) {
+        const Coin &coin = view.AccessCoin(txin.prevout);
+        if (coin.IsCoinBase()) {
+            fSpendsCoinbase = true;
+            break;
         }
+    }
 
-        CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, dPriority,
-                              chainActive.Height(), inChainInputValue,
-                              fSpendsCoinbase, nSigOpsCount, lp);
-        unsigned int nSize = entry.GetTxSize();
+    ws.entry = std::make_unique<CTxMemPoolEntry>(
+        ptx, nFees, ws.nAcceptTime, dPriority, chainActive.Height(),
+        inChainInputValue, fSpendsCoinbase, nSigOpsCount, lp);
+    const CTxMemPoolEntry &entry = *ws.entry;
+    unsigned int nSize = entry.GetTxSize();
 
-        // Check that the transaction doesn't have an excessive number of
-        // sigops, making it impossible to mine. Since the coinbase transaction
-        // itself can contain sigops MAX_STANDARD_TX_SIGOPS is less than
-        // MAX_BLOCK_SIGOPS_PER_MB; we still consider this an invalid rather
-        // than merely non-standard transaction.
-        if (nSigOpsCount > MAX_STANDARD_TX_SIGOPS) {
-            return state.DoS(0, false, REJECT_NONSTANDARD,
-                             "bad-txns-too-many-sigops", false,
-                             strprintf("%d", nSigOpsCount));
-        }
+    // Check that the transaction doesn't have an excessive number of
+    // sigops, making it impossible to mine. Since the coinbase transaction
+    // itself can contain sigops MAX_STANDARD_TX_SIGOPS is less than
+    // MAX_BLOCK_SIGOPS_PER_MB; we still consider this an invalid rather
+    // than merely non-standard transaction.
+    if (nSigOpsCount > MAX_STANDARD_TX_SIGOPS) {
+        return state.DoS(0, false, REJECT_NONSTANDARD,
+                         "bad-txns-too-many-sigops", false,
+                         strprintf("%d", nSigOpsCount));
+    }
 
-        Amount mempoolRejectFee =
-            pool.GetMinFee(
-                    gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) *
-                    1000000)
-                .GetFee(nSize);
-        if (mempoolRejectFee > Amount::zero() &&
-            nModifiedFees < mempoolRejectFee) {
-            return state.DoS(
-                0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met",
-                false, strprintf("%d < %d", nModifiedFees, mempoolRejectFee));
+    Amount mempoolRejectFee =
+        pool.GetMinFee(gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) *
+                       1000000)
+            .GetFee(nSize);
+    if (mempoolRejectFee > Amount::zero() &&
+        nModifiedFees < mempoolRejectFee) {
+        return state.DoS(
+            0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met", false,
+            strprintf("%d < %d", nModifiedFees, mempoolRejectFee));
+    }
+
+    if (gArgs.GetBoolArg("-relaypriority", DEFAULT_RELAYPRIORITY) &&
+        nModifiedFees < minRelayTxFee.GetFee(nSize) &&
+        !AllowFree(entry.GetPriority(chainActive.Height() + 1))) {
+        // Require that free transactions have sufficient priority to be
+        // mined in the next block.
+        return state.DoS(0, false, REJECT_INSUFFICIENTFEE,
+                         "insufficient priority");
+    }
+
+    // Continuously rate-limit free (really, very-low-fee) transactions.
+    // This mitigates 'penny-flooding' -- sending thousands of free
+    // transactions just to be annoying or make others' transactions take
+    // longer to confirm.
+    if (fLimitFree && nModifiedFees < minRelayTxFee.GetFee(nSize)) {
+        static CCriticalSection csFreeLimiter;
+        static double dFreeCount;
+        static int64_t nLastTime;
+        int64_t nNow = GetTime();
+
+        LOCK(csFreeLimiter);
+
+        // Use an exponentially decaying ~10-minute window:
+        dFreeCount *= pow(1.0 - 1.0 / 600.0, double(nNow - nLastTime));
+        nLastTime = nNow;
+        // -limitfreerelay unit is thousand-bytes-per-minute
+        // At default rate it would take over a month to fill 1GB
+
+        // NOTE: Use the actual size here, and not the fee size since this
+        // is counting real size for the rate limiter.
+        if (dFreeCount + nSize >=
+            gArgs.GetArg("-limitfreerelay", DEFAULT_LIMITFREERELAY) * 10 *
+                1000) {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE,
+                             "rate limited free transaction");
         }
 
-        if (gArgs.GetBoolArg("-relaypriority", DEFAULT_RELAYPRIORITY) &&
-            nModifiedFees < minRelayTxFee.GetFee(nSize) &&
-            !AllowFree(entry.GetPriority(chainActive.Height() + 1))) {
-            // Require that free transactions have sufficient priority to be
-            // mined in the next block.
-            return state.DoS(0, false, REJECT_INSUFFICIENTFEE,
-                             "insufficient priority");
-        }
-
-        // Continuously rate-limit free (really, very-low-fee) transactions.
-        // This mitigates 'penny-flooding' -- sending thousands of free
-        // transactions just to be annoying or make others' transactions take
-        // longer to confirm.
-        if (fLimitFree && nModifiedFees < minRelayTxFee.GetFee(nSize)) {
-            static CCriticalSection csFreeLimiter;
-            static double dFreeCount;
-            static int64_t nLastTime;
-            int64_t nNow = GetTime();
-
-            LOCK(csFreeLimiter);
-
-            // Use an exponentially decaying ~10-minute window:
-            dFreeCount *= pow(1.0 - 1.0 / 600.0, double(nNow - nLastTime));
-            nLastTime = nNow;
-            // -limitfreerelay unit is thousand-bytes-per-minute
-            // At default rate it would take over a month to fill 1GB
-
-            // NOTE: Use the actual size here, and not the fee size since this
-            // is counting real size for the rate limiter.
-            if (dFreeCount + nSize >=
-                gArgs.GetArg("-limitfreerelay", DEFAULT_LIMITFREERELAY) * 10 *
-                    1000) {
-                return state.DoS(0, false, REJECT_INSUFFICIENTFEE,
-                                 "rate limited free transaction");
-            }
+        LogPrint(BCLog::MEMPOOL, "Rate limit dFreeCount: %g => %g\n",
+                 dFreeCount, dFreeCount + nSize);
+        dFreeCount += nSize;
+    }
 
-            LogPrint(BCLog::MEMPOOL, "Rate limit dFreeCount: %g => %g\n",
-                     dFreeCount, dFreeCount + nSize);
-            dFreeCount += nSize;
-        }
-
-        if (nAbsurdFee != Amount::zero() && nFees > nAbsurdFee) {
-            return state.Invalid(false, REJECT_HIGHFEE, "absurdly-high-fee",
-                                 strprintf("%d > %d", nFees, nAbsurdFee));
-        }
-
-        // Calculate in-mempool ancestors, up to a limit.
-        CTxMemPool::setEntries setAncestors;
-        size_t nLimitAncestors =
-            gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
-        size_t nLimitAncestorSize =
-            gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) *
-            1000;
-        size_t nLimitDescendants =
-            gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
-        size_t nLimitDescendantSize =
-            gArgs.GetArg("-limitdescendantsize",
-                         DEFAULT_DESCENDANT_SIZE_LIMIT) *
-            1000;
-        std::string errString;
-        if (!pool.CalculateMemPoolAncestors(
-                entry, setAncestors, nLimitAncestors, nLimitAncestorSize,
-                nLimitDescendants, nLimitDescendantSize, errString)) {
-            return state.DoS(0, false, REJECT_NONSTANDARD,
+    if (nAbsurdFee != Amount::zero() && nFees > nAbsurdFee) {
+        return state.Invalid(false, REJECT_HIGHFEE, "absurdly-high-fee",
+                             strprintf("%d > %d", nFees, nAbsurdFee));
+    }
+
+    // Calculate in-mempool ancestors, up to a limit.
+    std::string errString;
+    if (!CalculateAncestors(pool, entry, ws.setAncestors, errString)) {
+        return state.DoS(0, false, REJECT_NONSTANDARD,
                          "too-long-mempool-chain", false, errString);
-        }
+    }
 
-        // Set extraFlags as a set of flags that needs to be activated.
-        uint32_t extraFlags = SCRIPT_VERIFY_NONE;
-        if (IsReplayProtectionEnabledForCurrentBlock(consensusParams)) {
-            extraFlags |= SCRIPT_ENABLE_REPLAY_PROTECTION;
-        }
+    // Set extraFlags as a set of flags that needs to be activated.
+    uint32_t extraFlags = SCRIPT_VERIFY_NONE;
+    if (IsReplayProtectionEnabledForCurrentBlock(consensusParams)) {
+        extraFlags |= SCRIPT_ENABLE_REPLAY_PROTECTION;
+    }
 
-        if (IsMagneticAnomalyEnabledForCurrentBlock(consensusParams)) {
-            extraFlags |= SCRIPT_VERIFY_CHECKDATASIG_SIGOPS;
-        }
+    if (IsMagneticAnomalyEnabledForCurrentBlock(consensusParams)) {
+        extraFlags |= SCRIPT_VERIFY_CHECKDATASIG_SIGOPS;
+    }
 
-        if (IsGravitonEnabledForCurrentBlock(consensusParams)) {
-            extraFlags |= SCRIPT_ENABLE_SCHNORR_MULTISIG;
-            extraFlags |= SCRIPT_VERIFY_MINIMALDATA;
-        }
+    if (IsGravitonEnabledForCurrentBlock(consensusParams)) {
+        extraFlags |= SCRIPT_ENABLE_SCHNORR_MULTISIG;
+        extraFlags |= SCRIPT_VERIFY_MINIMALDATA;
+    }
 
-        // Make sure whatever we need to activate is actually activated.
-        const uint32_t scriptVerifyFlags =
-            STANDARD_SCRIPT_VERIFY_FLAGS | extraFlags;
+    // Make sure whatever we need to activate is actually activated.
+    ws.scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS | extraFlags;
+    ws.nextBlockScriptVerifyFlags =
+        GetNextBlockScriptFlags(consensusParams, chainActive.Tip());
 
-        // Check against previous transactions. This is done last to help
-        // prevent CPU exhaustion denial-of-service attacks.
-        PrecomputedTransactionData txdata(tx);
-        if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false,
-                         txdata)) {
-            // State filled in by CheckInputs.
-            return false;
-        }
+    // The script execution cache needs cs_main, so look the scripts up now,
+    // the same way CheckInputs does.
+    ws.fScriptsCached = IsKeyInScriptCache(
+        GetScriptCacheKey(tx, ws.scriptVerifyFlags), true);
+    ws.fNextBlockScriptsCached = IsKeyInScriptCache(
+        GetScriptCacheKey(tx, ws.nextBlockScriptVerifyFlags), false);
+    ws.txdata = std::make_unique<PrecomputedTransactionData>(tx);
 
-        // Check again against the next block's script verification flags
-        // to cache our script execution flags.
-        //
-        // This is also useful in case of bugs in the standard flags that cause
-        // transactions to pass as valid when they're actually invalid. For
-        // instance the STRICTENC flag was incorrectly allowing certain CHECKSIG
-        // NOT scripts to pass, even though they were invalid.
-        //
-        // There is a similar check in CreateNewBlock() to prevent creating
-        // invalid blocks (using TestBlockValidity), however allowing such
-        // transactions into the mempool can be exploited as a DoS attack.
-        uint32_t nextBlockScriptVerifyFlags =
-            GetNextBlockScriptFlags(consensusParams, chainActive.Tip());
+    ws.pindexTip = chainActive.Tip();
+    ws.nTransactionsUpdated = pool.GetTransactionsUpdated();
+    return true;
+}
 
-        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool,
-                                            nextBlockScriptVerifyFlags, true,
-                                            txdata)) {
-            return error("%s: BUG! PLEASE REPORT THIS! CheckInputs failed "
-                         "against next-block but not STANDARD flags %s, %s",
-                         __func__, txid.ToString(), FormatStateMessage(state));
-        }
+/**
+ * Check the scripts of a transaction which passed PreChecks. This needs no
+ * lock, as the coins it spends are in the workspace, and only uses the
+ * signature cache, which is thread safe.
+ */
+static bool ScriptChecks(MemPoolAccept &ws) {
+    const CTransaction &tx = *ws.ptx;
+
+    // Check against previous transactions. This is done last to help
+    // prevent CPU exhaustion denial-of-service attacks.
+    if (!ws.fScriptsCached &&
+        !CheckInputScripts(tx, ws.state, ws.view, ws.scriptVerifyFlags, true,
+                           *ws.txdata)) {
+        // State filled in by CheckInputScripts.
+        return false;
+    }
 
-        if (test_accept) {
-            // Tx was accepted, but not added
-            return true;
+    // Check again against the next block's script verification flags
+    // to cache our script execution flags.
+    //
+    // This is also useful in case of bugs in the standard flags that cause
+    // transactions to pass as valid when they're actually invalid. For
+    // instance the STRICTENC flag was incorrectly allowing certain CHECKSIG
+    // NOT scripts to pass, even though they were invalid.
+    //
+    // There is a similar check in CreateNewBlock() to prevent creating
+    // invalid blocks (using TestBlockValidity), however allowing such
+    // transactions into the mempool can be exploited as a DoS attack.
+    if (!ws.fNextBlockScriptsCached &&
+        !CheckInputScripts(tx, ws.state, ws.view,
+                           ws.nextBlockScriptVerifyFlags, true, *ws.txdata)) {
+        return error("%s: BUG! PLEASE REPORT THIS! CheckInputs failed "
+                     "against next-block but not STANDARD flags %s, %s",
+                     __func__, tx.GetId().ToString(),
+                     FormatStateMessage(ws.state));
+    }
+
+    return true;
+}
+
+/**
+ * Queue the script checks ScriptChecks would run, so that they can be run by
+ * the script check threads. Whether they passed only tells whether all the
+ * checks of the queue did: ScriptChecks tells which transactions failed.
+ */
+static void QueueScriptChecks(MemPoolAccept &ws,
+                              std::vector<CScriptCheck> &vChecks) {
+    const CTransaction &tx = *ws.ptx;
+    if (!ws.fScriptsCached) {
+        CheckInputScripts(tx, ws.state, ws.view, ws.scriptVerifyFlags, true,
+                          *ws.txdata, &vChecks);
+    }
+    if (!ws.fNextBlockScriptsCached) {
+        CheckInputScripts(tx, ws.state, ws.view,
+                          ws.nextBlockScriptVerifyFlags, true, *ws.txdata,
+                          &vChecks);
+    }
+}
+
+/**
+ * Add a transaction which passed ScriptChecks to the mempool. If the mempool
+ * changed since PreChecks, whatever it may have invalidated is checked again:
+ * conflicts, inputs, lock points and ancestors. The tip must not have changed.
+ */
+static bool Finalize(CTxMemPool &pool, MemPoolAccept &ws,
+                     bool fOverrideMempoolLimit, bool test_accept)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs) {
+    AssertLockHeld(cs_main);
+    AssertLockHeld(pool.cs);
+    assert(chainActive.Tip() == ws.pindexTip);
+
+    const CTransaction &tx = *ws.ptx;
+    const TxId txid = tx.GetId();
+    CValidationState &state = ws.state;
+
+    if (pool.GetTransactionsUpdated() != ws.nTransactionsUpdated) {
+        if (pool.exists(txid)) {
+            return state.Invalid(false, REJECT_DUPLICATE,
+                                 "txn-already-in-mempool");
         }
 
-        // Store transaction in memory.
-        pool.addUnchecked(txid, entry, setAncestors);
+        for (const CTxIn &txin : tx.vin) {
+            if (pool.mapNextTx.count(txin.prevout)) {
+                return state.Invalid(false, REJECT_DUPLICATE,
+                                     "txn-mempool-conflict");
+            }
+            // The chain did not change, so only the mempool can have lost an
+            // input, as PreChecks would have found it missing.
+            if (!pool.exists(txin.prevout.GetTxId()) &&
+                !pcoinsTip->HaveCoin(txin.prevout)) {
+                ws.fMissingInputs = true;
+                return false;
+            }
+        }
 
-        // Add memory address index
-        if (g_addressindex) {
-            pool.addAddressIndex(entry, view);
+        LockPoints lp;
+        if (!CheckSequenceLocks(pool, tx, STANDARD_LOCKTIME_VERIFY_FLAGS,
+                                &lp)) {
+            return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
         }
+        ws.entry->UpdateLockPoints(lp);
 
-        // Add memory spent index
-        if (g_spentindex) {
-            pool.addSpentIndex(entry, view);
+        ws.setAncestors.clear();
+        std::string errString;
+        if (!CalculateAncestors(pool, *ws.entry, ws.setAncestors, errString)) {
+            return state.DoS(0, false, REJECT_NONSTANDARD,
+                             "too-long-mempool-chain", false, errString);
         }
+    }
 
-        // Trim mempool and check if tx was trimmed.
-        if (!fOverrideMempoolLimit) {
-            pool.LimitSize(
-                gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000,
-                gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 *
-                    60);
-            if (!pool.exists(txid)) {
-                return state.DoS(0, false, REJECT_INSUFFICIENTFEE,
-                                 "mempool full");
-            }
+    // Remember the scripts are valid under the flags of the next block, as
+    // CheckInputs does once it ran them.
+    if (!ws.fNextBlockScriptsCached) {
+        AddKeyInScriptCache(
+            GetScriptCacheKey(tx, ws.nextBlockScriptVerifyFlags));
+    }
+
+    if (test_accept) {
+        // Tx was accepted, but not added
+        return true;
+    }
+
+    // Store transaction in memory.
+    pool.addUnchecked(txid, *ws.entry, ws.setAncestors);
+
+    // Add memory address index
+    if (g_addressindex) {
+        pool.addAddressIndex(*ws.entry, ws.view);
+    }
+
+    // Add memory spent index
+    if (g_spentindex) {
+        pool.addSpentIndex(*ws.entry, ws.view);
+    }
+
+    // Trim mempool and check if tx was trimmed.
+    if (!fOverrideMempoolLimit) {
+        pool.LimitSize(
+            gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000,
+            gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        if (!pool.exists(txid)) {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
         }
     }
-    GetMainSignals().TransactionAddedToMempool(ptx);
     return true;
 }
 
+static bool AcceptToMemoryPoolWorker(
+    const Config &config, CTxMemPool &pool, CValidationState &state,
+    const CTransactionRef &ptx, bool fLimitFree, bool *pfMissingInputs,
+    int64_t nAcceptTime, bool fOverrideMempoolLimit, const Amount nAbsurdFee,
+    std::vector<COutPoint> &coins_to_uncache, bool test_accept)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+    AssertLockHeld(cs_main);
+
+    // mempool "read lock" (held through
+    // GetMainSignals().TransactionAddedToMempool())
+    LOCK(pool.cs);
+
+    MemPoolAccept ws(ptx, nAcceptTime);
+    const bool fAccepted =
+        PreChecks(config, pool, ws, fLimitFree, nAbsurdFee) &&
+        ScriptChecks(ws) &&
+        Finalize(pool, ws, fOverrideMempoolLimit, test_accept);
+
+    state = ws.state;
+    if (pfMissingInputs) {
+        *pfMissingInputs = ws.fMissingInputs;
+    }
+    coins_to_uncache.insert(coins_to_uncache.end(),
+                            ws.coins_to_uncache.begin(),
+                            ws.coins_to_uncache.end());
+
+    if (fAccepted && !test_accept) {
+        GetMainSignals().TransactionAddedToMempool(ptx);
+    }
+    return fAccepted;
+}
+
 /**
  * (try to) add transaction to memory pool with a specified acceptance time.
  */
@@ -1296,6 +1514,209 @@ bool AcceptToMemoryPool(const Config &config, CTxMemPool &pool,
         fOverrideMempoolLimit, nAbsurdFee, test_accept);
 }
 
+/**
+ * Sort a batch of transactions so that every one of them comes after the
+ * transactions of the batch it spends, keeping the order of the others.
+ */
+static std::vector<size_t>
+SortTopologically(const std::vector<CTransactionRef> &txs,
+                  const std::map<TxId, size_t> &mapBatch) {
+    std::vector<size_t> vOrder;
+    vOrder.reserve(txs.size());
+    std::vector<bool> vVisited(txs.size(), false);
+    // Depth first, with the transactions still to be placed and the next of
+    // their inputs to look at.
+    std::vector<std::pair<size_t, size_t>> vStack;
+    for (size_t i = 0; i < txs.size(); i++) {
+        if (vVisited[i]) {
+            continue;
+        }
+        vVisited[i] = true;
+        vStack.emplace_back(i, 0);
+        while (!vStack.empty()) {
+            const size_t j = vStack.back().first;
+            const size_t nIn = vStack.back().second++;
+            if (nIn == txs[j]->vin.size()) {
+                vOrder.push_back(j);
+                vStack.pop_back();
+                continue;
+            }
+            auto it = mapBatch.find(txs[j]->vin[nIn].prevout.GetTxId());
+            if (it != mapBatch.end() && !vVisited[it->second]) {
+                vVisited[it->second] = true;
+                vStack.emplace_back(it->second, 0);
+            }
+        }
+    }
+    return vOrder;
+}
+
+static size_t AcceptBatchWorker(const Config &config, CTxMemPool &pool,
+                                const std::vector<CTransactionRef> &txs,
+                                std::vector<bool> &vAccepted,
+                                std::vector<CValidationState> &states,
+                                std::vector<bool> &vMissingInputs,
+                                bool fLimitFree, const Amount nAbsurdFee,
+                                bool test_accept) {
+    const int64_t nAcceptTime = GetTime();
+    vAccepted.assign(txs.size(), false);
+    states.assign(txs.size(), CValidationState());
+    vMissingInputs.assign(txs.size(), false);
+
+    std::map<TxId, size_t> mapBatch;
+    for (size_t i = 0; i < txs.size(); i++) {
+        mapBatch.emplace(txs[i]->GetId(), i);
+    }
+    const std::vector<size_t> vOrder = SortTopologically(txs, mapBatch);
+    std::vector<std::unique_ptr<MemPoolAccept>> vws(txs.size());
+
+    // Record the result of the transaction txs[i].
+    auto done = [&](size_t i, bool fAccepted) {
+        const MemPoolAccept &ws = *vws[i];
+        vAccepted[i] = fAccepted;
+        states[i] = ws.state;
+        vMissingInputs[i] = ws.fMissingInputs;
+        if (!fAccepted) {
+            for (const COutPoint &outpoint : ws.coins_to_uncache) {
+                pcoinsTip->Uncache(outpoint);
+            }
+            vws[i].reset();
+        }
+    };
+
+    {
+        LOCK2(cs_main, pool.cs);
+        // The coins of the mempool and the chain, and those created by the
+        // transactions of the batch which passed PreChecks so far.
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        CCoinsViewCache viewPackage(&viewMemPool);
+        std::set<COutPoint> setSpent;
+
+        for (const size_t i : vOrder) {
+            const CTransaction &tx = *txs[i];
+            vws[i] = std::make_unique<MemPoolAccept>(txs[i], nAcceptTime);
+            MemPoolAccept &ws = *vws[i];
+
+            bool fConflict = false;
+            for (const CTxIn &txin : tx.vin) {
+                fConflict |= setSpent.count(txin.prevout) > 0;
+            }
+            if (fConflict) {
+                ws.state.Invalid(false, REJECT_DUPLICATE,
+                                 "txn-mempool-conflict");
+                done(i, false);
+                continue;
+            }
+
+            if (!PreChecks(config, pool, ws, fLimitFree, nAbsurdFee,
+                           &viewPackage)) {
+                done(i, false);
+                continue;
+            }
+            for (const CTxIn &txin : tx.vin) {
+                setSpent.insert(txin.prevout);
+            }
+            AddCoins(viewPackage, tx, MEMPOOL_HEIGHT, true);
+        }
+    }
+
+    // Check the scripts on the script check threads if there are any. Should
+    // any of them fail, check the transactions one by one to tell which: the
+    // signatures which passed are in the signature cache by then.
+    bool fAllValid = false;
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        std::vector<CScriptCheck> vChecks;
+        for (const std::unique_ptr<MemPoolAccept> &ws : vws) {
+            if (ws) {
+                QueueScriptChecks(*ws, vChecks);
+            }
+        }
+        control.Add(vChecks);
+        fAllValid = control.Wait();
+    }
+    for (const std::unique_ptr<MemPoolAccept> &ws : vws) {
+        if (ws) {
+            ws->fScriptsValid = fAllValid || ScriptChecks(*ws);
+        }
+    }
+
+    LOCK2(cs_main, pool.cs);
+    std::set<TxId> setAccepted;
+    std::vector<CTransactionRef> vAdded;
+    for (const size_t i : vOrder) {
+        if (!vws[i]) {
+            continue;
+        }
+
+        if (chainActive.Tip() != vws[i]->pindexTip) {
+            // The coins spent may have changed with the tip: check the
+            // transaction again from scratch.
+            done(i, false);
+            vws[i] = std::make_unique<MemPoolAccept>(txs[i], nAcceptTime);
+            vws[i]->fScriptsValid =
+                PreChecks(config, pool, *vws[i], fLimitFree, nAbsurdFee) &&
+                ScriptChecks(*vws[i]);
+        }
+        MemPoolAccept &ws = *vws[i];
+
+        // The outputs of the transactions of the batch which were rejected
+        // are missing.
+        for (const CTxIn &txin : txs[i]->vin) {
+            const TxId &prevId = txin.prevout.GetTxId();
+            if (mapBatch.count(prevId) && !setAccepted.count(prevId) &&
+                !pool.exists(prevId)) {
+                ws.fMissingInputs = true;
+                ws.fScriptsValid = false;
+            }
+        }
+
+        const bool fAccepted =
+            ws.fScriptsValid && Finalize(pool, ws, false, test_accept);
+        done(i, fAccepted);
+        if (fAccepted) {
+            setAccepted.insert(txs[i]->GetId());
+            vAdded.push_back(txs[i]);
+        }
+    }
+
+    if (!test_accept) {
+        for (const CTransactionRef &ptx : vAdded) {
+            GetMainSignals().TransactionAddedToMempool(ptx);
+        }
+    }
+    return vAdded.size();
+}
+
+size_t AcceptToMemoryPoolBatch(const Config &config, CTxMemPool &pool,
+                               const std::vector<CTransactionRef> &txs,
+                               std::vector<bool> &vAccepted,
+                               std::vector<CValidationState> &states,
+                               std::vector<bool> &vMissingInputs,
+                               bool fLimitFree, const Amount nAbsurdFee,
+                               bool test_accept) {
+    size_t nAccepted;
+    if (test_accept) {
+        // Nothing is added to the mempool, so hold the locks all along for
+        // the transactions to be checked against the same mempool and tip.
+        LOCK2(cs_main, pool.cs);
+        nAccepted = AcceptBatchWorker(config, pool, txs, vAccepted, states,
+                                      vMissingInputs, fLimitFree, nAbsurdFee,
+                                      test_accept);
+    } else {
+        nAccepted = AcceptBatchWorker(config, pool, txs, vAccepted, states,
+                                      vMissingInputs, fLimitFree, nAbsurdFee,
+                                      test_accept);
+    }
+
+    // After we've (potentially) uncached entries, ensure our coins cache is
+    // still within its size limits
+    CValidationState stateDummy;
+    FlushStateToDisk(config.GetChainParams(), stateDummy,
+                     FlushStateMode::PERIODIC);
+    return nAccepted;
+}
+
 UniValue VerifyTransactionWithMemoryPool(
 	const Config &config, CTxMemPool &pool,
 	CValidationState &state, const CTransactionRef &tx,
@@ -1460,23 +1881,132 @@ static bool WriteBlockToDisk(const CBlock &block, FlatFilePos &pos,
     return true;
 }
 
+//! Number of block files kept memory mapped for reading blocks
+static const size_t MAX_MAPPED_BLOCK_FILES = 8;
+
+namespace {
+/**
+ * Memory mappings of the most recently read block files. Reading a block from
+ * a mapped file needs no open, seek and buffered copy, and the serialized
+ * block can be handed out without being deserialized.
+ */
+class BlockFileMappings {
+private:
+    Mutex cs;
+    //! Mappings by file number, most recently used first.
+    std::list<std::pair<int, std::shared_ptr<const FlatFileMapping>>>
+        mappings GUARDED_BY(cs);
+
+public:
+    /**
+     * Get a mapping of the given block file which covers at least nMinSize
+     * bytes, mapping the file again if it grew since it was mapped.
+     */
+    std::shared_ptr<const FlatFileMapping> Get(int nFile, size_t nMinSize) {
+        LOCK(cs);
+        for (auto it = mappings.begin(); it != mappings.end(); ++it) {
+            if (it->first != nFile) {
+                continue;
+            }
+            if (it->second->size() >= nMinSize) {
+                mappings.splice(mappings.begin(), mappings, it);
+                return it->second;
+            }
+            mappings.erase(it);
+            break;
+        }
+
+        std::shared_ptr<const FlatFileMapping> mapping =
+            BlockFileSeq().Map(FlatFilePos(nFile, 0));
+        if (!mapping || mapping->size() < nMinSize) {
+            return nullptr;
+        }
+        mappings.emplace_front(nFile, mapping);
+        if (mappings.size() > MAX_MAPPED_BLOCK_FILES) {
+            mappings.pop_back();
+        }
+        return mapping;
+    }
+
+    //! Drop the mapping of a block file, e.g. because it is being deleted.
+    void Erase(int nFile) {
+        LOCK(cs);
+        mappings.remove_if(
+            [nFile](const std::pair<int, std::shared_ptr<const FlatFileMapping>>
+                        &entry) { return entry.first == nFile; });
+    }
+
+    //! Drop all mappings, e.g. because the block files are being unloaded.
+    void Clear() {
+        LOCK(cs);
+        mappings.clear();
+    }
+};
+
+BlockFileMappings blockFileMappings;
+} // namespace
+
+//! Size of the message start and block size which precede blocks on disk.
+static const unsigned int BLOCK_FILE_PREFIX_SIZE =
+    CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+//! Size of a serialized block header
+static const size_t BLOCK_HEADER_SIZE = 80;
+
+/**
+ * Locate the serialized block at the given position in its memory mapped
+ * block file. The span is valid as long as the mapping is held.
+ */
+static bool MapBlockFromDisk(std::shared_ptr<const FlatFileMapping> &mapping,
+                             Span<const uint8_t> &span,
+                             const FlatFilePos &pos) {
+    if (pos.IsNull() || pos.nPos < BLOCK_FILE_PREFIX_SIZE) {
+        return false;
+    }
+    mapping = blockFileMappings.Get(pos.nFile, pos.nPos);
+    if (!mapping) {
+        return false;
+    }
+
+    const uint32_t nSize = ReadLE32(mapping->data() + pos.nPos - sizeof(uint32_t));
+    const size_t nEnd = size_t(pos.nPos) + nSize;
+    if (nEnd > mapping->size()) {
+        mapping = blockFileMappings.Get(pos.nFile, nEnd);
+        if (!mapping) {
+            return false;
+        }
+    }
+    span = Span<const uint8_t>(mapping->data() + pos.nPos, nSize);
+    return true;
+}
+
 bool ReadBlockFromDisk(CBlock &block, const FlatFilePos &pos,
                        const Consensus::Params &params) {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s",
-                     pos.ToString());
-    }
+    std::shared_ptr<const FlatFileMapping> mapping;
+    Span<const uint8_t> span;
+    if (MapBlockFromDisk(mapping, span, pos)) {
+        try {
+            SpanReader(SER_DISK, CLIENT_VERSION, span) >> block;
+        } catch (const std::exception &e) {
+            return error("%s: Deserialize error - %s at %s", __func__,
+                         e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s",
+                         pos.ToString());
+        }
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception &e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__,
-                     e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        } catch (const std::exception &e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__,
+                         e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1506,7 +2036,197 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex,
                      pindex->ToString(), pindex->GetBlockPos().ToString());
     }
 
-    return true;
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<uint8_t> &block,
+                          const CBlockIndex *pindex,
+                          const CChainParams &chainparams) {
+    FlatFilePos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+
+    std::shared_ptr<const FlatFileMapping> mapping;
+    Span<const uint8_t> span;
+    if (MapBlockFromDisk(mapping, span, blockPos)) {
+        block.assign(span.data(), span.data() + span.size());
+    } else {
+        if (blockPos.IsNull() || blockPos.nPos < BLOCK_FILE_PREFIX_SIZE) {
+            return error("%s: Invalid block position %s", __func__,
+                         blockPos.ToString());
+        }
+        FlatFilePos headerPos(blockPos.nFile,
+                              blockPos.nPos - BLOCK_FILE_PREFIX_SIZE);
+        CAutoFile filein(OpenBlockFile(headerPos, true), SER_DISK,
+                         CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("%s: OpenBlockFile failed for %s", __func__,
+                         blockPos.ToString());
+        }
+
+        try {
+            CMessageHeader::MessageMagic messageStart;
+            uint32_t nSize;
+            filein >> messageStart >> nSize;
+            if (messageStart != chainparams.DiskMagic()) {
+                return error("%s: Block magic mismatch for %s", __func__,
+                             blockPos.ToString());
+            }
+            if (nSize > MAX_SIZE) {
+                return error("%s: Block data is larger than maximum "
+                             "deserialization size for %s",
+                             __func__, blockPos.ToString());
+            }
+            block.resize(nSize);
+            filein.read(reinterpret_cast<char *>(block.data()), nSize);
+        } catch (const std::exception &e) {
+            return error("%s: Read from block file failed - %s at %s",
+                         __func__, e.what(), blockPos.ToString());
+        }
+    }
+
+    // The header commits to the rest of the block, so checking its hash is
+    // enough to know that this is the block we expect.
+    if (block.size() < BLOCK_HEADER_SIZE ||
+        Hash(block.begin(), block.begin() + BLOCK_HEADER_SIZE) !=
+            pindex->GetBlockHash()) {
+        return error("%s: Block hash doesn't match index for %s at %s",
+                     __func__, pindex->ToString(), blockPos.ToString());
+    }
+
+    return true;
+}
+
+//! Number of block files a scan keeps in the page cache
+static const size_t READAHEAD_FILES_KEPT = 2;
+//! Bytes hinted for a block or its undo data when their size is not known
+static const size_t READAHEAD_UNKNOWN_SIZE = 1 << 20;
+
+/**
+ * Number of bytes to hint from pos, which are followed by posNext on the
+ * chain. Blocks are mostly stored in height order, so the data of a block
+ * usually ends where the data of the next one starts.
+ */
+static size_t ReadaheadLength(const FlatFilePos &pos,
+                              const FlatFilePos &posNext) {
+    if (posNext.nFile == pos.nFile && posNext.nPos > pos.nPos &&
+        posNext.nPos - pos.nPos <= DEFAULT_MAX_BLOCK_SIZE) {
+        return posNext.nPos - pos.nPos;
+    }
+    return READAHEAD_UNKNOWN_SIZE;
+}
+
+BlockFileReadahead::BlockFileReadahead(const CBlockIndex *pindexEndIn,
+                                       bool fUndoIn)
+    : pindexEnd(pindexEndIn), fUndo(fUndoIn),
+      nBlocks(std::max<int64_t>(
+          gArgs.GetArg("-blockreadahead", DEFAULT_BLOCK_READAHEAD), 0)) {}
+
+const CBlockIndex *BlockFileReadahead::BlockAt(const CBlockIndex *pindex,
+                                               int nHeight) const {
+    AssertLockHeld(cs_main);
+    if (fBackward) {
+        if (nHeight < pindexEnd->nHeight || nHeight > pindex->nHeight) {
+            return nullptr;
+        }
+        return pindex->GetAncestor(nHeight);
+    }
+    if (pindexEnd) {
+        return nHeight <= pindexEnd->nHeight ? pindexEnd->GetAncestor(nHeight)
+                                             : nullptr;
+    }
+    return chainActive[nHeight];
+}
+
+void BlockFileReadahead::Read(const CBlockIndex *pindex) {
+    if (nBlocks == 0) {
+        return;
+    }
+
+    std::vector<std::pair<FlatFilePos, size_t>> vBlockRanges;
+    std::vector<std::pair<FlatFilePos, size_t>> vUndoRanges;
+    int nFileDrop = -1;
+    {
+        LOCK(cs_main);
+        if (nHeightHinted < 0) {
+            fBackward = pindexEnd && pindexEnd->nHeight < pindex->nHeight;
+            nHeightHinted = pindex->nHeight;
+        }
+
+        // Keep the files read last, most recent last, and drop the one the
+        // scan left behind.
+        const int nFile = pindex->nFile;
+        auto it = std::find(vFilesRead.begin(), vFilesRead.end(), nFile);
+        if (it != vFilesRead.end()) {
+            vFilesRead.erase(it);
+        }
+        vFilesRead.push_back(nFile);
+        if (vFilesRead.size() > READAHEAD_FILES_KEPT) {
+            nFileDrop = vFilesRead.front();
+            vFilesRead.erase(vFilesRead.begin());
+        }
+
+        // Hint the blocks up to nBlocks ahead of this one which were not
+        // hinted yet.
+        const int nStep = fBackward ? -1 : 1;
+        int nHeight = fBackward ? std::min(nHeightHinted, pindex->nHeight)
+                                : std::max(nHeightHinted, pindex->nHeight);
+        for (nHeight += nStep;
+             nHeight >= 0 && (nHeight - pindex->nHeight) * nStep <= nBlocks;
+             nHeight += nStep) {
+            const CBlockIndex *pindexHint = BlockAt(pindex, nHeight);
+            if (!pindexHint) {
+                break;
+            }
+            const CBlockIndex *pindexNext = BlockAt(pindex, nHeight + 1);
+            if (pindexHint->nStatus.hasData()) {
+                const FlatFilePos pos = pindexHint->GetBlockPos();
+                vBlockRanges.emplace_back(
+                    FlatFilePos(pos.nFile, pos.nPos - BLOCK_FILE_PREFIX_SIZE),
+                    BLOCK_FILE_PREFIX_SIZE +
+                        ReadaheadLength(pos, pindexNext
+                                                 ? pindexNext->GetBlockPos()
+                                                 : FlatFilePos()));
+            }
+            if (fUndo && pindexHint->nStatus.hasUndo()) {
+                const FlatFilePos pos = pindexHint->GetUndoPos();
+                vUndoRanges.emplace_back(
+                    FlatFilePos(pos.nFile, pos.nPos - BLOCK_FILE_PREFIX_SIZE),
+                    BLOCK_FILE_PREFIX_SIZE +
+                        ReadaheadLength(pos, pindexNext
+                                                 ? pindexNext->GetUndoPos()
+                                                 : FlatFilePos()));
+            }
+            nHeightHinted = nHeight;
+        }
+    }
+
+    // The file blocks are written to is likely to be read again soon.
+    if (nFileDrop >= 0) {
+        LOCK(cs_LastBlockFile);
+        if (nFileDrop == nLastBlockFile) {
+            nFileDrop = -1;
+        }
+    }
+    if (nFileDrop >= 0) {
+        // Pages which are still mapped are not dropped.
+        blockFileMappings.Erase(nFileDrop);
+        BlockFileSeq().Advise(FlatFilePos(nFileDrop, 0), 0,
+                              FileAccess::DONTNEED);
+        if (fUndo) {
+            UndoFileSeq().Advise(FlatFilePos(nFileDrop, 0), 0,
+                                 FileAccess::DONTNEED);
+        }
+    }
+
+    for (const std::pair<FlatFilePos, size_t> &range : vBlockRanges) {
+        BlockFileSeq().Advise(range.first, range.second, FileAccess::WILLNEED);
+    }
+    for (const std::pair<FlatFilePos, size_t> &range : vUndoRanges) {
+        UndoFileSeq().Advise(range.first, range.second, FileAccess::WILLNEED);
+    }
 }
 
 Amount GetBlockSubsidy(int nHeight, const Consensus::Params &consensusParams) {
@@ -1724,6 +2444,20 @@ void UpdateCoins(CCoinsViewCache &view, const CTransaction &tx, int nHeight) {
 
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    if (pschnorrbatch && (nFlags & SCRIPT_VERIFY_NULLFAIL)) {
+        std::vector<DeferredSchnorrSig> deferred;
+        if (!VerifyScript(scriptSig, scriptPubKey, nFlags,
+                          BatchingTransactionSignatureChecker(
+                              ptxTo, nIn, amount, cacheStore, txdata, deferred),
+                          &error)) {
+            return false;
+        }
+        if (!pschnorrbatch->Add(std::move(deferred))) {
+            error = ScriptError::SIG_NULLFAIL;
+            return false;
+        }
+        return true;
+    }
     return VerifyScript(scriptSig, scriptPubKey, nFlags,
                         CachingTransactionSignatureChecker(ptxTo, nIn, amount,
                                                            cacheStore, txdata),
@@ -1736,37 +2470,12 @@ int GetSpendHeight(const CCoinsViewCache &inputs) {
     return pindexPrev->nHeight + 1;
 }
 
-bool CheckInputs(const CTransaction &tx, CValidationState &state,
-                 const CCoinsViewCache &inputs, bool fScriptChecks,
-                 const uint32_t flags, bool sigCacheStore,
-                 bool scriptCacheStore,
-                 const PrecomputedTransactionData &txdata,
-                 std::vector<CScriptCheck> *pvChecks)
-    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
-    assert(!tx.IsCoinBase());
-
-    if (pvChecks) {
-        pvChecks->reserve(tx.vin.size());
-    }
-
-    // Skip script verification when connecting blocks under the assumevalid
-    // block. Assuming the assumevalid block is valid this is safe because
-    // block merkle hashes are still computed and checked, of course, if an
-    // assumed valid block is invalid due to false scriptSigs this optimization
-    // would allow an invalid chain to be accepted.
-    if (!fScriptChecks) {
-        return true;
-    }
-
-    // First check if script executions have been cached with the same flags.
-    // Note that this assumes that the inputs provided are correct (ie that the
-    // transaction hash which is in tx's prevouts properly commits to the
-    // scriptPubKey in the inputs view of that transaction).
-    uint256 hashCacheEntry = GetScriptCacheKey(tx, flags);
-    if (IsKeyInScriptCache(hashCacheEntry, !scriptCacheStore)) {
-        return true;
-    }
-
+static bool CheckInputScripts(const CTransaction &tx, CValidationState &state,
+                              const CCoinsViewCache &inputs,
+                              const uint32_t flags, bool sigCacheStore,
+                              const PrecomputedTransactionData &txdata,
+                              std::vector<CScriptCheck> *pvChecks,
+                              SchnorrSignatureBatch *pschnorrbatch) {
     for (size_t i = 0; i < tx.vin.size(); i++) {
         const COutPoint &prevout = tx.vin[i].prevout;
         const Coin &coin = inputs.AccessCoin(prevout);
@@ -1781,11 +2490,15 @@ bool CheckInputs(const CTransaction &tx, CValidationState &state,
         const Amount amount = coin.GetTxOut().nValue;
 
         // Verify signature
+        if (pvChecks) {
+            pvChecks->emplace_back(scriptPubKey, amount, tx, i, flags,
+                                   sigCacheStore, txdata, pschnorrbatch);
+            continue;
+        }
+
         CScriptCheck check(scriptPubKey, amount, tx, i, flags, sigCacheStore,
                            txdata);
-        if (pvChecks) {
-            pvChecks->push_back(std::move(check));
-        } else if (!check()) {
+        if (!check()) {
             ScriptError scriptError = check.GetScriptError();
             // Compute flags without the optional standardness flags.
             // This differs from MANDATORY_SCRIPT_VERIFY_FLAGS as it contains
@@ -1836,6 +2549,46 @@ bool CheckInputs(const CTransaction &tx, CValidationState &state,
         }
     }
 
+    return true;
+}
+
+bool CheckInputs(const CTransaction &tx, CValidationState &state,
+                 const CCoinsViewCache &inputs, bool fScriptChecks,
+                 const uint32_t flags, bool sigCacheStore,
+                 bool scriptCacheStore,
+                 const PrecomputedTransactionData &txdata,
+                 std::vector<CScriptCheck> *pvChecks,
+                 SchnorrSignatureBatch *pschnorrbatch)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+    assert(!tx.IsCoinBase());
+
+    if (pvChecks) {
+        pvChecks->reserve(tx.vin.size());
+    }
+
+    // Skip script verification when connecting blocks under the assumevalid
+    // block. Assuming the assumevalid block is valid this is safe because
+    // block merkle hashes are still computed and checked, of course, if an
+    // assumed valid block is invalid due to false scriptSigs this optimization
+    // would allow an invalid chain to be accepted.
+    if (!fScriptChecks) {
+        return true;
+    }
+
+    // First check if script executions have been cached with the same flags.
+    // Note that this assumes that the inputs provided are correct (ie that the
+    // transaction hash which is in tx's prevouts properly commits to the
+    // scriptPubKey in the inputs view of that transaction).
+    uint256 hashCacheEntry = GetScriptCacheKey(tx, flags);
+    if (IsKeyInScriptCache(hashCacheEntry, !scriptCacheStore)) {
+        return true;
+    }
+
+    if (!CheckInputScripts(tx, state, inputs, flags, sigCacheStore, txdata,
+                           pvChecks, pschnorrbatch)) {
+        return false;
+    }
+
     if (scriptCacheStore && !pvChecks) {
         // We executed all of the provided scripts, and were told to cache the
         // result. Do so now.
@@ -2100,6 +2853,18 @@ DisconnectResult UndoCoinSpend(const Coin &undo, CCoinsViewCache &view,
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+/** Write the changes buffered by the address and spent indexes. */
+static bool WriteIndexChanges() {
+    bool fOk = true;
+    if (g_addressindex && !g_addressindex->WriteChanges()) {
+        fOk = false;
+    }
+    if (g_spentindex && !g_spentindex->WriteChanges()) {
+        fOk = false;
+    }
+    return fOk;
+}
+
 /**
  * Undo the effects of this block (with given index) on the UTXO set represented
  * by coins. When FAILED is returned, view is left in an indeterminate state.
@@ -2114,12 +2879,16 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock &block,
         return DISCONNECT_FAILED;
     }
 
-    return ApplyBlockUndo(blockUndo, block, pindex, view, fJustCheck);
+    DisconnectResult res = ApplyBlockUndo(blockUndo, block, pindex, view);
+    if (!fJustCheck && res != DISCONNECT_FAILED && !WriteIndexChanges()) {
+        res = DISCONNECT_UNCLEAN;
+    }
+    return res;
 }
 
 DisconnectResult ApplyBlockUndo(const CBlockUndo &blockUndo,
                                 const CBlock &block, const CBlockIndex *pindex,
-                                CCoinsViewCache &view, bool fJustCheck) {
+                                CCoinsViewCache &view) {
     bool fClean = true;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
@@ -2188,17 +2957,6 @@ DisconnectResult ApplyBlockUndo(const CBlockUndo &blockUndo,
         }
     }
 
-    if (!fJustCheck && g_addressindex) {
-        if (!g_addressindex->WriteChanges()) {
-            fClean = false;
-        }
-    }
-	if (!fJustCheck && g_spentindex) {
-		if (!g_spentindex->WriteChanges()) {
-			fClean = false;
-		}
-	}
-
     // Move best block pointer to previous block.
     view.SetBestBlock(block.hashPrevBlock);
 
@@ -2253,8 +3011,6 @@ static bool WriteUndoDataForBlock(const CBlockUndo &blockundo,
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("bitcoin-scriptch");
     scriptcheckqueue.Thread();
@@ -2344,12 +3100,13 @@ static int64_t nBlocksTotal = 0;
  * Apply the effects of this block (with given index) on the UTXO set
  * represented by coins. Validity checks that depend on the UTXO set are also
  * done; ConnectBlock() can fail if those validity checks fail (among other
- * reasons).
+ * reasons). The undo data of the block is moved to pblockundo, if given.
  */
 bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
                                CBlockIndex *pindex, CCoinsViewCache &view,
                                const CChainParams &params,
-                               BlockValidationOptions options, bool fJustCheck)
+                               BlockValidationOptions options, bool fJustCheck,
+                               CBlockUndo *pblockundo)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2514,6 +3271,13 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
 
     CBlockUndo blockundo;
 
+    // Schnorr signatures are verified in batches, which is only sound when
+    // NULLFAIL is enforced. This must outlive the control, whose destructor
+    // may still run script checks.
+    SchnorrSignatureBatch schnorrbatch;
+    SchnorrSignatureBatch *pschnorrbatch =
+        (flags & SCRIPT_VERIFY_NULLFAIL) ? &schnorrbatch : nullptr;
+
     CCheckQueueControl<CScriptCheck> control(fScriptChecks ? &scriptcheckqueue
                                                            : nullptr);
 
@@ -2612,7 +3376,7 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
         std::vector<CScriptCheck> vChecks;
         if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults,
                         fCacheResults, PrecomputedTransactionData(tx),
-                        &vChecks)) {
+                        &vChecks, pschnorrbatch)) {
             return error("ConnectBlock(): CheckInputs on %s failed with %s",
                         tx.GetId().ToString(), FormatStateMessage(state));
         }
@@ -2666,6 +3430,11 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
                          "parallel script check failed");
     }
 
+    if (!schnorrbatch.Flush()) {
+        return state.DoS(100, false, REJECT_INVALID, "blk-bad-inputs", false,
+                         "schnorr signature batch check failed");
+    }
+
     int64_t nTime4 = GetTimeMicros();
     nTimeVerify += nTime4 - nTime2;
     LogPrint(
@@ -2682,6 +3451,9 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
     if (!WriteUndoDataForBlock(blockundo, state, pindex, params)) {
         return false;
     }
+    if (pblockundo) {
+        *pblockundo = std::move(blockundo);
+    }
 
     if (!pindex->IsValid(BlockValidity::SCRIPTS)) {
         pindex->RaiseValidity(BlockValidity::SCRIPTS);
@@ -2707,6 +3479,36 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
     return true;
 }
 
+/**
+ * Write a snapshot of the block index, which must have just been written to
+ * the block tree database. Failing to do so is not fatal, the next startup
+ * then loads the block index from the database instead.
+ */
+static void WriteBlockIndexSnapshot() {
+    AssertLockHeld(cs_main);
+
+    int64_t nStart = GetTimeMillis();
+    std::vector<const CBlockIndex *> vIndex;
+    vIndex.reserve(mapBlockIndex.size());
+    for (const std::pair<const uint256, CBlockIndex *> &item : mapBlockIndex) {
+        vIndex.push_back(item.second);
+    }
+    std::sort(vIndex.begin(), vIndex.end(),
+              [](const CBlockIndex *a, const CBlockIndex *b) {
+                  return a->nHeight < b->nHeight;
+              });
+
+    if (!pblocktree->WriteBlockIndexSnapshot(GetBlockIndexSnapshotPath(),
+                                             vIndex)) {
+        LogPrintf("Failed to write the block index snapshot\n");
+        return;
+    }
+    fBlockIndexSnapshotCurrent = true;
+    LogPrint(BCLog::BENCH,
+             "Wrote block index snapshot with %u entries in %dms\n",
+             vIndex.size(), GetTimeMillis() - nStart);
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with if
@@ -2818,6 +3620,18 @@ static bool FlushStateToDisk(const CChainParams &chainparams,
                         return AbortNode(
                             state, "Failed to write to block index database");
                     }
+                    if (!vBlocks.empty()) {
+                        fBlockIndexSnapshotCurrent = false;
+                    }
+                }
+
+                // On full flushes, such as at shutdown, also write a snapshot
+                // of the block index so the next startup can load it quickly.
+                if (mode == FlushStateMode::ALWAYS &&
+                    !fBlockIndexSnapshotCurrent &&
+                    gArgs.GetBoolArg("-blockindexsnapshot",
+                                     DEFAULT_BLOCK_INDEX_SNAPSHOT)) {
+                    WriteBlockIndexSnapshot();
                 }
 
                 // Finally remove any pruned files
@@ -2904,6 +3718,107 @@ static void UpdateTip(const Config &config, CBlockIndex *pindexNew) {
         pcoinsTip->GetCacheSize());
 }
 
+namespace {
+//! Approximate memory used by the undo data of a block.
+size_t UndoDynamicUsage(const CBlockUndo &blockundo) {
+    size_t nUsage = memusage::DynamicUsage(blockundo.vtxundo);
+    for (const CTxUndo &txundo : blockundo.vtxundo) {
+        nUsage += memusage::DynamicUsage(txundo.vprevout);
+        for (const Coin &coin : txundo.vprevout) {
+            nUsage += coin.DynamicMemoryUsage();
+        }
+    }
+    return nUsage;
+}
+
+/**
+ * The blocks connected last, along with their undo data, so that a reorg can
+ * disconnect them without reading either from disk. Must be used with cs_main
+ * held.
+ */
+class UndoCache {
+private:
+    struct Entry {
+        const CBlockIndex *pindex;
+        std::shared_ptr<const CBlock> block;
+        std::shared_ptr<const CBlockUndo> undo;
+        size_t nUsage;
+    };
+
+    //! Oldest first
+    std::deque<Entry> entries;
+    size_t nUsage = 0;
+    size_t nMaxBlocks = DEFAULT_UNDO_CACHE;
+    size_t nMaxUsage = DEFAULT_UNDO_CACHE_MEMORY * 1024 * 1024;
+
+    void Trim() {
+        while (!entries.empty() &&
+               (entries.size() > nMaxBlocks || nUsage > nMaxUsage)) {
+            nUsage -= entries.front().nUsage;
+            entries.pop_front();
+        }
+    }
+
+public:
+    void SetLimits(size_t nMaxBlocksIn, size_t nMaxUsageIn) {
+        nMaxBlocks = nMaxBlocksIn;
+        nMaxUsage = nMaxUsageIn;
+        Trim();
+    }
+
+    void Add(const CBlockIndex *pindex, std::shared_ptr<const CBlock> block,
+             CBlockUndo &&blockundo) {
+        if (nMaxBlocks == 0) {
+            return;
+        }
+        Entry entry{pindex, std::move(block),
+                    std::make_shared<const CBlockUndo>(std::move(blockundo)),
+                    0};
+        entry.nUsage = RecursiveDynamicUsage(*entry.block) +
+                       UndoDynamicUsage(*entry.undo);
+        nUsage += entry.nUsage;
+        entries.push_back(std::move(entry));
+        Trim();
+    }
+
+    /**
+     * Remove the block of pindex from the cache, and return it with its undo
+     * data. Returns false if it is not cached.
+     */
+    bool Take(const CBlockIndex *pindex, std::shared_ptr<const CBlock> &block,
+              std::shared_ptr<const CBlockUndo> &blockundo) {
+        // Blocks are disconnected from the tip, which is the newest entry.
+        auto it = std::find_if(
+            entries.rbegin(), entries.rend(),
+            [&](const Entry &entry) { return entry.pindex == pindex; });
+        if (it == entries.rend()) {
+            return false;
+        }
+        block = std::move(it->block);
+        blockundo = std::move(it->undo);
+        nUsage -= it->nUsage;
+        entries.erase(std::next(it).base());
+        return true;
+    }
+
+    void Clear() {
+        entries.clear();
+        nUsage = 0;
+    }
+};
+
+UndoCache undoCache;
+} // namespace
+
+void InitUndoCache() {
+    LOCK(cs_main);
+    undoCache.SetLimits(
+        std::max<int64_t>(gArgs.GetArg("-undocache", DEFAULT_UNDO_CACHE), 0),
+        std::max<int64_t>(
+            gArgs.GetArg("-undocachemem", DEFAULT_UNDO_CACHE_MEMORY), 0) *
+            1024 * 1024);
+}
+
 /**
  * Disconnect chainActive's tip.
  * After calling, the mempool will be in an inconsistent state, with
@@ -2918,72 +3833,125 @@ static void UpdateTip(const Config &config, CBlockIndex *pindexNew) {
 bool CChainState::DisconnectTip(const Config &config, CValidationState &state,
                                 DisconnectedBlockTransactions *disconnectpool)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
-    CBlockIndex *pindexDelete = chainActive.Tip();
+    assert(chainActive.Tip());
+    return DisconnectTipsTo(config, state, chainActive.Tip()->pprev,
+                            disconnectpool);
+}
+
+/**
+ * Disconnect blocks from chainActive's tip until pindexFork is the tip, as
+ * DisconnectTip does one by one. Up to MAX_DISCONNECT_BATCH blocks are undone
+ * on the same view, so that pcoinsTip and the indexes are updated once for all
+ * of them. If a block fails to disconnect, the blocks of its batch are left
+ * connected.
+ */
+bool CChainState::DisconnectTipsTo(
+    const Config &config, CValidationState &state,
+    const CBlockIndex *pindexFork,
+    DisconnectedBlockTransactions *disconnectpool)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+    AssertLockHeld(cs_main);
     const Consensus::Params &consensusParams =
         config.GetChainParams().GetConsensus();
 
-    assert(pindexDelete);
-
-    // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock &block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, consensusParams)) {
-        return AbortNode(state, "Failed to read block");
-    }
+    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+        std::vector<std::pair<CBlockIndex *, std::shared_ptr<const CBlock>>>
+            vDisconnected;
 
-    // Apply the block atomically to the chain state.
-    int64_t nStart = GetTimeMicros();
-    {
-        CCoinsViewCache view(pcoinsTip.get());
-        assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK) {
-            return error("DisconnectTip(): DisconnectBlock %s failed",
-                         pindexDelete->GetBlockHash().ToString());
-        }
+        // Apply the blocks atomically to the chain state.
+        int64_t nStart = GetTimeMicros();
+        {
+            CCoinsViewCache view(pcoinsTip.get());
+            assert(view.GetBestBlock() == chainActive.Tip()->GetBlockHash());
+            for (CBlockIndex *pindexDelete = chainActive.Tip();
+                 pindexDelete != pindexFork &&
+                 vDisconnected.size() < MAX_DISCONNECT_BATCH;
+                 pindexDelete = pindexDelete->pprev) {
+                assert(pindexDelete);
+                std::shared_ptr<const CBlock> pblock;
+                std::shared_ptr<const CBlockUndo> pblockundo;
+                if (!undoCache.Take(pindexDelete, pblock, pblockundo)) {
+                    // Read block from disk.
+                    std::shared_ptr<CBlock> pblockNew =
+                        std::make_shared<CBlock>();
+                    if (!ReadBlockFromDisk(*pblockNew, pindexDelete,
+                                           consensusParams)) {
+                        return AbortNode(state, "Failed to read block");
+                    }
+                    pblock = pblockNew;
+
+                    std::shared_ptr<CBlockUndo> pblockundoNew =
+                        std::make_shared<CBlockUndo>();
+                    if (!UndoReadFromDisk(*pblockundoNew, pindexDelete)) {
+                        return error("DisconnectTip(): failure reading undo "
+                                     "data for %s",
+                                     pindexDelete->GetBlockHash().ToString());
+                    }
+                    pblockundo = pblockundoNew;
+                }
 
-        bool flushed = view.Flush();
-        assert(flushed);
-    }
+                if (ApplyBlockUndo(*pblockundo, *pblock, pindexDelete, view) !=
+                    DISCONNECT_OK) {
+                    return error("DisconnectTip(): DisconnectBlock %s failed",
+                                 pindexDelete->GetBlockHash().ToString());
+                }
+                vDisconnected.emplace_back(pindexDelete, std::move(pblock));
+            }
 
-    LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n",
-             (GetTimeMicros() - nStart) * MILLI);
+            bool flushed = view.Flush();
+            assert(flushed);
+        }
+        if (!WriteIndexChanges()) {
+            return error("DisconnectTip(): failed to write the index changes");
+        }
 
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(config.GetChainParams(), state,
-                          FlushStateMode::IF_NEEDED)) {
-        return false;
-    }
+        LogPrint(BCLog::BENCH, "- Disconnect %u blocks: %.2fms\n",
+                 vDisconnected.size(), (GetTimeMicros() - nStart) * MILLI);
 
-    // If this block is deactivating a fork, we move all mempool transactions
-    // in front of disconnectpool for reprocessing in a future
-    // updateMempoolForReorg call
-    if (pindexDelete->pprev != nullptr &&
-        GetNextBlockScriptFlags(consensusParams, pindexDelete) !=
-            GetNextBlockScriptFlags(consensusParams, pindexDelete->pprev)) {
-        LogPrint(BCLog::MEMPOOL,
-                 "Disconnecting mempool due to rewind of upgrade block\n");
-        if (disconnectpool) {
-            disconnectpool->importMempool(g_mempool);
+        // Write the chain state to disk, if necessary.
+        if (!FlushStateToDisk(config.GetChainParams(), state,
+                              FlushStateMode::IF_NEEDED)) {
+            return false;
         }
-        g_mempool.clear();
-    }
 
-    if (disconnectpool) {
-        disconnectpool->addForBlock(block.vtx);
-    }
+        for (const auto &disconnected : vDisconnected) {
+            CBlockIndex *pindexDelete = disconnected.first;
+            const std::shared_ptr<const CBlock> &pblock = disconnected.second;
+
+            // If this block is deactivating a fork, we move all mempool
+            // transactions in front of disconnectpool for reprocessing in a
+            // future updateMempoolForReorg call
+            if (pindexDelete->pprev != nullptr &&
+                GetNextBlockScriptFlags(consensusParams, pindexDelete) !=
+                    GetNextBlockScriptFlags(consensusParams,
+                                            pindexDelete->pprev)) {
+                LogPrint(
+                    BCLog::MEMPOOL,
+                    "Disconnecting mempool due to rewind of upgrade block\n");
+                if (disconnectpool) {
+                    disconnectpool->importMempool(g_mempool);
+                }
+                g_mempool.clear();
+            }
 
-    // If the tip is finalized, then undo it.
-    if (pindexFinalized == pindexDelete) {
-        pindexFinalized = pindexDelete->pprev;
-    }
+            if (disconnectpool) {
+                disconnectpool->addForBlock(pblock->vtx);
+            }
 
-    chainActive.SetTip(pindexDelete->pprev);
+            // If the tip is finalized, then undo it.
+            if (pindexFinalized == pindexDelete) {
+                pindexFinalized = pindexDelete->pprev;
+            }
+
+            chainActive.SetTip(pindexDelete->pprev);
 
-    // Update chainActive and related variables.
-    UpdateTip(config, pindexDelete->pprev);
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    GetMainSignals().BlockDisconnected(pblock);
+            // Update chainActive and related variables.
+            UpdateTip(config, pindexDelete->pprev);
+            // Let wallets know transactions went from 1-confirmed to
+            // 0-confirmed or conflicted:
+            GetMainSignals().BlockDisconnected(pblock);
+        }
+    }
     return true;
 }
 
@@ -3148,6 +4116,246 @@ static const CBlockIndex *FindBlockToFinalize(const Config &config,
  * by copying pblock) - if that is not intended, care must be taken to remove
  * the last entry in blocksConnected in case of failure.
  */
+namespace {
+/**
+ * Prepares the blocks ActivateBestChain is about to connect on a few worker
+ * threads, while the current block is being connected. Each block is read
+ * from disk (which computes the txids), goes through CheckBlock (which
+ * computes the merkle root), and the coins it spends are looked up in the
+ * coins database so they sit in its caches. Prepared blocks are kept up to a
+ * memory budget.
+ */
+class BlockPrefetcher {
+private:
+    //! A block to prepare, as requested by the connecting thread.
+    struct PendingBlock {
+        uint256 hash;
+        FlatFilePos pos;
+    };
+
+    Mutex cs;
+    std::condition_variable cond;
+    //! Blocks to prepare, in connection order
+    std::deque<PendingBlock> vPending GUARDED_BY(cs);
+    //! Blocks being prepared by a worker
+    std::set<uint256> setBusy GUARDED_BY(cs);
+    //! Blocks that are ready to be connected
+    std::map<uint256, std::shared_ptr<const CBlock>> mapReady GUARDED_BY(cs);
+    //! Memory used by the blocks in mapReady
+    size_t nUsage GUARDED_BY(cs) = 0;
+    //! Bumped by Clear(), so that workers drop what they are preparing
+    uint64_t nGeneration GUARDED_BY(cs) = 0;
+    //! Coins view that spent coins are looked up in
+    CCoinsView *coinsview GUARDED_BY(cs) = nullptr;
+    bool fStop GUARDED_BY(cs) = false;
+
+    std::vector<std::thread> threads;
+    const Config *config = nullptr;
+    size_t nMaxBlocks = 0;
+    size_t nMaxUsage = 0;
+
+    void Prepare(CBlock &block, const PendingBlock &pending,
+                 CCoinsView *view) {
+        const Consensus::Params &params =
+            config->GetChainParams().GetConsensus();
+        if (!ReadBlockFromDisk(block, pending.pos, params) ||
+            block.GetHash() != pending.hash) {
+            block.SetNull();
+            return;
+        }
+
+        // This sets fChecked, so ConnectBlock skips these checks. Invalid
+        // blocks are left for the connecting thread to reject.
+        CValidationState state;
+        if (!CheckBlock(block, state, params,
+                        BlockValidationOptions(*config))) {
+            block.SetNull();
+            return;
+        }
+
+        // Only the coins database below pcoinsTip is looked at: it does not
+        // change while blocks are connected, but pcoinsTip does.
+        if (view) {
+            for (const CTransactionRef &tx : block.vtx) {
+                if (tx->IsCoinBase()) {
+                    continue;
+                }
+                for (const CTxIn &in : tx->vin) {
+                    view->HaveCoin(in.prevout);
+                }
+            }
+        }
+    }
+
+    void Thread() {
+        while (true) {
+            PendingBlock pending;
+            uint64_t nGenerationStart;
+            CCoinsView *view;
+            {
+                WAIT_LOCK(cs, lock);
+                cond.wait(lock, [&] {
+                    return fStop || (!vPending.empty() && nUsage < nMaxUsage);
+                });
+                if (fStop) {
+                    return;
+                }
+                pending = vPending.front();
+                vPending.pop_front();
+                setBusy.insert(pending.hash);
+                nGenerationStart = nGeneration;
+                view = coinsview;
+            }
+
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            Prepare(*pblock, pending, view);
+
+            {
+                LOCK(cs);
+                setBusy.erase(pending.hash);
+                if (nGeneration == nGenerationStart && !pblock->IsNull()) {
+                    nUsage += RecursiveDynamicUsage(*pblock);
+                    mapReady.emplace(pending.hash, std::move(pblock));
+                }
+            }
+            cond.notify_all();
+        }
+    }
+
+public:
+    void Start(const Config &configIn, int nThreads, size_t nMaxBlocksIn,
+               size_t nMaxUsageIn) {
+        assert(threads.empty());
+        config = &configIn;
+        nMaxBlocks = nMaxBlocksIn;
+        nMaxUsage = nMaxUsageIn;
+        for (int i = 0; i < nThreads; i++) {
+            threads.emplace_back(&TraceThread<std::function<void()>>,
+                                 "blockprefetch",
+                                 std::function<void()>([this] { Thread(); }));
+        }
+    }
+
+    void Stop() {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        threads.clear();
+
+        LOCK(cs);
+        fStop = false;
+        vPending.clear();
+        mapReady.clear();
+        nUsage = 0;
+    }
+
+    /**
+     * Ask for the given blocks to be prepared, in the order they are going to
+     * be connected. Prepared blocks that are not asked for anymore are
+     * dropped.
+     */
+    void Request(const std::vector<const CBlockIndex *> &vpindex,
+                 CCoinsView *view) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        if (threads.empty()) {
+            return;
+        }
+
+        LOCK(cs);
+        coinsview = view;
+        vPending.clear();
+        std::set<uint256> setWanted;
+        for (const CBlockIndex *pindex : vpindex) {
+            if (setWanted.size() == nMaxBlocks) {
+                break;
+            }
+            const uint256 hash = pindex->GetBlockHash();
+            setWanted.insert(hash);
+            if (pindex->nStatus.hasData() && !mapReady.count(hash) &&
+                !setBusy.count(hash)) {
+                vPending.push_back({hash, pindex->GetBlockPos()});
+            }
+        }
+        for (auto it = mapReady.begin(); it != mapReady.end();) {
+            if (setWanted.count(it->first)) {
+                ++it;
+                continue;
+            }
+            nUsage -= RecursiveDynamicUsage(*it->second);
+            it = mapReady.erase(it);
+        }
+        cond.notify_all();
+    }
+
+    /**
+     * Get the prepared block for pindex, waiting for it if a worker is busy
+     * with it. Returns nullptr if it was not prepared.
+     */
+    std::shared_ptr<const CBlock> Take(const CBlockIndex *pindex) {
+        const uint256 hash = pindex->GetBlockHash();
+        std::shared_ptr<const CBlock> pblock;
+        {
+            WAIT_LOCK(cs, lock);
+            vPending.erase(std::remove_if(vPending.begin(), vPending.end(),
+                                          [&](const PendingBlock &pending) {
+                                              return pending.hash == hash;
+                                          }),
+                           vPending.end());
+            cond.wait(lock, [&] { return !setBusy.count(hash); });
+            auto it = mapReady.find(hash);
+            if (it == mapReady.end()) {
+                return nullptr;
+            }
+            pblock = std::move(it->second);
+            mapReady.erase(it);
+            nUsage -= RecursiveDynamicUsage(*pblock);
+        }
+        cond.notify_all();
+        return pblock;
+    }
+
+    /**
+     * Drop all requested and prepared blocks, and wait until no worker uses
+     * the coins view anymore.
+     */
+    void Clear() {
+        WAIT_LOCK(cs, lock);
+        nGeneration++;
+        vPending.clear();
+        mapReady.clear();
+        nUsage = 0;
+        coinsview = nullptr;
+        cond.wait(lock, [&] { return setBusy.empty(); });
+    }
+};
+
+BlockPrefetcher blockPrefetcher;
+} // namespace
+
+void StartBlockPrefetchThreads(const Config &config) {
+    const int64_t nBlocks =
+        gArgs.GetArg("-blockprefetch", DEFAULT_BLOCK_PREFETCH);
+    if (nBlocks <= 0) {
+        return;
+    }
+    const int64_t nMaxUsage =
+        gArgs.GetArg("-blockprefetchmem", DEFAULT_BLOCK_PREFETCH_MEMORY) *
+        1024 * 1024;
+    LogPrintf("Preparing up to %d blocks ahead of connecting them, "
+              "using up to %d MiB\n",
+              nBlocks, nMaxUsage >> 20);
+    blockPrefetcher.Start(config, BLOCK_PREFETCH_THREADS, nBlocks,
+                          std::max<int64_t>(nMaxUsage, 0));
+}
+
+void StopBlockPrefetchThreads() {
+    blockPrefetcher.Stop();
+}
+
 bool CChainState::ConnectTip(const Config &config, CValidationState &state,
                              CBlockIndex *pindexNew,
                              const std::shared_ptr<const CBlock> &pblock,
@@ -3162,28 +4370,36 @@ bool CChainState::ConnectTip(const Config &config, CValidationState &state,
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
+    bool fPrefetched = false;
     if (!pblock) {
+        pthisBlock = blockPrefetcher.Take(pindexNew);
+        fPrefetched = pthisBlock != nullptr;
+    } else {
+        pthisBlock = pblock;
+    }
+    if (!pthisBlock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, consensusParams)) {
             return AbortNode(state, "Failed to read block");
         }
         pthisBlock = pblockNew;
-    } else {
-        pthisBlock = pblock;
     }
 
     const CBlock &blockConnecting = *pthisBlock;
+    CBlockUndo blockundo;
 
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
-    LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n",
-             (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]%s\n",
+             (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO,
+             fPrefetched ? " (prefetched)" : "");
     {
         CCoinsViewCache view(pcoinsTip.get());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, params,
-                               BlockValidationOptions(config));
+                               BlockValidationOptions(config), false,
+                               &blockundo);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid()) {
@@ -3253,6 +4469,7 @@ bool CChainState::ConnectTip(const Config &config, CValidationState &state,
     // Update chainActive & related variables.
     chainActive.SetTip(pindexNew);
     UpdateTip(config, pindexNew);
+    undoCache.Add(pindexNew, pthisBlock, std::move(blockundo));
 
     int64_t nTime6 = GetTimeMicros();
     nTimePostConnect += nTime6 - nTime5;
@@ -3451,17 +4668,14 @@ bool CChainState::ActivateBestChainStep(
     const CBlockIndex *pindexFork = chainActive.FindFork(pindexMostWork);
 
     // Disconnect active blocks which are no longer in the best chain.
-    bool fBlocksDisconnected = false;
+    const bool fBlocksDisconnected =
+        chainActive.Tip() && chainActive.Tip() != pindexFork;
     DisconnectedBlockTransactions disconnectpool;
-    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(config, state, &disconnectpool)) {
-            // This is likely a fatal error, but keep the mempool consistent,
-            // just in case. Only remove from the mempool in this case.
-            disconnectpool.updateMempoolForReorg(config, false);
-            return false;
-        }
-
-        fBlocksDisconnected = true;
+    if (!DisconnectTipsTo(config, state, pindexFork, &disconnectpool)) {
+        // This is likely a fatal error, but keep the mempool consistent,
+        // just in case. Only remove from the mempool in this case.
+        disconnectpool.updateMempoolForReorg(config, false);
+        return false;
     }
 
     // Build list of new blocks to connect.
@@ -3482,6 +4696,15 @@ bool CChainState::ActivateBestChainStep(
 
         nHeight = nTargetHeight;
 
+        // Let the workers prepare the blocks after the one being connected.
+        std::vector<const CBlockIndex *> vpindexToPrefetch;
+        for (const CBlockIndex *pindex : reverse_iterate(vpindexToConnect)) {
+            if (pindex != pindexMostWork || !pblock) {
+                vpindexToPrefetch.push_back(pindex);
+            }
+        }
+        blockPrefetcher.Request(vpindexToPrefetch, pcoinsdbview.get());
+
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
             if (!ConnectTip(config, state, pindexConnect,
@@ -3765,11 +4988,11 @@ bool CChainState::UnwindBlock(const Config &config, CValidationState &state,
     CBlockIndex *invalid_walk_tip = chainActive.Tip();
 
     DisconnectedBlockTransactions disconnectpool;
-    while (chainActive.Contains(pindex)) {
+    if (chainActive.Contains(pindex)) {
         pindex_was_in_chain = true;
         // ActivateBestChain considers blocks already in chainActive
         // unconditionally valid already, so force disconnect away from it.
-        if (!DisconnectTip(config, state, &disconnectpool)) {
+        if (!DisconnectTipsTo(config, state, pindex->pprev, &disconnectpool)) {
             // It's probably hopeless to try to make the mempool consistent
             // here if DisconnectTip failed, but we can try.
             disconnectpool.updateMempoolForReorg(config, false);
@@ -3987,7 +5210,8 @@ CBlockIndex *CChainState::AddToBlockIndex(const CBlockHeader &block)
     }
 
     // Construct new block index object
-    CBlockIndex *pindexNew = new CBlockIndex(block);
+    CBlockIndex *pindexNew = blockIndexArena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -4950,6 +6174,7 @@ void PruneOneBlockFile(const int fileNumber) {
 void UnlinkPrunedFiles(const std::set<int> &setFilesToPrune) {
     for (const int i : setFilesToPrune) {
         FlatFilePos pos(i, 0);
+        blockFileMappings.Erase(i);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, i);
@@ -5099,6 +6324,10 @@ FILE *OpenBlockFile(const FlatFilePos &pos, bool fReadOnly) {
 }
 
 /** Open an undo file (rev?????.dat) */
+static fs::path GetBlockIndexSnapshotPath() {
+    return GetBlocksDir() / "blockindex.dat";
+}
+
 static FILE *OpenUndoFile(const FlatFilePos &pos, bool fReadOnly) {
     return UndoFileSeq().Open(pos, fReadOnly);
 }
@@ -5121,33 +6350,114 @@ CBlockIndex *CChainState::InsertBlockIndex(const uint256 &hash) {
     }
 
     // Create new
-    CBlockIndex *pindexNew = new CBlockIndex();
+    CBlockIndex *pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
 }
 
-bool CChainState::LoadBlockIndex(const Config &config,
-                                 CBlockTreeDB &blocktree) {
-    if (!blocktree.LoadBlockIndexGuts(config.GetChainParams().GetConsensus(),
-                                      [this](const uint256 &hash) {
-                                          return this->InsertBlockIndex(hash);
-                                      })) {
+bool CChainState::LoadBlockIndexSnapshot(
+    const Config &config, CBlockTreeDB &blocktree,
+    std::vector<std::pair<int, CBlockIndex *>> &vSortedByHeight) {
+    AssertLockHeld(cs_main);
+
+    if (!gArgs.GetBoolArg("-blockindexsnapshot",
+                          DEFAULT_BLOCK_INDEX_SNAPSHOT) ||
+        !mapBlockIndex.empty()) {
         return false;
     }
 
-    boost::this_thread::interruption_point();
+    int64_t nStart = GetTimeMillis();
+    std::vector<std::pair<uint256, CBlockIndex *>> vIndex;
+    if (!blocktree.LoadBlockIndexSnapshot(
+            GetBlockIndexSnapshotPath(), config.GetChainParams().GetConsensus(),
+            blockIndexArena, vIndex)) {
+        blockIndexArena.Clear();
+        return false;
+    }
 
-    // Calculate nChainWork
+    mapBlockIndex.reserve(vIndex.size());
+    vSortedByHeight.reserve(vIndex.size());
+    for (const std::pair<uint256, CBlockIndex *> &item : vIndex) {
+        std::pair<BlockMap::iterator, bool> inserted =
+            mapBlockIndex.insert(item);
+        if (!inserted.second) {
+            LogPrintf("%s: duplicate block %s in block index snapshot\n",
+                      __func__, item.first.ToString());
+            mapBlockIndex.clear();
+            vSortedByHeight.clear();
+            blockIndexArena.Clear();
+            return false;
+        }
+        item.second->phashBlock = &inserted.first->first;
+        vSortedByHeight.push_back(
+            std::make_pair(item.second->nHeight, item.second));
+    }
+
+    fBlockIndexSnapshotCurrent = true;
+    LogPrintf("Loaded %u block index entries from snapshot in %dms\n",
+              vIndex.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+void CChainState::MoveBlockIndexToHeightOrder(
+    std::vector<std::pair<int, CBlockIndex *>> &vSortedByHeight) {
+    AssertLockHeld(cs_main);
+
+    CBlockIndexArena arena;
+    CBlockIndex *base = arena.AllocateBulk(vSortedByHeight.size());
+    // Skip pointers are only built later on, so use them to remember where
+    // each entry moved to.
+    for (size_t i = 0; i < vSortedByHeight.size(); i++) {
+        CBlockIndex *pindex = vSortedByHeight[i].second;
+        base[i] = *pindex;
+        pindex->pskip = &base[i];
+        vSortedByHeight[i].second = &base[i];
+    }
+    for (size_t i = 0; i < vSortedByHeight.size(); i++) {
+        if (base[i].pprev) {
+            base[i].pprev = base[i].pprev->pskip;
+        }
+    }
+    for (std::pair<const uint256, CBlockIndex *> &item : mapBlockIndex) {
+        item.second = item.second->pskip;
+    }
+    blockIndexArena = std::move(arena);
+}
+
+bool CChainState::LoadBlockIndex(const Config &config,
+                                 CBlockTreeDB &blocktree) {
+    // Entries from the snapshot are already sorted by height.
     std::vector<std::pair<int, CBlockIndex *>> vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
-    for (const std::pair<const uint256, CBlockIndex *> &item : mapBlockIndex) {
-        CBlockIndex *pindex = item.second;
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    if (!LoadBlockIndexSnapshot(config, blocktree, vSortedByHeight)) {
+        if (!blocktree.LoadBlockIndexGuts(
+                config.GetChainParams().GetConsensus(),
+                [this](const uint256 &hash) {
+                    return this->InsertBlockIndex(hash);
+                })) {
+            return false;
+        }
+
+        boost::this_thread::interruption_point();
+
+        vSortedByHeight.reserve(mapBlockIndex.size());
+        for (const std::pair<const uint256, CBlockIndex *> &item :
+             mapBlockIndex) {
+            CBlockIndex *pindex = item.second;
+            vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+        }
+
+        sort(vSortedByHeight.begin(), vSortedByHeight.end());
+
+        // The records come in hash order, so move the entries to one
+        // allocation in height order, as the snapshot loads them.
+        MoveBlockIndexToHeightOrder(vSortedByHeight);
     }
 
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    boost::this_thread::interruption_point();
+
+    // Calculate nChainWork
     for (const std::pair<int, CBlockIndex *> &item : vSortedByHeight) {
         CBlockIndex *pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) +
@@ -5336,6 +6646,8 @@ bool CVerifyDB::VerifyDB(const Config &config, CCoinsView *coinsview,
     CCoinsViewCache coins(coinsview);
     CBlockIndex *pindex;
     CBlockIndex *pindexFailure = nullptr;
+    BlockFileReadahead readahead(
+        chainActive[chainActive.Height() - nCheckDepth + 1], nCheckLevel >= 2);
     int nGoodTransactions = 0;
     CValidationState state;
     int reportDone = 0;
@@ -5369,6 +6681,7 @@ bool CVerifyDB::VerifyDB(const Config &config, CCoinsView *coinsview,
             break;
         }
 
+        readahead.Read(pindex);
         CBlock block;
 
         // check level 0: read from disk
@@ -5689,6 +7002,7 @@ bool RewindBlockIndex(const Config &config) {
 // May NOT be used after any connections are up as much of the peer-processing
 // logic assumes a consistent block index state
 void CChainState::UnloadBlockIndex() {
+    blockIndexArena.Clear();
     nBlockSequenceId = 1;
     m_failed_blocks.clear();
     setBlockIndexCandidates.clear();
@@ -5712,10 +7026,10 @@ void UnloadBlockIndex() {
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
-
-    for (const BlockMap::value_type &entry : mapBlockIndex) {
-        delete entry.second;
-    }
+    blockFileMappings.Clear();
+    blockPrefetcher.Clear();
+    undoCache.Clear();
+    fBlockIndexSnapshotCurrent = false;
 
     mapBlockIndex.clear();
     fHavePruned = false;
@@ -5792,164 +7106,469 @@ bool LoadGenesisBlock(const CChainParams &chainparams) {
     return g_chainstate.LoadGenesisBlock(chainparams);
 }
 
-bool LoadExternalBlockFile(const Config &config, FILE *fileIn,
-                           FlatFilePos *dbp) {
-    // Map of disk positions for blocks with unknown parent (only used for
-    // reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+//! Maximum number of threads reading and deserializing block files at once
+static const int MAX_IMPORT_THREADS = 4;
+//! Serialized size of the blocks which readers may buffer ahead of the file
+//! being accepted
+static const size_t MAX_IMPORT_BUFFER_BYTES = 256 << 20;
+//! Serialized size of the out of order blocks kept in memory until their
+//! parent shows up
+static const size_t MAX_UNKNOWN_PARENT_BYTES = 128 << 20;
 
-    const CChainParams &chainparams = config.GetChainParams();
+namespace {
+/** A block read from an external file by the import pipeline. */
+struct ImportedBlock {
+    std::shared_ptr<CBlock> pblock;
+    uint256 hash;
+    FlatFilePos pos;
+    size_t nSize;
+};
+
+/**
+ * Pipeline behind -reindex and -loadblock.
+ *
+ * Reader threads each claim the next file, scan it for blocks, deserialize
+ * them and run the context free checks, several files at once. The calling
+ * thread accepts the blocks one file after the other, in the order they
+ * appear in the files, so the resulting block index does not depend on the
+ * number of threads. Blocks whose parent is not known yet are kept in a
+ * buffer keyed by their parent hash until it shows up.
+ *
+ * Connecting the blocks is left to the ActivateBestChain call which follows
+ * the import.
+ */
+class BlockImporter {
+private:
+    //! Blocks read from one file, and whether its reader is done.
+    struct ImportFile {
+        std::deque<ImportedBlock> blocks;
+        bool fDone = false;
+    };
+
+    const Config &config;
+    const std::vector<fs::path> &vFiles;
+    //! Whether vFiles are our own blk?????.dat files, the index of each
+    //! being its file number.
+    const bool fBlockFiles;
+
+    Mutex cs;
+    std::condition_variable cond;
+    std::vector<ImportFile> vImportFiles GUARDED_BY(cs);
+    //! The next file to be claimed by a reader.
+    size_t nNextFile GUARDED_BY(cs) = 0;
+    //! The file currently being accepted.
+    size_t nCurrentFile GUARDED_BY(cs) = 0;
+    //! Serialized size of the blocks waiting in vImportFiles.
+    size_t nBufferedBytes GUARDED_BY(cs) = 0;
+    bool fInterrupt GUARDED_BY(cs) = false;
+
+    //! Blocks with an unknown parent, keyed by the parent hash. Blocks from
+    //! our own block files are dropped from memory and read again once the
+    //! buffer is full.
+    std::multimap<uint256, ImportedBlock> mapBlocksUnknownParent;
+    size_t nUnknownParentBytes = 0;
 
     int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile
-        // destructor. Make sure we have at least 2*MAX_TX_SIZE space in there
-        // so any transaction can fit in the buffer.
-        CBufferedFile blkdat(fileIn, 2 * MAX_TX_SIZE, MAX_TX_SIZE + 8, SER_DISK,
-                             CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            // Start one byte further next time, in case of failure.
-            nRewind++;
-            // Remove former limit.
-            blkdat.SetLimit();
-            unsigned int nSize = 0;
-            try {
-                // Locate a header.
-                uint8_t buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.DiskMagic()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.DiskMagic().data(),
-                           CMessageHeader::MESSAGE_START_SIZE)) {
-                    continue;
-                }
+    //! Time spent in each stage, in microseconds. The reader stages are
+    //! summed over all threads.
+    std::atomic<int64_t> nTimeRead{0};
+    std::atomic<int64_t> nTimeParse{0};
+    std::atomic<int64_t> nTimeCheck{0};
+    std::atomic<uint64_t> nBytesRead{0};
+    std::atomic<uint64_t> nBlocksRead{0};
+    int64_t nTimeWait = 0;
+    int64_t nTimeAccept = 0;
+    uint64_t nBlocksAccepted = 0;
 
-                // Read size.
-                blkdat >> nSize;
-                if (nSize < 80) {
-                    continue;
-                }
-            } catch (const std::exception &) {
-                // No valid block header found; don't complain.
-                break;
+    /**
+     * Hand a block over to the accepting thread. Readers of files after the
+     * current one wait while the buffer is full, so the pipeline never
+     * stalls. Returns false if the import is interrupted.
+     */
+    bool Push(size_t nFile, ImportedBlock &&block) {
+        WAIT_LOCK(cs, lock);
+        cond.wait(lock, [&] {
+            return fInterrupt || nFile <= nCurrentFile ||
+                   nBufferedBytes < MAX_IMPORT_BUFFER_BYTES;
+        });
+        if (fInterrupt) {
+            return false;
+        }
+        nBufferedBytes += block.nSize;
+        vImportFiles[nFile].blocks.push_back(std::move(block));
+        cond.notify_all();
+        return true;
+    }
+
+    /**
+     * Take the next block of the given file, waiting for its reader. Returns
+     * false once the file is exhausted.
+     */
+    bool Pop(size_t nFile, ImportedBlock &block) {
+        WAIT_LOCK(cs, lock);
+        ImportFile &file = vImportFiles[nFile];
+        cond.wait(lock, [&] {
+            return !file.blocks.empty() || file.fDone;
+        });
+        if (file.blocks.empty()) {
+            return false;
+        }
+        block = std::move(file.blocks.front());
+        file.blocks.pop_front();
+        nBufferedBytes -= block.nSize;
+        cond.notify_all();
+        return true;
+    }
+
+    void ReadFile(size_t nFile);
+    void ThreadRead();
+    bool AcceptImportedBlock(ImportedBlock &imported);
+    void AcceptUnknownParentChildren(const uint256 &hash);
+    void Interrupt();
+
+public:
+    BlockImporter(const Config &configIn, const std::vector<fs::path> &files,
+                  bool fBlockFilesIn)
+        : config(configIn), vFiles(files), fBlockFiles(fBlockFilesIn),
+          vImportFiles(files.size()) {}
+
+    //! Import all files and return the number of blocks accepted.
+    int Run();
+};
+
+void BlockImporter::ReadFile(size_t nFile) {
+    const CChainParams &chainparams = config.GetChainParams();
+    FILE *fileIn = fsbridge::fopen(vFiles[nFile], "rb");
+    if (!fileIn) {
+        LogPrintf("Warning: Could not open blocks file %s\n",
+                  vFiles[nFile].string());
+        return;
+    }
+
+    // This takes over fileIn and calls fclose() on it in the CBufferedFile
+    // destructor. Make sure we have at least 2*MAX_TX_SIZE space in there so
+    // any transaction can fit in the buffer.
+    CBufferedFile blkdat(fileIn, 2 * MAX_TX_SIZE, MAX_TX_SIZE + 8, SER_DISK,
+                         CLIENT_VERSION);
+    AdviseFileAccess(fileIn, 0, 0, FileAccess::SEQUENTIAL);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        {
+            LOCK(cs);
+            if (fInterrupt) {
+                return;
             }
+        }
 
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp) {
-                    dbp->nPos = nBlockPos;
-                }
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock &block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock &&
-                        !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(
-                            BCLog::REINDEX,
-                            "%s: Out of order block %s, parent %s not known\n",
-                            __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                        if (dbp) {
-                            mapBlocksUnknownParent.insert(
-                                std::make_pair(block.hashPrevBlock, *dbp));
-                        }
-                        continue;
-                    }
+        int64_t nTime0 = GetTimeMicros();
+        blkdat.SetPos(nRewind);
+        // Start one byte further next time, in case of failure.
+        nRewind++;
+        // Remove former limit.
+        blkdat.SetLimit();
+        unsigned int nSize = 0;
+        try {
+            // Locate a header.
+            uint8_t buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.DiskMagic()[0]);
+            nRewind = blkdat.GetPos() + 1;
+            blkdat >> buf;
+            if (memcmp(buf, chainparams.DiskMagic().data(),
+                       CMessageHeader::MESSAGE_START_SIZE)) {
+                continue;
+            }
 
-                    // process in case the block isn't known yet
-                    CBlockIndex *pindex = LookupBlockIndex(hash);
-                    if (!pindex || !pindex->nStatus.hasData()) {
-                        CValidationState state;
-                        if (g_chainstate.AcceptBlock(config, pblock, state,
-                                                     true, dbp, nullptr)) {
-                            nLoaded++;
-                        }
-                        if (state.IsError()) {
-                            break;
-                        }
-                    } else if (hash != chainparams.GetConsensus()
-                                           .hashGenesisBlock &&
-                               pindex->nHeight % 1000 == 0) {
-                        LogPrint(
-                            BCLog::REINDEX,
-                            "Block Import: already had block %s at height %d\n",
-                            hash.ToString(), pindex->nHeight);
-                    }
+            // Read size.
+            blkdat >> nSize;
+            if (nSize < 80) {
+                continue;
+            }
+        } catch (const std::exception &) {
+            // No valid block header found; don't complain.
+            break;
+        }
+
+        try {
+            // Read the raw block first, so that I/O and parsing can be told
+            // apart.
+            uint64_t nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            CDataStream stream(SER_DISK, CLIENT_VERSION);
+            stream.resize(nSize);
+            blkdat.read(stream.data(), nSize);
+            int64_t nTime1 = GetTimeMicros();
+            nTimeRead += nTime1 - nTime0;
+            nBytesRead += nSize;
+
+            ImportedBlock imported;
+            imported.pblock = std::make_shared<CBlock>();
+            stream >> *imported.pblock;
+            // Continue right after the block, as if it had been deserialized
+            // straight from the file.
+            nRewind = nBlockPos + nSize - stream.size();
+            imported.hash = imported.pblock->GetHash();
+            imported.pos = FlatFilePos(nFile, nBlockPos);
+            imported.nSize = nSize;
+            int64_t nTime2 = GetTimeMicros();
+            nTimeParse += nTime2 - nTime1;
+
+            // Do the context free checks (merkle root, transactions) here
+            // rather than under cs_main. If they fail, AcceptBlock repeats
+            // them and marks the block invalid.
+            CValidationState state;
+            CheckBlock(*imported.pblock, state, chainparams.GetConsensus(),
+                       BlockValidationOptions(config));
+            nTimeCheck += GetTimeMicros() - nTime2;
+            nBlocksRead++;
+
+            if (!Push(nFile, std::move(imported))) {
+                return;
+            }
+        } catch (const std::exception &e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__,
+                      e.what());
+        }
+    }
+
+    // Imported blocks are written to the block files, so the pages of the
+    // file they came from are not needed anymore.
+    if (!fBlockFiles) {
+        AdviseFileAccess(fileIn, 0, 0, FileAccess::DONTNEED);
+    }
+}
+
+void BlockImporter::ThreadRead() {
+    while (true) {
+        size_t nFile;
+        {
+            LOCK(cs);
+            if (fInterrupt || nNextFile == vFiles.size()) {
+                return;
+            }
+            nFile = nNextFile++;
+        }
+
+        try {
+            ReadFile(nFile);
+        } catch (const std::runtime_error &e) {
+            ::AbortNode(std::string("System error: ") + e.what());
+        }
+
+        LOCK(cs);
+        vImportFiles[nFile].fDone = true;
+        cond.notify_all();
+    }
+}
+
+void BlockImporter::Interrupt() {
+    LOCK(cs);
+    fInterrupt = true;
+    cond.notify_all();
+}
+
+/**
+ * Accept a block read from a file, or keep it for later if its parent is not
+ * known yet. Returns false if the rest of the file should be skipped.
+ */
+bool BlockImporter::AcceptImportedBlock(ImportedBlock &imported) {
+    const CChainParams &chainparams = config.GetChainParams();
+    const uint256 &hash = imported.hash;
+    const CBlock &block = *imported.pblock;
+    const FlatFilePos *dbp = fBlockFiles ? &imported.pos : nullptr;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != chainparams.GetConsensus().hashGenesisBlock &&
+            !LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX,
+                     "%s: Out of order block %s, parent %s not known\n",
+                     __func__, hash.ToString(),
+                     block.hashPrevBlock.ToString());
+            const uint256 hashPrev = block.hashPrevBlock;
+            if (nUnknownParentBytes + imported.nSize <=
+                MAX_UNKNOWN_PARENT_BYTES) {
+                nUnknownParentBytes += imported.nSize;
+            } else if (dbp) {
+                imported.pblock.reset();
+            } else {
+                return true;
+            }
+            mapBlocksUnknownParent.emplace(hashPrev, std::move(imported));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex *pindex = LookupBlockIndex(hash);
+        if (!pindex || !pindex->nStatus.hasData()) {
+            CValidationState state;
+            if (g_chainstate.AcceptBlock(config, imported.pblock, state, true,
+                                         dbp, nullptr)) {
+                nLoaded++;
+            }
+            if (state.IsError()) {
+                return false;
+            }
+        } else if (hash != chainparams.GetConsensus().hashGenesisBlock &&
+                   pindex->nHeight % 1000 == 0) {
+            LogPrint(BCLog::REINDEX,
+                     "Block Import: already had block %s at height %d\n",
+                     hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+        CValidationState state;
+        if (!ActivateBestChain(config, state)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip();
+
+    AcceptUnknownParentChildren(hash);
+    return true;
+}
+
+/** Recursively process earlier encountered successors of a block. */
+void BlockImporter::AcceptUnknownParentChildren(const uint256 &hash) {
+    const CChainParams &chainparams = config.GetChainParams();
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        auto range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            auto it = range.first;
+            ImportedBlock &child = it->second;
+            bool fHaveBlock = true;
+            if (child.pblock) {
+                nUnknownParentBytes -= child.nSize;
+            } else {
+                child.pblock = std::make_shared<CBlock>();
+                fHaveBlock = ReadBlockFromDisk(*child.pblock, child.pos,
+                                               chainparams.GetConsensus());
+            }
+            if (fHaveBlock) {
+                LogPrint(BCLog::REINDEX,
+                         "%s: Processing out of order child %s of %s\n",
+                         __func__, child.hash.ToString(), head.ToString());
+                LOCK(cs_main);
+                CValidationState dummy;
+                if (g_chainstate.AcceptBlock(config, child.pblock, dummy, true,
+                                             fBlockFiles ? &child.pos : nullptr,
+                                             nullptr)) {
+                    nLoaded++;
+                    queue.push_back(child.hash);
                 }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+            NotifyHeaderTip();
+        }
+    }
+}
 
-                // Activate the genesis block so normal node progress can
-                // continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(config, state)) {
-                        break;
-                    }
+int BlockImporter::Run() {
+    const int nThreads =
+        std::max(1, std::min(GetNumCores(), MAX_IMPORT_THREADS));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::min<int>(nThreads, vFiles.size()); i++) {
+        threads.emplace_back(&BlockImporter::ThreadRead, this);
+    }
+
+    try {
+        for (size_t nFile = 0; nFile < vFiles.size(); nFile++) {
+            {
+                LOCK(cs);
+                nCurrentFile = nFile;
+                cond.notify_all();
+            }
+            if (fBlockFiles) {
+                LogPrintf("Reindexing block file blk%05u.dat...\n",
+                          (unsigned int)nFile);
+            } else {
+                LogPrintf("Importing blocks file %s...\n",
+                          vFiles[nFile].string());
+            }
+
+            bool fSkip = false;
+            while (true) {
+                boost::this_thread::interruption_point();
+
+                int64_t nTime0 = GetTimeMicros();
+                ImportedBlock imported;
+                if (!Pop(nFile, imported)) {
+                    break;
+                }
+                int64_t nTime1 = GetTimeMicros();
+                nTimeWait += nTime1 - nTime0;
+                if (fSkip) {
+                    continue;
                 }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this
-                // block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator,
-                              std::multimap<uint256, FlatFilePos>::iterator>
-                        range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it =
-                            range.first;
-                        std::shared_ptr<CBlock> pblockrecursive =
-                            std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second,
-                                              chainparams.GetConsensus())) {
-                            LogPrint(
-                                BCLog::REINDEX,
-                                "%s: Processing out of order child %s of %s\n",
-                                __func__, pblockrecursive->GetHash().ToString(),
-                                head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (g_chainstate.AcceptBlock(
-                                    config, pblockrecursive, dummy, true,
-                                    &it->second, nullptr)) {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
+                try {
+                    fSkip = !AcceptImportedBlock(imported);
+                } catch (const std::exception &e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__,
+                              e.what());
                 }
-            } catch (const std::exception &e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__,
-                          e.what());
+                nTimeAccept += GetTimeMicros() - nTime1;
+                nBlocksAccepted++;
             }
-        }
+
+            LogPrint(BCLog::BENCH,
+                     "  - Import %u/%u: %u blocks, %.2fMiB. Read: %.2fs "
+                     "(%.2fMiB/s), parse: %.2fs (%.2fMiB/s), check: %.2fs "
+                     "(%.2fblk/s), accept: %.2fs (%.2fblk/s), waiting for "
+                     "readers: %.2fs\n",
+                     nFile + 1, vFiles.size(), nBlocksRead.load(),
+                     nBytesRead / double(1 << 20), nTimeRead * MICRO,
+                     nBytesRead / double(1 << 20) /
+                         std::max<int64_t>(nTimeRead, 1) * 1000000,
+                     nTimeParse * MICRO,
+                     nBytesRead / double(1 << 20) /
+                         std::max<int64_t>(nTimeParse, 1) * 1000000,
+                     nTimeCheck * MICRO,
+                     nBlocksRead / double(std::max<int64_t>(nTimeCheck, 1)) *
+                         1000000,
+                     nTimeAccept * MICRO,
+                     nBlocksAccepted /
+                         double(std::max<int64_t>(nTimeAccept, 1)) * 1000000,
+                     nTimeWait * MICRO);
+        }
+    } catch (...) {
+        Interrupt();
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        throw;
+    }
+
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    return nLoaded;
+}
+} // namespace
+
+bool LoadExternalBlockFiles(const Config &config,
+                            const std::vector<fs::path> &vFiles,
+                            bool fBlockFiles) {
+    int64_t nStart = GetTimeMillis();
+    int nLoaded = 0;
+    try {
+        nLoaded = BlockImporter(config, vFiles, fBlockFiles).Run();
     } catch (const std::runtime_error &e) {
         AbortNode(std::string("System error: ") + e.what());
     }
 
     if (nLoaded > 0) {
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded,
-                  GetTimeMillis() - nStart);
+        LogPrintf("Loaded %i blocks from %u external files in %dms\n", nLoaded,
+                  vFiles.size(), GetTimeMillis() - nStart);
     }
 
     return nLoaded > 0;
@@ -6286,8 +7905,114 @@ CBlockFileInfo *GetBlockFileInfo(size_t n) {
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t SCRIPT_CACHE_DUMP_VERSION = 1;
+
+/**
+ * Write the nonce and entries of one of the script caches to the given file
+ * in the data directory.
+ */
+static bool DumpScriptCacheFile(const std::string &strFile,
+                                const uint256 &nonce,
+                                const std::vector<uint256> &entries) {
+    const fs::path path = GetDataDir() / strFile;
+    const fs::path pathNew = GetDataDir() / (strFile + ".new");
+    try {
+        FILE *filestr = fsbridge::fopen(pathNew, "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << SCRIPT_CACHE_DUMP_VERSION;
+        file << nonce;
+        file << entries;
+        if (!FileCommit(file.Get())) {
+            throw std::runtime_error("FileCommit failed");
+        }
+        file.fclose();
+        RenameOver(pathNew, path);
+    } catch (const std::exception &e) {
+        LogPrintf("Failed to dump %s: %s. Continuing anyway.\n", strFile,
+                  e.what());
+        return false;
+    }
+    return true;
+}
+
+static bool LoadScriptCacheFile(const std::string &strFile, uint256 &nonce,
+                                std::vector<uint256> &entries) {
+    FILE *filestr = fsbridge::fopen(GetDataDir() / strFile, "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return false;
+    }
+
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SCRIPT_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        file >> nonce;
+        file >> entries;
+    } catch (const std::exception &e) {
+        LogPrintf("Failed to deserialize %s on disk: %s. Continuing anyway.\n",
+                  strFile, e.what());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Save the signature and script execution caches next to mempool.dat. The
+ * entries are salted hashes, so the salts are saved along with them.
+ */
+static void DumpScriptCaches() {
+    uint256 nonce;
+    std::vector<uint256> entries;
+    DumpSignatureCache(nonce, entries);
+    DumpScriptCacheFile("sigcache.dat", nonce, entries);
+    const size_t nSigEntries = entries.size();
+
+    entries.clear();
+    {
+        LOCK(cs_main);
+        DumpScriptCache(nonce, entries);
+    }
+    DumpScriptCacheFile("scriptcache.dat", nonce, entries);
+    LogPrintf("Dumped %u signature cache and %u script cache entries\n",
+              nSigEntries, entries.size());
+}
+
+/**
+ * Load the caches saved by DumpScriptCaches, adopting their salts, so that
+ * transactions reloaded from mempool.dat and the next blocks hit the caches
+ * right away.
+ */
+static void LoadScriptCaches() {
+    uint256 nonce;
+    std::vector<uint256> entries;
+    size_t nSigEntries = 0;
+    if (LoadScriptCacheFile("sigcache.dat", nonce, entries)) {
+        LoadSignatureCache(nonce, entries);
+        nSigEntries = entries.size();
+    }
+
+    entries.clear();
+    if (LoadScriptCacheFile("scriptcache.dat", nonce, entries)) {
+        LOCK(cs_main);
+        LoadScriptCache(nonce, entries);
+    }
+    LogPrintf("Loaded %u signature cache and %u script cache entries from "
+              "disk\n",
+              nSigEntries, entries.size());
+}
 
 bool LoadMempool(const Config &config) {
+    if (gArgs.GetBoolArg("-persistscriptcache", DEFAULT_PERSIST_SCRIPT_CACHE)) {
+        LoadScriptCaches();
+    }
+
     int64_t nExpiryTimeout =
         gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
     FILE *filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
@@ -6419,6 +8144,10 @@ bool DumpMempool() {
         LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
         return false;
     }
+
+    if (gArgs.GetBoolArg("-persistscriptcache", DEFAULT_PERSIST_SCRIPT_CACHE)) {
+        DumpScriptCaches();
+    }
     return true;
 }
 
@@ -6453,11 +8182,7 @@ class CMainCleanup {
 public:
     CMainCleanup() {}
     ~CMainCleanup() {
-        // block headers
-        for (const std::pair<const uint256, CBlockIndex *> &it :
-             mapBlockIndex) {
-            delete it.second;
-        }
+        // block headers, the entries themselves are owned by the chainstate
         mapBlockIndex.clear();
     }
 } instance_of_cmaincleanup;
@@ -50,6 +50,7 @@ class CScriptCheck;
 class CTxMemPool;
 class CTxUndo;
 class CValidationState;
+class SchnorrSignatureBatch;
 
 struct FlatFilePos;
 struct ChainTxData;
@@ -191,6 +192,30 @@ static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistscriptcache */
+static const bool DEFAULT_PERSIST_SCRIPT_CACHE = true;
+/** Default for -blockindexsnapshot */
+static const bool DEFAULT_BLOCK_INDEX_SNAPSHOT = true;
+/** Default for -blockprefetch, the number of blocks prepared ahead */
+static const int64_t DEFAULT_BLOCK_PREFETCH = 16;
+/** Default for -blockprefetchmem, in MiB */
+static const int64_t DEFAULT_BLOCK_PREFETCH_MEMORY = 128;
+/** Number of threads preparing blocks ahead of connecting them */
+static const int BLOCK_PREFETCH_THREADS = 2;
+/**
+ * Default for -undocache, the number of recently connected blocks kept with
+ * their undo data
+ */
+static const int64_t DEFAULT_UNDO_CACHE = 10;
+/** Default for -undocachemem, in MiB */
+static const int64_t DEFAULT_UNDO_CACHE_MEMORY = 64;
+/** Maximum number of blocks disconnected on a single coins view */
+static const size_t MAX_DISCONNECT_BATCH = 16;
+/**
+ * Default for -blockreadahead, the number of blocks hinted to the operating
+ * system ahead of scans over the chain
+ */
+static const int64_t DEFAULT_BLOCK_READAHEAD = 32;
 /** Default for using fee filter */
 static const bool DEFAULT_FEEFILTER = true;
 
@@ -389,10 +414,14 @@ FILE *OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
 
 /**
- * Import blocks from an external file.
+ * Import blocks from external files. Several files are read and deserialized
+ * at once, while the blocks are accepted in file order. If fBlockFiles is
+ * set, vFiles are our own block files, in order of their file number, and
+ * the blocks are indexed at their current position (-reindex).
  */
-bool LoadExternalBlockFile(const Config &config, FILE *fileIn,
-                           FlatFilePos *dbp = nullptr);
+bool LoadExternalBlockFiles(const Config &config,
+                            const std::vector<fs::path> &vFiles,
+                            bool fBlockFiles = false);
 
 /**
  * Ensures we have a genesis block in the block tree, possibly writing one to
@@ -421,6 +450,24 @@ void UnloadBlockIndex();
  */
 void ThreadScriptCheck();
 
+/**
+ * Start the threads that read and check the blocks ActivateBestChain is about
+ * to connect, as configured by -blockprefetch.
+ */
+void StartBlockPrefetchThreads(const Config &config);
+
+/**
+ * Stop the block prefetch threads. Must be called before the coins views are
+ * destroyed.
+ */
+void StopBlockPrefetchThreads();
+
+/**
+ * Size the cache of recently connected blocks and their undo data, as
+ * configured by -undocache and -undocachemem.
+ */
+void InitUndoCache();
+
 /**
  * Check whether we are doing an initial block download (synchronizing from disk
  * or network)
@@ -485,6 +532,24 @@ bool AcceptToMemoryPool(const Config &config, CTxMemPool &pool,
                         bool test_accept = false)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * (try to) add several transactions to memory pool. A transaction may spend
+ * the outputs of other transactions of the batch, in any order, including
+ * with test_accept. The scripts of the transactions are checked in parallel
+ * on the script check threads, without holding cs_main unless test_accept.
+ * vAccepted, states and vMissingInputs get the result of each transaction.
+ * Returns the number of transactions accepted.
+ */
+size_t AcceptToMemoryPoolBatch(const Config &config, CTxMemPool &pool,
+                               const std::vector<CTransactionRef> &txs,
+                               std::vector<bool> &vAccepted,
+                               std::vector<CValidationState> &states,
+                               std::vector<bool> &vMissingInputs,
+                               bool fLimitFree,
+                               const Amount nAbsurdFee = Amount::zero(),
+                               bool test_accept = false)
+    LOCKS_EXCLUDED(cs_main);
+
 UniValue VerifyTransactionWithMemoryPool(const Config &config, CTxMemPool &pool,
                         CValidationState &state, const CTransactionRef &tx,
                         bool fLimitFree, bool *pfMissingInputs,
@@ -505,13 +570,18 @@ std::string FormatStateMessage(const CValidationState &state);
  * Setting sigCacheStore/scriptCacheStore to false will remove elements from the
  * corresponding cache which are matched. This is useful for checking blocks
  * where we will likely never need the cache entry again.
+ *
+ * If pschnorrbatch is not nullptr, the checks pushed onto pvChecks defer the
+ * verification of Schnorr signatures to it. This requires
+ * SCRIPT_VERIFY_NULLFAIL, and is ignored when the checks are performed inline.
  */
 bool CheckInputs(const CTransaction &tx, CValidationState &state,
                  const CCoinsViewCache &view, bool fScriptChecks,
                  const uint32_t flags, bool sigCacheStore,
                  bool scriptCacheStore,
                  const PrecomputedTransactionData &txdata,
-                 std::vector<CScriptCheck> *pvChecks = nullptr);
+                 std::vector<CScriptCheck> *pvChecks = nullptr,
+                 SchnorrSignatureBatch *pschnorrbatch = nullptr);
 
 UniValue CheckInputsBetter(const CTransaction &tx, CValidationState &state,
                  const CCoinsViewCache &view, bool fScriptChecks,
@@ -548,12 +618,15 @@ bool TestLockPointValidity(const LockPoints *lp)
  * calculated and the hash of the block needed for calculation or skips the
  * calculation and uses the LockPoints passed in for evaluation. The LockPoints
  * should not be considered valid if CheckSequenceLocks returns false.
+ * The inputs are looked up in the mempool and pcoinsTip, or in pcoinsView if
+ * not nullptr.
  *
  * See consensus/consensus.h for flag definitions.
  */
 bool CheckSequenceLocks(const CTxMemPool &pool, const CTransaction &tx,
                         int flags, LockPoints *lp = nullptr,
-                        bool useExistingLockPoints = false)
+                        bool useExistingLockPoints = false,
+                        const CCoinsView *pcoinsView = nullptr)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 /**
@@ -570,19 +643,23 @@ private:
     bool cacheStore;
     ScriptError error;
     PrecomputedTransactionData txdata;
+    //! If not nullptr, Schnorr signatures are verified in batches there.
+    SchnorrSignatureBatch *pschnorrbatch;
 
 public:
     CScriptCheck()
         : amount(), ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false),
-          error(ScriptError::UNKNOWN), txdata() {}
+          error(ScriptError::UNKNOWN), txdata(), pschnorrbatch(nullptr) {}
 
     CScriptCheck(const CScript &scriptPubKeyIn, const Amount amountIn,
                  const CTransaction &txToIn, unsigned int nInIn,
                  uint32_t nFlagsIn, bool cacheIn,
-                 const PrecomputedTransactionData &txdataIn)
+                 const PrecomputedTransactionData &txdataIn,
+                 SchnorrSignatureBatch *pschnorrbatchIn = nullptr)
         : scriptPubKey(scriptPubKeyIn), amount(amountIn), ptxTo(&txToIn),
           nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn),
-          error(ScriptError::UNKNOWN), txdata(txdataIn) {}
+          error(ScriptError::UNKNOWN), txdata(txdataIn),
+          pschnorrbatch(pschnorrbatchIn) {}
 
     bool operator()();
 
@@ -595,6 +672,7 @@ public:
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
+        std::swap(pschnorrbatch, check.pschnorrbatch);
     }
 
     ScriptError GetScriptError() const { return error; }
@@ -614,6 +692,52 @@ bool ReadBlockFromDisk(CBlock &block, const FlatFilePos &pos,
                        const Consensus::Params &params);
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex,
                        const Consensus::Params &params);
+/**
+ * Read the serialized block of the given index from disk, as it would be sent
+ * over the network, without deserializing it.
+ */
+bool ReadRawBlockFromDisk(std::vector<uint8_t> &block,
+                          const CBlockIndex *pindex,
+                          const CChainParams &chainparams);
+
+/**
+ * Tells the operating system which parts of the block and undo files a scan
+ * over the chain, such as an index sync, a rescan or VerifyDB, reads next, so
+ * that they are read in the background while the scan processes the current
+ * block. The block files the scan left behind are dropped from the page cache,
+ * so that a scan of the whole chain does not evict the pages of the chainstate
+ * and of the recent blocks.
+ */
+class BlockFileReadahead {
+private:
+    const CBlockIndex *const pindexEnd;
+    const bool fUndo;
+    const int64_t nBlocks;
+    //! Whether the scan goes from the tip towards the genesis block
+    bool fBackward = false;
+    //! Height of the block hinted last, or -1 before the first block is read
+    int nHeightHinted = -1;
+    //! Files of the blocks read last, most recent last
+    std::vector<int> vFilesRead;
+
+    //! The block at nHeight on the chain being scanned, if it is scanned.
+    const CBlockIndex *BlockAt(const CBlockIndex *pindex, int nHeight) const
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+public:
+    /**
+     * @param[in] pindexEnd The last block of the scan, which may be above or
+     * below the first one, or nullptr to follow chainActive up to its tip.
+     * @param[in] fUndo Whether the scan reads the undo data of the blocks too.
+     */
+    BlockFileReadahead(const CBlockIndex *pindexEnd, bool fUndo);
+
+    /**
+     * Call before reading each block of the scan, in order. Hints the next
+     * -blockreadahead blocks.
+     */
+    void Read(const CBlockIndex *pindex);
+};
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -760,10 +884,13 @@ static const unsigned int REJECT_AGAINST_FINALIZED = 0x103;
 /** Get block file info entry for one block file */
 CBlockFileInfo *GetBlockFileInfo(size_t n);
 
-/** Dump the mempool to disk. */
+/**
+ * Dump the mempool to disk, along with the signature and script execution
+ * caches if -persistscriptcache is set.
+ */
 bool DumpMempool();
 
-/** Load the mempool from disk. */
+/** Load the mempool, and the caches saved with it, from disk. */
 bool LoadMempool(const Config &config);
 bool AbortNode(const std::string &strMessage,
                const std::string &userMessage = "");
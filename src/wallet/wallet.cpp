@@ -1136,7 +1136,8 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionRef &ptx,
             }
         }
 
-        CWalletTx wtx(this, ptx);
+        // Do not keep the block the transaction came from in memory.
+        CWalletTx wtx(this, DetachTransaction(ptx));
 
         // Get merkle branch if transaction was found in a block
         if (pIndex != nullptr) {
@@ -1824,6 +1825,7 @@ CBlockIndex *CWallet::ScanForWalletTransactions(
             }
         }
         double progress_current = progress_begin;
+        BlockFileReadahead readahead(pindexStop, false);
         while (pindex && !fAbortRescan && !ShutdownRequested()) {
             if (pindex->nHeight % 100 == 0 &&
                 progress_end - progress_begin > 0.0) {
@@ -1841,6 +1843,7 @@ CBlockIndex *CWallet::ScanForWalletTransactions(
                           pindex->nHeight, progress_current);
             }
 
+            readahead.Read(pindex);
             CBlock block;
             if (ReadBlockFromDisk(block, pindex, chainParams.GetConsensus())) {
                 LOCK2(cs_main, cs_wallet);
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""
+Soak test for the memory used by blocks and their transactions.
+
+Connects, disconnects and connects again many blocks full of transactions,
+and checks that the memory of the node settles instead of drifting upwards.
+Blocks are freed as a whole once they are connected, and the transactions
+that go back to the mempool on a reorg must not keep their block alive.
+"""
+
+import sys
+import time
+
+from test_framework.blocktools import (
+    create_block,
+    create_coinbase,
+    make_conform_to_ctor,
+)
+from test_framework.messages import (
+    COutPoint,
+    CTransaction,
+    CTxIn,
+    CTxOut,
+    ToHex,
+)
+from test_framework.script import CScript, OP_TRUE
+from test_framework.test_framework import BitcoinTestFramework, SkipTest
+from test_framework.txtools import pad_tx
+from test_framework.util import assert_equal
+
+# Number of transactions spending one output each, in every block
+TXS_PER_BLOCK = 2000
+# Blocks connected, then disconnected and connected again, in each round
+BLOCKS_PER_ROUND = 5
+ROUNDS = 60
+# Rounds after which the memory used is expected to have settled
+WARMUP_ROUNDS = 10
+# Growth allowed after warming up, relative to the memory used then
+MAX_DRIFT = 0.2
+
+
+def anonymous_memory(pid):
+    """
+    Resident memory of a process, in bytes, leaving out mapped files such as
+    the block files.
+    """
+    with open('/proc/{}/status'.format(pid), encoding='utf8') as f:
+        for line in f:
+            if line.startswith('RssAnon:'):
+                return int(line.split()[1]) * 1024
+    raise SkipTest("RssAnon is not reported by this kernel")
+
+
+class BlockMemoryTest(BitcoinTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        # Keep the caches small, so that they do not account for the growth.
+        self.extra_args = [['-blocktxarena=1',
+                            '-dbcache=4',
+                            '-maxsigcachesize=1']]
+
+    def next_block(self, txs):
+        block = create_block(self.tip, create_coinbase(self.height + 1),
+                             self.block_time)
+        block.vtx.extend(txs)
+        make_conform_to_ctor(block)
+        block.hashMerkleRoot = block.calc_merkle_root()
+        block.solve()
+        self.tip = block.sha256
+        self.height += 1
+        self.block_time += 1
+        return block
+
+    def submit(self, block):
+        assert_equal(self.nodes[0].submitblock(ToHex(block)), None)
+
+    def spend_outputs(self):
+        """A block spending every output of the previous one."""
+        txs = []
+        outputs = []
+        for txid, n, value in self.outputs:
+            tx = CTransaction()
+            tx.vin.append(CTxIn(COutPoint(txid, n)))
+            tx.vout.append(CTxOut(value - 1000, CScript([OP_TRUE])))
+            pad_tx(tx)
+            tx.rehash()
+            txs.append(tx)
+            outputs.append((tx.sha256, 0, value - 1000))
+        self.outputs = outputs
+        return self.next_block(txs)
+
+    def run_test(self):
+        if not sys.platform.startswith('linux'):
+            raise SkipTest("This test can only be run on Linux.")
+
+        node = self.nodes[0]
+        pid = node.process.pid
+        self.tip = int(node.getbestblockhash(), 16)
+        self.height = 0
+        self.block_time = int(time.time())
+
+        self.log.info("Mature a coinbase and split it")
+        first = self.next_block([])
+        self.submit(first)
+        for _ in range(100):
+            self.submit(self.next_block([]))
+
+        coinbase = first.vtx[0]
+        value = (coinbase.vout[0].nValue - 1000) // TXS_PER_BLOCK
+        split = CTransaction()
+        split.vin.append(CTxIn(COutPoint(coinbase.sha256, 0)))
+        for _ in range(TXS_PER_BLOCK):
+            split.vout.append(CTxOut(value, CScript([OP_TRUE])))
+        split.rehash()
+        self.submit(self.next_block([split]))
+        self.outputs = [(split.sha256, n, value)
+                        for n in range(TXS_PER_BLOCK)]
+
+        samples = []
+        for i in range(ROUNDS):
+            blocks = [self.spend_outputs() for _ in range(BLOCKS_PER_ROUND)]
+            for block in blocks:
+                self.submit(block)
+            assert_equal(node.getbestblockhash(), blocks[-1].hash)
+
+            # Send the transactions back to the mempool, then confirm them
+            # again.
+            node.invalidateblock(blocks[0].hash)
+            assert_equal(node.getmempoolinfo()['size'],
+                         TXS_PER_BLOCK * BLOCKS_PER_ROUND)
+            node.reconsiderblock(blocks[0].hash)
+            assert_equal(node.getbestblockhash(), blocks[-1].hash)
+            assert_equal(node.getmempoolinfo()['size'], 0)
+
+            samples.append(anonymous_memory(pid))
+            self.log.info("Round {}: {} kB".format(i, samples[-1] // 1024))
+
+        settled = samples[WARMUP_ROUNDS - 1]
+        self.log.info("Memory after warming up {} kB, at the end {} kB".format(
+            settled // 1024, samples[-1] // 1024))
+        assert max(samples[WARMUP_ROUNDS:]) < settled * (1 + MAX_DRIFT)
+
+
+if __name__ == '__main__':
+    BlockMemoryTest().main()
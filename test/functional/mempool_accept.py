@@ -58,7 +58,9 @@ class MempoolAcceptanceTest(BitcoinTestFramework):
         self.log.info('Should not accept garbage to testmempoolaccept')
         assert_raises_rpc_error(-3, 'Expected type array, got string',
                                 lambda: node.testmempoolaccept(rawtxs='ff00baar'))
-        assert_raises_rpc_error(-8, 'Array must contain exactly one raw transaction for now',
+        assert_raises_rpc_error(-8, 'Array must contain at least one raw transaction',
+                                lambda: node.testmempoolaccept(rawtxs=[]))
+        assert_raises_rpc_error(-22, 'TX decode failed',
                                 lambda: node.testmempoolaccept(rawtxs=['ff00baar', 'ff22']))
         assert_raises_rpc_error(-22, 'TX decode failed',
                                 lambda: node.testmempoolaccept(rawtxs=['ff00baar']))
@@ -32,8 +32,6 @@ class GetBlockTemplateLPTest(BitcoinTestFramework):
         self.num_nodes = 2
 
     def run_test(self):
-        self.log.info(
-            "Warning: this test will take about 70 seconds in the best case. Be patient.")
         self.nodes[0].generate(10)
         templat = self.nodes[0].getblocktemplate()
         longpollid = templat['longpollid']
@@ -69,17 +67,14 @@ class GetBlockTemplateLPTest(BitcoinTestFramework):
         assert(not thr.is_alive())
 
         # Test 4: test that introducing a new transaction into the mempool will
-        # terminate the longpoll
+        # terminate the longpoll, as its fee is above -longpollfeeincrease
         thr = LongpollThread(self.nodes[0])
         thr.start()
         # generate a random transaction and submit it
-        min_relay_fee = self.nodes[0].getnetworkinfo()["relayfee"]
-        # min_relay_fee is fee per 1000 bytes, which should be more than enough.
         (txid, txhex, fee) = random_transaction(self.nodes,
-                                                Decimal("1.1"), min_relay_fee, Decimal("0.001"), 20)
-        # after one minute, every 10 seconds the mempool is probed, so in 80
-        # seconds it should have returned
-        thr.join(60 + 20)
+                                                Decimal("1.1"), Decimal("0.001"), Decimal("0.001"), 20)
+        # wait 5 seconds or until thread exits
+        thr.join(5)
         assert(not thr.is_alive())
 
 
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""
+Test many getblocktemplate long polls at once.
+
+Long polls hold no RPC thread while waiting, so that there can be many more of
+them than -rpcthreads. They are answered on a new tip, or once the fees of the
+template grow by -longpollfeeincrease.
+"""
+
+import threading
+import time
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.blocktools import (
+    create_block,
+    create_coinbase,
+    make_conform_to_ctor,
+)
+from test_framework.messages import (
+    COIN,
+    COutPoint,
+    CTransaction,
+    CTxIn,
+    CTxOut,
+    ToHex,
+)
+from test_framework.mininode import P2PInterface
+from test_framework.script import CScript, OP_TRUE
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.txtools import pad_tx
+from test_framework.util import (
+    assert_equal,
+    get_rpc_proxy,
+)
+
+# Number of long polls waiting at once
+NUM_LONGPOLLS = 100
+# Fee increase answering the long polls, in satoshis
+FEE_INCREASE = 10000
+
+
+class LongPollThread(threading.Thread):
+
+    def __init__(self, node, longpollid, batch=False):
+        threading.Thread.__init__(self)
+        self.longpollid = longpollid
+        self.batch = batch
+        self.result = None
+        self.error = None
+        # create a new connection to the node, we can't use the same
+        # connection from two threads
+        self.node = get_rpc_proxy(
+            node.url, 1, timeout=600, coveragedir=node.coverage_dir)
+
+    def run(self):
+        try:
+            if self.batch:
+                request = self.node.getblocktemplate.get_request(
+                    {'longpollid': self.longpollid})
+                self.result = self.node.batch([request])[0]['result']
+            else:
+                self.result = self.node.getblocktemplate(
+                    {'longpollid': self.longpollid})
+        except (JSONRPCException, OSError) as e:
+            self.error = e
+
+
+class GetBlockTemplateLongPollsTest(BitcoinTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        # The work queue still holds the long polls sent at once until they
+        # are deferred.
+        self.extra_args = [['-rpcthreads=2',
+                            '-rpcworkqueue={}'.format(NUM_LONGPOLLS),
+                            '-longpollfeeincrease={}'.format(
+                                FEE_INCREASE / COIN)]]
+
+    def next_block(self, txs):
+        block = create_block(self.tip, create_coinbase(self.height + 1),
+                             self.block_time)
+        block.vtx.extend(txs)
+        make_conform_to_ctor(block)
+        block.hashMerkleRoot = block.calc_merkle_root()
+        block.solve()
+        self.tip = block.sha256
+        self.height += 1
+        self.block_time += 1
+        assert_equal(self.nodes[0].submitblock(ToHex(block)), None)
+        return block
+
+    def spend(self, fee):
+        txid, n, value = self.coins.pop()
+        tx = CTransaction()
+        tx.vin.append(CTxIn(COutPoint(txid, n)))
+        tx.vout.append(CTxOut(value - fee, CScript([OP_TRUE])))
+        pad_tx(tx)
+        tx.rehash()
+        self.nodes[0].sendrawtransaction(ToHex(tx))
+        return tx
+
+    def start_longpolls(self, count, batch=False):
+        longpollid = self.nodes[0].getblocktemplate()['longpollid']
+        threads = [LongPollThread(self.nodes[0], longpollid, batch)
+                   for _ in range(count)]
+        for thread in threads:
+            thread.start()
+        return threads
+
+    def assert_waiting(self, threads):
+        # Give the node the time to answer them if it would.
+        time.sleep(2)
+        assert all(thread.is_alive() for thread in threads)
+
+    def assert_answered(self, threads):
+        for thread in threads:
+            thread.join(10)
+            assert not thread.is_alive()
+            assert_equal(thread.error, None)
+        return [thread.result for thread in threads]
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.add_p2p_connection(P2PInterface())
+        self.tip = int(node.getbestblockhash(), 16)
+        self.height = 0
+        self.block_time = int(time.time())
+
+        self.log.info("Mature some coinbases")
+        coinbases = [self.next_block([]).vtx[0] for _ in range(5)]
+        for _ in range(100):
+            self.next_block([])
+        self.coins = [(cb.sha256, 0, cb.vout[0].nValue) for cb in coinbases]
+
+        self.log.info("Wait with more long polls than RPC threads")
+        threads = self.start_longpolls(NUM_LONGPOLLS)
+        self.assert_waiting(threads)
+        assert_equal(node.getblockcount(), self.height)
+
+        self.log.info("Keep waiting on transactions with low fees")
+        low_fee_tx = self.spend(FEE_INCREASE // 10)
+        self.assert_waiting(threads)
+
+        self.log.info("Answer all of them once the fees grow enough")
+        tx = self.spend(FEE_INCREASE)
+        results = self.assert_answered(threads)
+        assert all(result == results[0] for result in results)
+        assert tx.hash in [t['txid'] for t in results[0]['transactions']]
+        assert_equal(results[0]['longpollid'],
+                     node.getblocktemplate()['longpollid'])
+
+        self.log.info("Answer all of them on a new tip")
+        threads = self.start_longpolls(NUM_LONGPOLLS)
+        self.assert_waiting(threads)
+        self.next_block([low_fee_tx, tx])
+        for result in self.assert_answered(threads):
+            assert_equal(result['previousblockhash'], node.getbestblockhash())
+            assert_equal(result['transactions'], [])
+
+        self.log.info("Answer long polls in batches")
+        threads = self.start_longpolls(1, batch=True)
+        self.assert_waiting(threads)
+        tx = self.spend(FEE_INCREASE)
+        result = self.assert_answered(threads)[0]
+        assert_equal([t['txid'] for t in result['transactions']], [tx.hash])
+
+        self.log.info("Answer a long poll on an old tip at once")
+        longpollid = node.getblocktemplate()['longpollid']
+        self.next_block([tx])
+        thread = LongPollThread(node, longpollid)
+        thread.start()
+        result = self.assert_answered([thread])[0]
+        assert_equal(result['previousblockhash'], node.getbestblockhash())
+
+        self.log.info("Stop with long polls waiting")
+        threads = self.start_longpolls(NUM_LONGPOLLS)
+        self.assert_waiting(threads)
+        self.stop_node(0)
+        for thread in threads:
+            thread.join(10)
+            assert not thread.is_alive()
+            assert isinstance(thread.error, JSONRPCException)
+            assert_equal(thread.error.error['code'], -9)
+
+
+if __name__ == '__main__':
+    GetBlockTemplateLongPollsTest().main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""
+Test the sendrawtransactions RPC, and testmempoolaccept with several
+transactions.
+
+Transactions of a batch may spend each other and be given in any order. Each
+one gets its own result, and those accepted are announced to peers.
+"""
+
+import time
+
+from test_framework.blocktools import (
+    create_block,
+    create_coinbase,
+    make_conform_to_ctor,
+)
+from test_framework.messages import (
+    COutPoint,
+    CTransaction,
+    CTxIn,
+    CTxOut,
+    ToHex,
+)
+from test_framework.mininode import P2PInterface
+from test_framework.script import CScript, OP_FALSE, OP_TRUE
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.txtools import pad_tx
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    wait_until,
+)
+
+# Number of outputs of the transaction the others spend
+SPLIT_OUTPUTS = 10
+
+
+class TxInvStore(P2PInterface):
+    """Records the transactions announced by the node."""
+
+    def __init__(self):
+        super().__init__()
+        self.tx_invs = set()
+
+    def on_inv(self, message):
+        for i in message.inv:
+            if i.type == 1:
+                self.tx_invs.add(i.hash)
+
+
+def spend(outpoints, value, script=CScript([OP_TRUE])):
+    tx = CTransaction()
+    for txid, n in outpoints:
+        tx.vin.append(CTxIn(COutPoint(txid, n)))
+    tx.vout.append(CTxOut(value, script))
+    pad_tx(tx)
+    tx.rehash()
+    return tx
+
+
+class SendRawTransactionsTest(BitcoinTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def next_block(self, txs):
+        block = create_block(self.tip, create_coinbase(self.height + 1),
+                             self.block_time)
+        block.vtx.extend(txs)
+        make_conform_to_ctor(block)
+        block.hashMerkleRoot = block.calc_merkle_root()
+        block.solve()
+        self.tip = block.sha256
+        self.height += 1
+        self.block_time += 1
+        assert_equal(self.nodes[0].submitblock(ToHex(block)), None)
+        return block
+
+    def run_test(self):
+        node = self.nodes[0]
+        peer = node.add_p2p_connection(TxInvStore())
+        self.tip = int(node.getbestblockhash(), 16)
+        self.height = 0
+        self.block_time = int(time.time())
+
+        self.log.info("Mature two coinbases")
+        coinbases = [self.next_block([]).vtx[0] for _ in range(2)]
+        for _ in range(100):
+            self.next_block([])
+
+        coinbase = coinbases[0]
+        value = (coinbase.vout[0].nValue - 1000) // SPLIT_OUTPUTS
+        split = CTransaction()
+        split.vin.append(CTxIn(COutPoint(coinbase.sha256, 0)))
+        for _ in range(SPLIT_OUTPUTS):
+            split.vout.append(CTxOut(value, CScript([OP_TRUE])))
+        split.rehash()
+
+        child0 = spend([(split.sha256, 0)], value - 1000)
+        child1 = spend([(split.sha256, 1)], value - 1000)
+        grandchild = spend([(child0.sha256, 0), (child1.sha256, 0)],
+                           2 * value - 3000)
+        double_spend = spend([(split.sha256, 1)], value - 2000)
+        unspendable = spend([(split.sha256, 2)], value - 1000,
+                            CScript([OP_FALSE]))
+        spends_unspendable = spend([(unspendable.sha256, 0)], value - 2000)
+        orphan = spend([(child1.sha256, 1)], value - 2000)
+
+        self.log.info("Reject batches which cannot be decoded")
+        assert_raises_rpc_error(-22, 'TX decode failed for rawtxs[1]',
+                                node.sendrawtransactions,
+                                [ToHex(split), 'ff00baar'])
+        assert_equal(node.sendrawtransactions([]), [])
+
+        self.log.info("Test a package without adding it to the mempool")
+        package = [grandchild, child1, child0, split]
+        result = node.testmempoolaccept([ToHex(tx) for tx in package])
+        assert_equal(result, [{'txid': tx.hash, 'allowed': True}
+                              for tx in package])
+        assert_equal(node.getmempoolinfo()['size'], 0)
+
+        self.log.info("Send a batch with its children before their parents")
+        batch = [grandchild, child0, double_spend, split, child1, orphan]
+        result = node.sendrawtransactions([ToHex(tx) for tx in batch])
+        assert_equal([r['txid'] for r in result], [tx.hash for tx in batch])
+        assert_equal([r['accepted'] for r in result],
+                     [True, True, False, True, True, False])
+        assert_equal(result[2]['reject-reason'], '18: txn-mempool-conflict')
+        assert_equal(result[5]['reject-reason'], 'missing-inputs')
+        accepted = [grandchild, child0, split, child1]
+        assert_equal(sorted(node.getrawmempool()),
+                     sorted(tx.hash for tx in accepted))
+
+        self.log.info("Announce the accepted transactions to peers")
+        wait_until(lambda: peer.tx_invs == set(tx.sha256 for tx in accepted),
+                   timeout=30)
+
+        self.log.info("Reject the descendants of invalid transactions")
+        descendant = spend([(spends_unspendable.sha256, 0)], value - 3000)
+        batch = [descendant, spends_unspendable, unspendable]
+        result = node.sendrawtransactions([ToHex(tx) for tx in batch])
+        assert_equal([r['accepted'] for r in result], [False, False, True])
+        assert_equal(result[0]['reject-reason'], 'missing-inputs')
+        assert result[1]['reject-reason'].startswith(
+            '16: mandatory-script-verify-flag-failed')
+
+        self.log.info("Send transactions again")
+        result = node.sendrawtransactions([ToHex(split), ToHex(child0)])
+        assert_equal(result, [{'txid': split.hash, 'accepted': True},
+                              {'txid': child0.hash, 'accepted': True}])
+
+        self.log.info("Reject transactions which are already confirmed")
+        confirmed = spend([(coinbases[1].sha256, 0)],
+                          coinbases[1].vout[0].nValue - 1000)
+        self.next_block([confirmed])
+        result = node.sendrawtransactions([ToHex(confirmed)])
+        assert_equal(result, [{'txid': confirmed.hash, 'accepted': False,
+                               'reject-reason':
+                               'transaction already in block chain'}])
+
+
+if __name__ == '__main__':
+    SendRawTransactionsTest().main()